@@ -0,0 +1,126 @@
+import java.io.BufferedReader;
+import java.io.ByteArrayInputStream;
+import java.io.FileDescriptor;
+import java.io.FileOutputStream;
+import java.io.InputStreamReader;
+import java.io.PrintStream;
+import java.lang.reflect.InvocationTargetException;
+import java.lang.reflect.Method;
+import java.nio.charset.StandardCharsets;
+import java.security.Permission;
+import java.util.jar.JarFile;
+
+/**
+ * Persistent JVM worker used by APK Editor Studio to run JAR tools (apktool, apksigner)
+ * without paying the JVM start-up for every command.
+ *
+ * Usage: java -cp TOOL.jar JarWorker.java TOOL.jar TOKEN
+ *
+ * On start-up, the worker prints a "TOKEN ready TRAPPED" line, where TRAPPED tells
+ * whether System.exit() calls of the tool can be intercepted. Each request is a line
+ * with the argument count followed by one line per argument ("%", CR and LF are
+ * percent-encoded). The tool output is streamed to stdout and terminated by a
+ * "TOKEN STATUS" line.
+ */
+public class JarWorker {
+
+    static class ExitException extends SecurityException {
+        final int status;
+
+        ExitException(int status) {
+            super("System.exit(" + status + ")");
+            this.status = status;
+        }
+    }
+
+    public static void main(String[] args) throws Exception {
+        final String jar = args[0];
+        final String token = args[1];
+
+        final String mainClass;
+        try (JarFile jarFile = new JarFile(jar)) {
+            mainClass = jarFile.getManifest().getMainAttributes().getValue("Main-Class");
+        }
+        final Method main = Class.forName(mainClass).getMethod("main", String[].class);
+
+        final BufferedReader input = new BufferedReader(new InputStreamReader(System.in, StandardCharsets.UTF_8));
+        final PrintStream output = new PrintStream(new FileOutputStream(FileDescriptor.out), true, "UTF-8");
+        System.setIn(new ByteArrayInputStream(new byte[0]));
+        System.setOut(output);
+        System.setErr(output);
+
+        boolean exitTrapped = false;
+        try {
+            System.setSecurityManager(new SecurityManager() {
+                @Override
+                public void checkExit(int status) {
+                    throw new ExitException(status);
+                }
+
+                @Override
+                public void checkPermission(Permission permission) {
+                }
+
+                @Override
+                public void checkPermission(Permission permission, Object context) {
+                }
+            });
+            exitTrapped = true;
+        } catch (Throwable e) {
+            // Not supported by this JVM: the worker exits along with the tool.
+        }
+
+        output.println(token + " ready " + (exitTrapped ? 1 : 0));
+
+        String line;
+        while ((line = input.readLine()) != null) {
+            final int count = Integer.parseInt(line.trim());
+            final String[] arguments = new String[count];
+            for (int i = 0; i < count; ++i) {
+                final String argument = input.readLine();
+                arguments[i] = argument != null ? unescape(argument) : "";
+            }
+            int status = 0;
+            try {
+                main.invoke(null, (Object) arguments);
+            } catch (InvocationTargetException e) {
+                status = getStatus(e.getCause(), output);
+            } catch (Throwable e) {
+                status = getStatus(e, output);
+            }
+            output.println();
+            output.println(token + " " + status);
+        }
+
+        try {
+            System.setSecurityManager(null);
+        } catch (Throwable e) {
+            // Not installed.
+        }
+        Runtime.getRuntime().halt(0);
+    }
+
+    private static int getStatus(Throwable throwable, PrintStream output) {
+        for (Throwable cause = throwable; cause != null; cause = cause.getCause()) {
+            if (cause instanceof ExitException) {
+                return ((ExitException) cause).status;
+            }
+        }
+        throwable.printStackTrace(output);
+        return 1;
+    }
+
+    private static String unescape(String argument) {
+        final StringBuilder result = new StringBuilder(argument.length());
+        for (int i = 0; i < argument.length(); ++i) {
+            final char c = argument.charAt(i);
+            if (c == '%' && i + 2 < argument.length()) {
+                result.append((char) Integer.parseInt(argument.substring(i + 1, i + 3), 16));
+                i += 2;
+            } else {
+                result.append(c);
+            }
+        }
+        return result.toString();
+    }
+}
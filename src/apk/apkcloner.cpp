@@ -1,7 +1,34 @@
 #include "apk/apkcloner.h"
+#include "base/patternreplacer.h"
 #include <QDirIterator>
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QSaveFile>
 #include <QtConcurrent/QtConcurrent>
 
+namespace
+{
+    // Minimum interval between progress updates (ms)
+    const int ProgressInterval = 100;
+
+    bool isBinary(const QByteArray &data)
+    {
+        // Signatures of compiled resources, images, audio, fonts and archives:
+        static const QList<QByteArray> signatures = {
+            QByteArray("\x03\x00\x08\x00", 4), // Binary XML
+            QByteArray("\x02\x00\x0C\x00", 4), // Resource table
+            "\x89PNG", "\xFF\xD8\xFF", "GIF8", "RIFF", "OggS", "ID3", "fLaC",
+            QByteArray("\x00\x01\x00\x00", 4), "OTTO", "wOFF", "PK\x03\x04", "dex\n"
+        };
+        for (const QByteArray &signature : signatures) {
+            if (data.startsWith(signature)) {
+                return true;
+            }
+        }
+        return data.left(8192).contains('\0');
+    }
+}
+
 ApkCloner::ApkCloner(const QString &contentsPath, const QString &originalPackageName, const QString &newPackageName, QObject *parent)
     : QObject(parent)
     , contentsPath(contentsPath)
@@ -22,58 +49,36 @@ void ApkCloner::start()
 
         // Update references in resources:
 
-        const auto resourcesPath = contentsPath + "/res/";
-        QDirIterator files(resourcesPath, QDir::Files, QDirIterator::Subdirectories);
-        while (files.hasNext()) {
-            const QString path(files.next());
-            emit progressed(tr("Updating resource references..."), path.mid(contentsPath.size() + 1));
-
-            QFile file(path);
-            if (file.open(QFile::ReadWrite)) {
-                const QString data(file.readAll());
-                QString newData(data);
-                newData.replace(originalPackageName, newPackageName);
-                if (newData != data) {
-                    file.resize(0);
-                    file.write(newData.toUtf8());
-                }
-                file.close();
-            }
+        PatternReplacer resourceReplacer;
+        resourceReplacer.add(originalPackageName.toUtf8(), newPackageName.toUtf8());
+        if (!updateReferences(getFiles({contentsPath + "/res/"}), resourceReplacer, tr("Updating resource references..."))) {
+            emit finished(false);
+            return;
         }
 
+        // Update references in smali:
+
         const auto smaliDirs = QDir(contentsPath).entryList({"smali*"}, QDir::Dirs);
+        QStringList smaliPaths;
         for (const auto &smaliDir : smaliDirs) {
+            smaliPaths.append(QString("%1/%2/").arg(contentsPath, smaliDir));
+        }
+        PatternReplacer smaliReplacer;
+        smaliReplacer.add(('L' + originalPackagePath).toUtf8(), ('L' + newPackagePath).toUtf8());
+        smaliReplacer.add(originalPackageName.toUtf8(), newPackageName.toUtf8());
+        //: "Smali" is the name of the tool/format, don't translate it.
+        if (!updateReferences(getFiles(smaliPaths), smaliReplacer, tr("Updating Smali references..."))) {
+            emit finished(false);
+            return;
+        }
 
-            const auto smaliPath = QString("%1/%2/").arg(contentsPath, smaliDir);
-
-            // Update references in smali:
-
-            QDirIterator files(smaliPath, QDir::Files, QDirIterator::Subdirectories);
-            while (files.hasNext()) {
-                const QString path(files.next());
-                //: "Smali" is the name of the tool/format, don't translate it.
-                emit progressed(tr("Updating Smali references..."), path.mid(contentsPath.size() + 1));
-
-                QFile file(path);
-                if (file.open(QFile::ReadWrite)) {
-                    const QString data(file.readAll());
-                    QString newData(data);
-                    newData.replace('L' + originalPackagePath, 'L' + newPackagePath);
-                    newData.replace(originalPackageName, newPackageName);
-                    if (newData != data) {
-                        file.resize(0);
-                        file.write(newData.toUtf8());
-                    }
-                    file.close();
-                }
-            }
-
-            // Update directory structure:
+        // Update directory structure:
 
-            emit progressed(tr("Updating directory structure..."), smaliDir);
+        for (int i = 0; i < smaliDirs.size(); ++i) {
+            emit progressed(tr("Updating directory structure..."), smaliDirs.at(i));
 
-            const auto fullPackagePath = smaliPath + newPackagePath;
-            const auto fullOriginalPackagePath = smaliPath + originalPackagePath;
+            const auto fullPackagePath = smaliPaths.at(i) + newPackagePath;
+            const auto fullOriginalPackagePath = smaliPaths.at(i) + originalPackagePath;
             if (!QDir().exists(fullOriginalPackagePath)) {
                 continue;
             }
@@ -83,7 +88,61 @@ void ApkCloner::start()
                 return;
             }
         }
-\
+
         emit finished(true);
     });
 }
+
+QStringList ApkCloner::getFiles(const QStringList &directories) const
+{
+    QStringList files;
+    for (const QString &directory : directories) {
+        QDirIterator it(directory, QDir::Files, QDirIterator::Subdirectories);
+        while (it.hasNext()) {
+            files.append(it.next());
+        }
+    }
+    return files;
+}
+
+bool ApkCloner::updateReferences(const QStringList &files, const PatternReplacer &replacer, const QString &stage)
+{
+    QAtomicInt failed(0);
+    QMutex progressMutex;
+    QElapsedTimer progressTimer;
+
+    QStringList paths(files);
+    QtConcurrent::blockingMap(paths, [&](const QString &path) {
+        {
+            QMutexLocker locker(&progressMutex);
+            if (!progressTimer.isValid() || progressTimer.elapsed() >= ProgressInterval) {
+                emit progressed(stage, path.mid(contentsPath.size() + 1));
+                progressTimer.start();
+            }
+        }
+
+        QFile file(path);
+        if (!file.open(QFile::ReadOnly)) {
+            return;
+        }
+        const QByteArray data = file.readAll();
+        file.close();
+        if (isBinary(data)) {
+            return;
+        }
+
+        // Only the files which actually contain the references are rewritten:
+        bool changed = false;
+        const QByteArray newData = replacer.apply(data, &changed);
+        if (!changed) {
+            return;
+        }
+        QSaveFile output(path);
+        if (!output.open(QSaveFile::WriteOnly) || output.write(newData) != newData.size() || !output.commit()) {
+            qWarning() << "Error: Could not update" << path;
+            failed = 1;
+        }
+    });
+
+    return !failed;
+}
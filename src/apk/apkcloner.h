@@ -3,6 +3,8 @@
 
 #include <QObject>
 
+class PatternReplacer;
+
 class ApkCloner : public QObject
 {
     Q_OBJECT
@@ -19,6 +21,9 @@ signals:
     void finished(bool success);
 
 private:
+    QStringList getFiles(const QStringList &directories) const;
+    bool updateReferences(const QStringList &files, const PatternReplacer &replacer, const QString &stage);
+
     QString contentsPath;
     QString originalPackageName;
     QString originalPackagePath;
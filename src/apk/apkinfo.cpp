@@ -0,0 +1,136 @@
+#include "apk/apkinfo.h"
+#include "apk/binaryxml.h"
+#include "apk/resourcetable.h"
+#include "base/ziparchive.h"
+
+using namespace BinaryResource;
+
+namespace
+{
+    // Framework attribute IDs (android.R.attr):
+    const quint32 LabelAttribute = 0x01010001;
+    const quint32 IconAttribute = 0x01010002;
+    const quint32 DrawableAttribute = 0x01010199;
+    const quint32 VersionCodeAttribute = 0x0101021b;
+    const quint32 VersionNameAttribute = 0x0101021c;
+    const int MaxIconDepth = 2;
+
+    QByteArray peek(const ZipArchive &archive, const QString &name)
+    {
+        const ZipArchive::Entry *entry = archive.getEntry(name);
+        return entry ? archive.peek(*entry) : QByteArray();
+    }
+
+    QString getString(const Value &value, const ResourceTable &resources)
+    {
+        return value.type == Value::Reference ? resources.getString(value.data) : value.string;
+    }
+}
+
+ApkInfo::ApkInfo(const QString &apkPath)
+{
+    ZipArchive archive(apkPath);
+    if (!archive.open()) {
+        return;
+    }
+
+    // Version name and label may refer to string resources:
+    Value versionNameValue;
+    Value labelValue;
+    quint32 iconId = 0;
+
+    BinaryXmlReader manifest(peek(archive, "AndroidManifest.xml"));
+    while (manifest.readNextStartElement()) {
+        if (manifest.depth() == 1 && manifest.name() == "manifest") {
+            if (auto attribute = manifest.attribute(0, "package")) {
+                packageName = attribute->value.string;
+            }
+            if (auto attribute = manifest.attribute(VersionCodeAttribute, "versionCode")) {
+                versionCode = attribute->value.type == Value::String
+                    ? attribute->value.string.toInt()
+                    : static_cast<int>(attribute->value.data);
+            }
+            if (auto attribute = manifest.attribute(VersionNameAttribute, "versionName")) {
+                versionNameValue = attribute->value;
+            }
+        } else if (manifest.depth() == 2 && manifest.name() == "application") {
+            if (auto attribute = manifest.attribute(LabelAttribute, "label")) {
+                labelValue = attribute->value;
+            }
+            auto attribute = manifest.attribute(IconAttribute, "icon");
+            if (attribute && attribute->value.type == Value::Reference) {
+                iconId = attribute->value.data;
+            }
+            break;
+        }
+    }
+    if (packageName.isEmpty()) {
+        return;
+    }
+
+    // Only the entries referenced by the manifest are looked up in the resource table:
+    const ResourceTable resources(peek(archive, "resources.arsc"));
+    versionName = getString(versionNameValue, resources);
+    applicationLabel = getString(labelValue, resources);
+    if (iconId) {
+        icon = readIcon(archive, resources, iconId);
+    }
+}
+
+bool ApkInfo::isValid() const
+{
+    return !packageName.isEmpty();
+}
+
+const QString &ApkInfo::getPackageName() const
+{
+    return packageName;
+}
+
+const QString &ApkInfo::getVersionName() const
+{
+    return versionName;
+}
+
+int ApkInfo::getVersionCode() const
+{
+    return versionCode;
+}
+
+const QString &ApkInfo::getApplicationLabel() const
+{
+    return applicationLabel;
+}
+
+const QImage &ApkInfo::getIcon() const
+{
+    return icon;
+}
+
+QImage ApkInfo::readIcon(const ZipArchive &archive, const ResourceTable &resources, quint32 id, int depth)
+{
+    const QString path = resources.getFilePath(id);
+    if (path.isEmpty()) {
+        return QImage();
+    }
+    const QByteArray data = peek(archive, path);
+    if (!path.endsWith(".xml", Qt::CaseInsensitive)) {
+        return QImage::fromData(data);
+    }
+
+    // Adaptive icons are compiled XML files; their foreground layer is used instead:
+    if (depth >= MaxIconDepth) {
+        return QImage();
+    }
+    BinaryXmlReader xml(data);
+    while (xml.readNextStartElement()) {
+        if (xml.name() == "foreground") {
+            auto attribute = xml.attribute(DrawableAttribute, "drawable");
+            if (attribute && attribute->value.type == Value::Reference) {
+                return readIcon(archive, resources, attribute->value.data, depth + 1);
+            }
+            break;
+        }
+    }
+    return QImage();
+}
@@ -0,0 +1,36 @@
+#ifndef APKINFO_H
+#define APKINFO_H
+
+#include <QImage>
+#include <QString>
+
+class ResourceTable;
+class ZipArchive;
+
+// Summary of an APK read directly from its binary manifest and resource table,
+// so that it is available before (or without) decoding the APK with apktool.
+
+class ApkInfo
+{
+public:
+    ApkInfo() = default;
+    explicit ApkInfo(const QString &apkPath);
+
+    bool isValid() const;
+    const QString &getPackageName() const;
+    const QString &getVersionName() const;
+    int getVersionCode() const;
+    const QString &getApplicationLabel() const;
+    const QImage &getIcon() const;
+
+private:
+    static QImage readIcon(const ZipArchive &archive, const ResourceTable &resources, quint32 id, int depth = 0);
+
+    QString packageName;
+    QString versionName;
+    int versionCode = 0;
+    QString applicationLabel;
+    QImage icon;
+};
+
+#endif // APKINFO_H
@@ -0,0 +1,489 @@
+#include "apk/apkpatch.h"
+#include "apk/binaryxml.h"
+#include "base/ziparchive.h"
+#include "base/zipwriter.h"
+#include "tools/zipalign.h"
+#include <QDateTime>
+#include <QDir>
+#include <QDirIterator>
+#include <QRegularExpression>
+#include <QDebug>
+
+using namespace BinaryResource;
+
+namespace
+{
+    // Framework attribute IDs (android.R.attr):
+    const quint32 LabelAttribute = 0x01010001;
+    const quint32 MinSdkVersionAttribute = 0x0101020c;
+    const quint32 VersionCodeAttribute = 0x0101021b;
+    const quint32 VersionNameAttribute = 0x0101021c;
+    const quint32 TargetSdkVersionAttribute = 0x01010270;
+
+    const quint32 TableHeaderSize = 12;
+    const quint32 PackageHeaderSize = 284;
+    const quint32 PackageHeaderSizeWithTypeIdOffset = 288;
+    const quint32 ValueSize = 8;
+    const quint32 NoIndex = 0xffffffff;
+
+    bool isSignatureFile(const QString &name)
+    {
+        if (!name.startsWith("META-INF/")) {
+            return false;
+        }
+        static const QRegularExpression signature("^META-INF/([^/]+\\.(SF|RSA|DSA|EC)|MANIFEST\\.MF)$",
+                                                  QRegularExpression::CaseInsensitiveOption);
+        return signature.match(name).hasMatch();
+    }
+
+    void writeValue(uchar *value, quint8 type, quint32 data)
+    {
+        writeUInt16(value, ValueSize);
+        value[2] = 0;
+        value[3] = type;
+        writeUInt32(value + 4, data);
+    }
+
+    // Replaces the string pool at the given position with a copy extended by the strings
+    bool appendToStringPool(QByteArray &data, quint32 position, const QStringList &strings)
+    {
+        if (strings.isEmpty()) {
+            return true;
+        }
+        const uchar *bytes = reinterpret_cast<const uchar *>(data.constData());
+        const Chunk pool = readChunk(bytes + position, data.size() - position);
+        const QByteArray newPool = appendStrings(pool, strings);
+        if (newPool.isEmpty()) {
+            return false;
+        }
+        const quint32 rootSize = readUInt32(bytes + 4);
+        data.replace(static_cast<int>(position), static_cast<int>(pool.size), newPool);
+        writeUInt32(reinterpret_cast<uchar *>(data.data()) + 4, rootSize - pool.size + static_cast<quint32>(newPool.size()));
+        return true;
+    }
+
+    // Reads the values qualifiers of a configuration which may only differ from the default one
+    // by its language and region, e.g. "ru" or "pt-rBR". Returns false for any other configuration.
+    bool readLocaleQualifiers(const uchar *config, quint32 size, QString &qualifiers)
+    {
+        for (quint32 i = 4; i < size; ++i) {
+            if (config[i] && (i < 8 || i >= 12)) {
+                return false;
+            }
+        }
+        qualifiers.clear();
+        if (size < 12 || !config[8]) {
+            return true;
+        }
+        if ((config[8] & 0x80) || (config[10] & 0x80)) {
+            return false; // Packed three-letter codes
+        }
+        qualifiers = QString::fromLatin1(reinterpret_cast<const char *>(config + 8), 2);
+        if (config[10]) {
+            qualifiers += "-r" + QString::fromLatin1(reinterpret_cast<const char *>(config + 10), 2);
+        }
+        return true;
+    }
+}
+
+void ApkPatch::setApplicationLabel(const QString &label)
+{
+    if (!isLiteral(label)) {
+        requireRebuild();
+        return;
+    }
+    applicationLabel = label;
+}
+
+void ApkPatch::setVersionCode(int versionCode)
+{
+    this->versionCode = versionCode;
+}
+
+void ApkPatch::setVersionName(const QString &versionName)
+{
+    if (!isLiteral(versionName)) {
+        requireRebuild();
+        return;
+    }
+    this->versionName = versionName;
+}
+
+void ApkPatch::setMinSdk(int sdk)
+{
+    minSdk = sdk;
+}
+
+void ApkPatch::setTargetSdk(int sdk)
+{
+    targetSdk = sdk;
+}
+
+void ApkPatch::setString(const QString &name, const QString &qualifiers, const QString &previousValue, const QString &value)
+{
+    // Only the strings of the default and locale-specific values are patched:
+    static const QRegularExpression locale("^([a-z]{2}(-r[A-Z]{2})?)?$");
+    if (!isLiteral(previousValue) || !isLiteral(value) || !locale.match(qualifiers).hasMatch()) {
+        requireRebuild();
+        return;
+    }
+    // Repeated edits of the same string keep its original value:
+    for (StringEdit &edit : strings) {
+        if (edit.name == name && edit.qualifiers == qualifiers) {
+            edit.value = value;
+            return;
+        }
+    }
+    strings.append(StringEdit{name, qualifiers, previousValue, value});
+}
+
+void ApkPatch::setSnapshot(const Snapshot &snapshot)
+{
+    this->snapshot = snapshot;
+    hasSnapshot = true;
+}
+
+void ApkPatch::requireRebuild()
+{
+    rebuildRequired = true;
+}
+
+void ApkPatch::clear()
+{
+    applicationLabel.clear();
+    versionName.clear();
+    versionCode = -1;
+    minSdk = -1;
+    targetSdk = -1;
+    strings.clear();
+    snapshot.clear();
+    hasSnapshot = false;
+    rebuildRequired = false;
+}
+
+bool ApkPatch::isApplicable() const
+{
+    return hasSnapshot && !rebuildRequired;
+}
+
+bool ApkPatch::apply(const QString &source, const QString &target, const QString &contentsPath) const
+{
+    if (!isApplicable() || !hasExpectedChanges(contentsPath)) {
+        return false;
+    }
+
+    ZipArchive archive(source);
+    if (!archive.open()) {
+        return false;
+    }
+    const ZipArchive::Entry *manifestEntry = archive.getEntry("AndroidManifest.xml");
+    const ZipArchive::Entry *resourcesEntry = archive.getEntry("resources.arsc");
+
+    QByteArray manifest;
+    if (hasManifestEdits()) {
+        manifest = manifestEntry ? archive.read(*manifestEntry) : QByteArray();
+        if (!patchManifest(manifest)) {
+            return false;
+        }
+    }
+    QByteArray resources;
+    if (!strings.isEmpty()) {
+        resources = resourcesEntry ? archive.read(*resourcesEntry) : QByteArray();
+        if (!patchResources(resources)) {
+            return false;
+        }
+    }
+
+    ZipWriter writer(target);
+    if (!writer.open()) {
+        return false;
+    }
+    for (const ZipArchive::Entry &entry : archive.getEntries()) {
+        // The original signature is no longer valid:
+        if (isSignatureFile(entry.name)) {
+            continue;
+        }
+        // Alignment is kept, so that the optimization step does not need to rewrite the APK again:
+        const int alignment = Zipalign::getAlignment(entry);
+        bool success;
+        if (&entry == manifestEntry && !manifest.isNull()) {
+            success = writer.replaceEntry(archive, entry, manifest, alignment);
+        } else if (&entry == resourcesEntry && !resources.isNull()) {
+            success = writer.replaceEntry(archive, entry, resources, alignment);
+        } else {
+            success = writer.copyEntry(archive, entry, alignment);
+        }
+        if (!success) {
+            return false;
+        }
+    }
+    // The target may be the source itself, so it has to be released first:
+    archive.close();
+    return writer.commit();
+}
+
+ApkPatch::Snapshot ApkPatch::createSnapshot(const QString &contentsPath)
+{
+    Snapshot snapshot;
+    const QDir contents(contentsPath);
+    QDirIterator it(contentsPath, QDir::Files | QDir::Hidden, QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        it.next();
+        const QString path = contents.relativeFilePath(it.filePath());
+        // Build artifacts of apktool:
+        if (path.startsWith("build/") || path.startsWith("dist/")) {
+            continue;
+        }
+        const QFileInfo info = it.fileInfo();
+        snapshot.insert(path, {info.size(), info.lastModified().toMSecsSinceEpoch()});
+    }
+    return snapshot;
+}
+
+bool ApkPatch::hasManifestEdits() const
+{
+    return !applicationLabel.isNull() || !versionName.isNull() || versionCode != -1 || minSdk != -1 || targetSdk != -1;
+}
+
+bool ApkPatch::hasExpectedChanges(const QString &contentsPath) const
+{
+    // Files changed outside of the tracked edits (e.g., in an external editor) need a full rebuild:
+    static const QRegularExpression stringsFile("^res/values[^/]*/strings\\.xml$");
+    const Snapshot current = createSnapshot(contentsPath);
+    auto isExpected = [this](const QString &path) {
+        if (path == "AndroidManifest.xml" || path == "apktool.yml") {
+            return hasManifestEdits();
+        }
+        return !strings.isEmpty() && stringsFile.match(path).hasMatch();
+    };
+    for (auto it = current.constBegin(); it != current.constEnd(); ++it) {
+        auto original = snapshot.constFind(it.key());
+        if ((original == snapshot.constEnd() || original.value() != it.value()) && !isExpected(it.key())) {
+            qDebug() << "Full rebuild is required for" << it.key();
+            return false;
+        }
+    }
+    for (auto it = snapshot.constBegin(); it != snapshot.constEnd(); ++it) {
+        if (!current.contains(it.key())) {
+            qDebug() << "Full rebuild is required for" << it.key();
+            return false;
+        }
+    }
+    return true;
+}
+
+bool ApkPatch::patchManifest(QByteArray &data) const
+{
+    quint32 versionCodeOffset = 0;
+    quint32 versionNameOffset = 0;
+    quint32 minSdkOffset = 0;
+    quint32 targetSdkOffset = 0;
+    quint32 labelOffset = 0;
+    quint32 stringPoolOffset = 0;
+
+    BinaryXmlReader reader(data);
+    while (reader.readNextStartElement()) {
+        if (reader.depth() == 1 && reader.name() == "manifest") {
+            if (auto attribute = reader.attribute(VersionCodeAttribute, "versionCode")) {
+                versionCodeOffset = attribute->offset;
+            }
+            if (auto attribute = reader.attribute(VersionNameAttribute, "versionName")) {
+                versionNameOffset = attribute->offset;
+            }
+        } else if (reader.depth() == 2 && reader.name() == "uses-sdk") {
+            if (auto attribute = reader.attribute(MinSdkVersionAttribute, "minSdkVersion")) {
+                minSdkOffset = attribute->offset;
+            }
+            if (auto attribute = reader.attribute(TargetSdkVersionAttribute, "targetSdkVersion")) {
+                targetSdkOffset = attribute->offset;
+            }
+        } else if (reader.depth() == 2 && reader.name() == "application") {
+            if (auto attribute = reader.attribute(LabelAttribute, "label")) {
+                labelOffset = attribute->offset;
+            }
+        }
+        stringPoolOffset = reader.stringPoolOffset();
+    }
+    if (!stringPoolOffset) {
+        return false;
+    }
+
+    // Attributes missing from the compiled manifest are added by apktool only:
+    if ((versionCode != -1 && !versionCodeOffset) || (!versionName.isNull() && !versionNameOffset)
+            || (minSdk != -1 && !minSdkOffset) || (targetSdk != -1 && !targetSdkOffset)
+            || (!applicationLabel.isNull() && !labelOffset)) {
+        return false;
+    }
+
+    const uchar *bytes = reinterpret_cast<const uchar *>(data.constData());
+    const quint32 stringCount = StringPool(readChunk(bytes + stringPoolOffset, data.size() - stringPoolOffset)).count();
+    QStringList addedStrings;
+
+    // Attribute record: namespace, name, raw value and typed value
+    uchar *attributes = reinterpret_cast<uchar *>(data.data());
+    auto setIntegerAttribute = [&](quint32 offset, int value) {
+        writeUInt32(attributes + offset + 8, NoIndex);
+        writeValue(attributes + offset + 12, Value::IntDec, static_cast<quint32>(value));
+    };
+    auto setStringAttribute = [&](quint32 offset, const QString &value) {
+        const quint32 index = stringCount + static_cast<quint32>(addedStrings.size());
+        addedStrings.append(value);
+        writeUInt32(attributes + offset + 8, index);
+        writeValue(attributes + offset + 12, Value::String, index);
+    };
+    if (versionCode != -1) {
+        setIntegerAttribute(versionCodeOffset, versionCode);
+    }
+    if (minSdk != -1) {
+        setIntegerAttribute(minSdkOffset, minSdk);
+    }
+    if (targetSdk != -1) {
+        setIntegerAttribute(targetSdkOffset, targetSdk);
+    }
+    if (!versionName.isNull()) {
+        setStringAttribute(versionNameOffset, versionName);
+    }
+    if (!applicationLabel.isNull()) {
+        setStringAttribute(labelOffset, applicationLabel);
+    }
+    return appendToStringPool(data, stringPoolOffset, addedStrings);
+}
+
+bool ApkPatch::patchResources(QByteArray &data) const
+{
+    uchar *bytes = reinterpret_cast<uchar *>(data.data());
+    const Chunk root = readChunk(bytes, data.size());
+    if (root.type != TableChunk || root.headerSize < TableHeaderSize) {
+        return false;
+    }
+    const Chunk globalPool = readChunk(bytes + root.headerSize, root.size - root.headerSize);
+    if (globalPool.type != StringPoolChunk) {
+        return false;
+    }
+    const StringPool globalStrings(globalPool);
+
+    // Every edited string has to match exactly one entry, otherwise the edit is ambiguous:
+    QVector<uchar *> matches(strings.size(), nullptr);
+    QVector<int> matchCounts(strings.size(), 0);
+
+    for (quint32 offset = root.headerSize; offset < root.size;) {
+        const Chunk package = readChunk(bytes + offset, root.size - offset);
+        if (package.isNull()) {
+            break;
+        }
+        offset += package.size;
+        if (package.type != TablePackageChunk || package.headerSize < PackageHeaderSize) {
+            continue;
+        }
+        const quint32 typeStringsOffset = readUInt32(package.data + 268);
+        const quint32 keyStringsOffset = readUInt32(package.data + 276);
+        const quint32 typeIdOffset = package.headerSize >= PackageHeaderSizeWithTypeIdOffset ? readUInt32(package.data + 284) : 0;
+        if (typeStringsOffset >= package.size || keyStringsOffset >= package.size) {
+            continue;
+        }
+        const StringPool typeStrings(readChunk(package.data + typeStringsOffset, package.size - typeStringsOffset));
+        const StringPool keyStrings(readChunk(package.data + keyStringsOffset, package.size - keyStringsOffset));
+
+        quint32 stringTypeId = 0;
+        for (quint32 i = 0; i < typeStrings.count(); ++i) {
+            if (typeStrings.at(i) == "string") {
+                stringTypeId = i + 1 + typeIdOffset;
+                break;
+            }
+        }
+        if (!stringTypeId) {
+            continue;
+        }
+        QHash<quint32, QVector<int>> editsByKey;
+        for (quint32 i = 0; i < keyStrings.count(); ++i) {
+            const QString key = keyStrings.at(i);
+            for (int edit = 0; edit < strings.size(); ++edit) {
+                if (strings.at(edit).name == key) {
+                    editsByKey[i].append(edit);
+                }
+            }
+        }
+        if (editsByKey.isEmpty()) {
+            continue;
+        }
+
+        for (quint32 typeOffset = package.headerSize; typeOffset < package.size;) {
+            const Chunk type = readChunk(package.data + typeOffset, package.size - typeOffset);
+            if (type.isNull()) {
+                break;
+            }
+            typeOffset += type.size;
+            if (type.type != TableTypeChunk || type.headerSize < TypeHeaderSize || type.data[8] != stringTypeId) {
+                continue;
+            }
+            const uchar *config = type.data + TypeHeaderSize;
+            const quint32 configSize = type.headerSize >= TypeHeaderSize + 4
+                ? qMin<quint32>(readUInt32(config), type.headerSize - TypeHeaderSize) : 0;
+            QString qualifiers;
+            if (!readLocaleQualifiers(config, configSize, qualifiers)) {
+                continue;
+            }
+            const quint32 entriesStart = readUInt32(type.data + 16);
+            for (const quint32 entryOffset : getEntryOffsets(type)) {
+                const quint64 position = quint64(entriesStart) + entryOffset;
+                if (position + EntryHeaderSize > type.size) {
+                    continue;
+                }
+                uchar *entry = const_cast<uchar *>(type.data) + position;
+                const quint16 flags = readUInt16(entry + 2);
+                if (flags & ComplexEntryFlag) {
+                    continue;
+                }
+                const bool compact = flags & CompactEntryFlag;
+                if (!compact && position + readUInt16(entry) + ValueSize > type.size) {
+                    continue;
+                }
+                const quint32 key = compact ? readUInt16(entry) : readUInt32(entry + 4);
+                const quint8 valueType = compact ? flags >> 8 : entry[readUInt16(entry) + 3];
+                const quint32 value = compact ? readUInt32(entry + 4) : readUInt32(entry + readUInt16(entry) + 4);
+                auto it = editsByKey.constFind(key);
+                if (it == editsByKey.constEnd() || valueType != Value::String) {
+                    continue;
+                }
+                const QString string = globalStrings.at(value);
+                for (const int edit : it.value()) {
+                    if (strings.at(edit).qualifiers == qualifiers && strings.at(edit).originalValue == string) {
+                        matches[edit] = entry;
+                        ++matchCounts[edit];
+                    }
+                }
+            }
+        }
+    }
+
+    QStringList addedStrings;
+    for (int edit = 0; edit < strings.size(); ++edit) {
+        if (matchCounts.at(edit) != 1) {
+            qDebug() << "Full rebuild is required for string" << strings.at(edit).name;
+            return false;
+        }
+        uchar *entry = matches.at(edit);
+        const quint32 index = globalStrings.count() + static_cast<quint32>(addedStrings.size());
+        addedStrings.append(strings.at(edit).value);
+        const quint16 flags = readUInt16(entry + 2);
+        if (flags & CompactEntryFlag) {
+            writeUInt16(entry + 2, static_cast<quint16>((flags & 0x00ff) | (Value::String << 8)));
+            writeUInt32(entry + 4, index);
+        } else {
+            writeValue(entry + readUInt16(entry), Value::String, index);
+        }
+    }
+    return appendToStringPool(data, root.headerSize, addedStrings);
+}
+
+bool ApkPatch::isLiteral(const QString &value)
+{
+    // Values which aapt would unescape, trim or resolve as references:
+    if (value.startsWith('@') || value.startsWith('?')) {
+        return false;
+    }
+    if (value.contains('\\') || value.contains('"') || value.contains('\n') || value.contains("  ")) {
+        return false;
+    }
+    return value.trimmed() == value;
+}
@@ -0,0 +1,68 @@
+#ifndef APKPATCH_H
+#define APKPATCH_H
+
+#include <QHash>
+#include <QList>
+#include <QString>
+
+// Edits which can be applied directly to the compiled manifest and resource table
+// of the APK, so that saving it does not require a full rebuild with apktool.
+// Any other change to the unpacked contents makes the full rebuild necessary.
+
+class ApkPatch
+{
+public:
+    struct FileState
+    {
+        qint64 size;
+        qint64 modified;
+
+        bool operator==(const FileState &other) const { return size == other.size && modified == other.modified; }
+        bool operator!=(const FileState &other) const { return !(*this == other); }
+    };
+    typedef QHash<QString, FileState> Snapshot;
+
+    void setApplicationLabel(const QString &label);
+    void setVersionCode(int versionCode);
+    void setVersionName(const QString &versionName);
+    void setMinSdk(int sdk);
+    void setTargetSdk(int sdk);
+    // Qualifiers are the ones of the values directory, e.g. "ru" for "values-ru"
+    void setString(const QString &name, const QString &qualifiers, const QString &previousValue, const QString &value);
+    void setSnapshot(const Snapshot &snapshot);
+    void requireRebuild();
+    void clear();
+
+    bool isApplicable() const;
+    bool apply(const QString &source, const QString &target, const QString &contentsPath) const;
+
+    static Snapshot createSnapshot(const QString &contentsPath);
+
+private:
+    struct StringEdit
+    {
+        QString name;
+        QString qualifiers;
+        QString originalValue;
+        QString value;
+    };
+
+    bool hasManifestEdits() const;
+    bool hasExpectedChanges(const QString &contentsPath) const;
+    bool patchManifest(QByteArray &data) const;
+    bool patchResources(QByteArray &data) const;
+
+    static bool isLiteral(const QString &value);
+
+    QString applicationLabel;
+    QString versionName;
+    int versionCode = -1;
+    int minSdk = -1;
+    int targetSdk = -1;
+    QList<StringEdit> strings;
+    Snapshot snapshot;
+    bool hasSnapshot = false;
+    bool rebuildRequired = false;
+};
+
+#endif // APKPATCH_H
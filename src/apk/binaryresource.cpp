@@ -0,0 +1,269 @@
+#include "apk/binaryresource.h"
+
+namespace
+{
+    const quint16 ChunkHeaderSize = 8;
+    const quint16 StringPoolHeaderSize = 28;
+    const quint32 SortedFlag = 0x001;
+    const quint32 Utf8Flag = 0x100;
+    const quint16 NoEntry16 = 0xffff;
+
+    void appendLength8(QByteArray &data, int length)
+    {
+        if (length > 0x7f) {
+            data.append(static_cast<char>(0x80 | (length >> 8)));
+        }
+        data.append(static_cast<char>(length & 0xff));
+    }
+
+    void appendUInt16(QByteArray &data, quint16 value)
+    {
+        uchar bytes[2];
+        qToLittleEndian(value, bytes);
+        data.append(reinterpret_cast<const char *>(bytes), 2);
+    }
+
+    void appendUInt32(QByteArray &data, quint32 value)
+    {
+        uchar bytes[4];
+        qToLittleEndian(value, bytes);
+        data.append(reinterpret_cast<const char *>(bytes), 4);
+    }
+
+    bool encodeString(QByteArray &data, const QString &string, bool utf8)
+    {
+        if (utf8) {
+            const QByteArray bytes = string.toUtf8();
+            if (string.size() > 0x7fff || bytes.size() > 0x7fff) {
+                return false;
+            }
+            appendLength8(data, string.size());
+            appendLength8(data, bytes.size());
+            data.append(bytes);
+            data.append('\0');
+            return true;
+        }
+        const quint32 length = static_cast<quint32>(string.size());
+        if (length > 0x7fff) {
+            appendUInt16(data, static_cast<quint16>(0x8000 | (length >> 16)));
+        }
+        appendUInt16(data, static_cast<quint16>(length & 0xffff));
+        for (const QChar c : string) {
+            appendUInt16(data, c.unicode());
+        }
+        appendUInt16(data, 0);
+        return true;
+    }
+}
+
+namespace BinaryResource
+{
+    Chunk readChunk(const uchar *data, quint64 available)
+    {
+        Chunk chunk;
+        if (!data || available < ChunkHeaderSize) {
+            return chunk;
+        }
+        const quint16 headerSize = readUInt16(data + 2);
+        const quint32 size = readUInt32(data + 4);
+        if (headerSize < ChunkHeaderSize || headerSize > size || size > available) {
+            return chunk;
+        }
+        chunk.type = readUInt16(data);
+        chunk.headerSize = headerSize;
+        chunk.size = size;
+        chunk.data = data;
+        return chunk;
+    }
+
+    quint32 findEntryOffset(const Chunk &type, quint16 index)
+    {
+        const quint8 flags = type.data[9];
+        const quint32 entryCount = readUInt32(type.data + 12);
+        const uchar *offsets = type.data + type.headerSize;
+        const quint32 offsetsSize = type.size - type.headerSize;
+        if (flags & SparseTypeFlag) {
+            // Sorted pairs of 16-bit entry index and offset divided by 4:
+            const quint32 count = qMin(entryCount, offsetsSize / 4);
+            for (quint32 i = 0; i < count; ++i) {
+                const quint16 entryIndex = readUInt16(offsets + i * 4);
+                if (entryIndex == index) {
+                    return readUInt16(offsets + i * 4 + 2) * 4u;
+                }
+                if (entryIndex > index) {
+                    break;
+                }
+            }
+            return NoEntry;
+        }
+        if (index >= entryCount) {
+            return NoEntry;
+        }
+        if (flags & Offset16TypeFlag) {
+            if ((index + 1u) * 2 > offsetsSize) {
+                return NoEntry;
+            }
+            const quint16 offset = readUInt16(offsets + index * 2);
+            return offset != NoEntry16 ? offset * 4u : NoEntry;
+        }
+        if ((index + 1u) * 4 > offsetsSize) {
+            return NoEntry;
+        }
+        return readUInt32(offsets + index * 4);
+    }
+
+    QVector<quint32> getEntryOffsets(const Chunk &type)
+    {
+        QVector<quint32> result;
+        const quint8 flags = type.data[9];
+        const quint32 entryCount = readUInt32(type.data + 12);
+        const uchar *offsets = type.data + type.headerSize;
+        const quint32 offsetsSize = type.size - type.headerSize;
+        if (flags & SparseTypeFlag) {
+            const quint32 count = qMin(entryCount, offsetsSize / 4);
+            for (quint32 i = 0; i < count; ++i) {
+                result.append(readUInt16(offsets + i * 4 + 2) * 4u);
+            }
+        } else if (flags & Offset16TypeFlag) {
+            const quint32 count = qMin(entryCount, offsetsSize / 2);
+            for (quint32 i = 0; i < count; ++i) {
+                const quint16 offset = readUInt16(offsets + i * 2);
+                if (offset != NoEntry16) {
+                    result.append(offset * 4u);
+                }
+            }
+        } else {
+            const quint32 count = qMin(entryCount, offsetsSize / 4);
+            for (quint32 i = 0; i < count; ++i) {
+                const quint32 offset = readUInt32(offsets + i * 4);
+                if (offset != NoEntry) {
+                    result.append(offset);
+                }
+            }
+        }
+        return result;
+    }
+
+    QByteArray appendStrings(const Chunk &pool, const QStringList &strings)
+    {
+        if (pool.type != StringPoolChunk || pool.headerSize < StringPoolHeaderSize) {
+            return QByteArray();
+        }
+        const quint32 count = readUInt32(pool.data + 8);
+        const quint32 styleCount = readUInt32(pool.data + 12);
+        const quint32 flags = readUInt32(pool.data + 16);
+        const quint32 stringsStart = readUInt32(pool.data + 20);
+        const quint32 stylesStart = readUInt32(pool.data + 24);
+        const quint32 stringsEnd = styleCount ? stylesStart : pool.size;
+        if (pool.headerSize + (quint64(count) + styleCount) * 4 > stringsStart
+                || stringsStart > stringsEnd || stringsEnd > pool.size) {
+            return QByteArray();
+        }
+
+        // New strings go after the existing ones, so that all existing indices and offsets stay valid:
+        QByteArray added;
+        QByteArray addedOffsets;
+        for (const QString &string : strings) {
+            appendUInt32(addedOffsets, stringsEnd - stringsStart + added.size());
+            if (!encodeString(added, string, flags & Utf8Flag)) {
+                return QByteArray();
+            }
+        }
+        while (added.size() % 4) {
+            added.append('\0');
+        }
+
+        const char *source = reinterpret_cast<const char *>(pool.data);
+        QByteArray result(source, pool.headerSize);
+        result.append(source + pool.headerSize, static_cast<int>(count * 4));
+        result.append(addedOffsets);
+        result.append(source + pool.headerSize + count * 4, static_cast<int>(styleCount * 4));
+        const quint32 newStringsStart = static_cast<quint32>(result.size());
+        result.append(source + stringsStart, static_cast<int>(stringsEnd - stringsStart));
+        result.append(added);
+        const quint32 newStylesStart = static_cast<quint32>(result.size());
+        if (styleCount) {
+            result.append(source + stylesStart, static_cast<int>(pool.size - stylesStart));
+        }
+
+        uchar *header = reinterpret_cast<uchar *>(result.data());
+        writeUInt32(header + 4, static_cast<quint32>(result.size()));
+        writeUInt32(header + 8, count + static_cast<quint32>(strings.size()));
+        writeUInt32(header + 16, flags & ~SortedFlag);
+        writeUInt32(header + 20, newStringsStart);
+        writeUInt32(header + 24, styleCount ? newStylesStart : 0);
+        return result;
+    }
+
+    StringPool::StringPool(const Chunk &chunk)
+    {
+        if (chunk.type != StringPoolChunk || chunk.headerSize < StringPoolHeaderSize) {
+            return;
+        }
+        const quint32 count = readUInt32(chunk.data + 8);
+        const quint32 start = readUInt32(chunk.data + 20);
+        if (chunk.headerSize + quint64(count) * 4 > chunk.size || start > chunk.size) {
+            return;
+        }
+        data = chunk.data;
+        size = chunk.size;
+        stringCount = count;
+        stringsStart = start;
+        offsetsStart = chunk.headerSize;
+        utf8 = readUInt32(chunk.data + 16) & Utf8Flag;
+    }
+
+    quint32 StringPool::count() const
+    {
+        return stringCount;
+    }
+
+    QString StringPool::at(quint32 index) const
+    {
+        if (!data || index >= stringCount) {
+            return QString();
+        }
+        quint64 position = quint64(stringsStart) + readUInt32(data + offsetsStart + index * 4);
+        if (utf8) {
+            // UTF-16 length followed by UTF-8 length, each taking one or two bytes:
+            if (position + 2 > size) {
+                return QString();
+            }
+            position += (data[position] & 0x80) ? 2 : 1;
+            if (position + 2 > size) {
+                return QString();
+            }
+            quint32 length = data[position];
+            if (length & 0x80) {
+                length = ((length & 0x7f) << 8) | data[position + 1];
+                position += 2;
+            } else {
+                position += 1;
+            }
+            if (position + length > size) {
+                return QString();
+            }
+            return QString::fromUtf8(reinterpret_cast<const char *>(data + position), static_cast<int>(length));
+        }
+        if (position + 2 > size) {
+            return QString();
+        }
+        quint32 length = readUInt16(data + position);
+        position += 2;
+        if (length & 0x8000) {
+            if (position + 2 > size) {
+                return QString();
+            }
+            length = ((length & 0x7fff) << 16) | readUInt16(data + position);
+            position += 2;
+        }
+        if (position + quint64(length) * 2 > size) {
+            return QString();
+        }
+        QString result(static_cast<int>(length), Qt::Uninitialized);
+        for (quint32 i = 0; i < length; ++i) {
+            result[static_cast<int>(i)] = QChar(readUInt16(data + position + i * 2));
+        }
+        return result;
+    }
+}
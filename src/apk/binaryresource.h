@@ -0,0 +1,114 @@
+#ifndef BINARYRESOURCE_H
+#define BINARYRESOURCE_H
+
+#include <QStringList>
+#include <QVector>
+#include <QtEndian>
+
+// Building blocks of the compiled Android resource format, as found in
+// AndroidManifest.xml, resources.arsc and compiled XML files inside an APK.
+
+namespace BinaryResource
+{
+    enum ChunkType {
+        StringPoolChunk = 0x0001,
+        TableChunk = 0x0002,
+        XmlChunk = 0x0003,
+        XmlStartElementChunk = 0x0102,
+        XmlEndElementChunk = 0x0103,
+        XmlResourceMapChunk = 0x0180,
+        TablePackageChunk = 0x0200,
+        TableTypeChunk = 0x0201
+    };
+
+    enum TypeFlags {
+        SparseTypeFlag = 0x01,
+        Offset16TypeFlag = 0x02
+    };
+
+    enum EntryFlags {
+        ComplexEntryFlag = 0x0001,
+        CompactEntryFlag = 0x0008
+    };
+
+    const quint32 NoEntry = 0xffffffff;
+    const quint32 TypeHeaderSize = 20;
+    const quint32 EntryHeaderSize = 8;
+
+    struct Value
+    {
+        enum Type {
+            Null = 0x00,
+            Reference = 0x01,
+            String = 0x03,
+            IntDec = 0x10,
+            IntHex = 0x11,
+            IntBoolean = 0x12
+        };
+
+        quint8 type = Null;
+        quint32 data = 0;
+        QString string;
+    };
+
+    struct Chunk
+    {
+        quint16 type = 0;
+        quint16 headerSize = 0;
+        quint32 size = 0;
+        const uchar *data = nullptr;
+
+        bool isNull() const { return !data; }
+    };
+
+    class StringPool
+    {
+    public:
+        StringPool() = default;
+        explicit StringPool(const Chunk &chunk);
+
+        quint32 count() const;
+        QString at(quint32 index) const;
+
+    private:
+        const uchar *data = nullptr;
+        quint32 size = 0;
+        quint32 stringCount = 0;
+        quint32 stringsStart = 0;
+        quint32 offsetsStart = 0;
+        bool utf8 = false;
+    };
+
+    // Returns a null chunk if the header is malformed or exceeds the available data
+    Chunk readChunk(const uchar *data, quint64 available);
+
+    // Entry offsets are relative to the entries start of the type chunk
+    quint32 findEntryOffset(const Chunk &type, quint16 index);
+    QVector<quint32> getEntryOffsets(const Chunk &type);
+
+    // Returns a copy of the string pool chunk with the strings added to its end,
+    // or an empty array if the pool cannot be extended
+    QByteArray appendStrings(const Chunk &pool, const QStringList &strings);
+
+    inline quint16 readUInt16(const uchar *data)
+    {
+        return qFromLittleEndian<quint16>(data);
+    }
+
+    inline quint32 readUInt32(const uchar *data)
+    {
+        return qFromLittleEndian<quint32>(data);
+    }
+
+    inline void writeUInt16(uchar *data, quint16 value)
+    {
+        qToLittleEndian(value, data);
+    }
+
+    inline void writeUInt32(uchar *data, quint32 value)
+    {
+        qToLittleEndian(value, data);
+    }
+}
+
+#endif // BINARYRESOURCE_H
@@ -0,0 +1,131 @@
+#include "apk/binaryxml.h"
+
+using namespace BinaryResource;
+
+namespace
+{
+    const quint32 ElementExtensionSize = 20;
+    const quint32 MinimumAttributeSize = 20;
+    const quint32 NoIndex = 0xffffffff;
+}
+
+BinaryXmlReader::BinaryXmlReader(const QByteArray &data) : data(data)
+{
+    const Chunk root = readChunk(reinterpret_cast<const uchar *>(data.constData()), data.size());
+    if (root.type == XmlChunk) {
+        position = root.headerSize;
+        end = root.size;
+    }
+}
+
+bool BinaryXmlReader::readNextStartElement()
+{
+    const uchar *bytes = reinterpret_cast<const uchar *>(data.constData());
+    while (position < end) {
+        const Chunk chunk = readChunk(bytes + position, end - position);
+        if (chunk.isNull()) {
+            break;
+        }
+        position += chunk.size;
+        switch (chunk.type) {
+        case StringPoolChunk:
+            strings = StringPool(chunk);
+            stringsOffset = position - chunk.size;
+            break;
+        case XmlResourceMapChunk:
+            resourceMap = chunk;
+            break;
+        case XmlStartElementChunk:
+            ++currentDepth;
+            if (!readStartElement(chunk)) {
+                position = end;
+                return false;
+            }
+            return true;
+        case XmlEndElementChunk:
+            --currentDepth;
+            break;
+        }
+    }
+    position = end;
+    currentName.clear();
+    currentAttributes.clear();
+    return false;
+}
+
+const QString &BinaryXmlReader::name() const
+{
+    return currentName;
+}
+
+int BinaryXmlReader::depth() const
+{
+    return currentDepth;
+}
+
+const QVector<BinaryXmlReader::Attribute> &BinaryXmlReader::attributes() const
+{
+    return currentAttributes;
+}
+
+const BinaryXmlReader::Attribute *BinaryXmlReader::attribute(quint32 resourceId, const QString &name) const
+{
+    // Attribute names may be stripped by obfuscators, so framework attributes are matched by ID first:
+    for (const Attribute &attribute : currentAttributes) {
+        if (resourceId && attribute.resourceId == resourceId) {
+            return &attribute;
+        }
+    }
+    for (const Attribute &attribute : currentAttributes) {
+        if (!attribute.resourceId && attribute.name == name) {
+            return &attribute;
+        }
+    }
+    return nullptr;
+}
+
+quint32 BinaryXmlReader::stringPoolOffset() const
+{
+    return stringsOffset;
+}
+
+bool BinaryXmlReader::readStartElement(const Chunk &chunk)
+{
+    currentName.clear();
+    currentAttributes.clear();
+    if (chunk.headerSize + ElementExtensionSize > chunk.size) {
+        return false;
+    }
+    const uchar *extension = chunk.data + chunk.headerSize;
+    const quint32 available = chunk.size - chunk.headerSize;
+    const quint16 attributeStart = readUInt16(extension + 8);
+    const quint16 attributeSize = readUInt16(extension + 10);
+    const quint16 attributeCount = readUInt16(extension + 12);
+    if (attributeCount && (attributeSize < MinimumAttributeSize
+            || attributeStart + quint64(attributeSize) * attributeCount > available)) {
+        return false;
+    }
+    currentName = strings.at(readUInt32(extension + 4));
+
+    const quint32 resourceMapCount = resourceMap.isNull() ? 0 : (resourceMap.size - resourceMap.headerSize) / 4;
+    currentAttributes.reserve(attributeCount);
+    for (quint16 i = 0; i < attributeCount; ++i) {
+        const uchar *source = extension + attributeStart + i * attributeSize;
+        const quint32 nameIndex = readUInt32(source + 4);
+        const quint32 rawValue = readUInt32(source + 8);
+        Attribute attribute;
+        attribute.offset = static_cast<quint32>(source - reinterpret_cast<const uchar *>(data.constData()));
+        attribute.name = strings.at(nameIndex);
+        attribute.resourceId = nameIndex < resourceMapCount
+            ? readUInt32(resourceMap.data + resourceMap.headerSize + nameIndex * 4) : 0;
+        attribute.value.type = source[15];
+        attribute.value.data = readUInt32(source + 16);
+        if (attribute.value.type == Value::String) {
+            attribute.value.string = strings.at(attribute.value.data);
+        } else if (rawValue != NoIndex) {
+            attribute.value.string = strings.at(rawValue);
+        }
+        currentAttributes.append(attribute);
+    }
+    return true;
+}
@@ -0,0 +1,44 @@
+#ifndef BINARYXML_H
+#define BINARYXML_H
+
+#include "apk/binaryresource.h"
+#include <QByteArray>
+#include <QVector>
+
+// Forward-only reader of compiled XML documents (e.g. AndroidManifest.xml inside an APK).
+
+class BinaryXmlReader
+{
+public:
+    struct Attribute
+    {
+        QString name;
+        quint32 resourceId; // Framework attribute ID, 0 if unknown
+        quint32 offset; // Position of the attribute record in the document
+        BinaryResource::Value value;
+    };
+
+    explicit BinaryXmlReader(const QByteArray &data);
+
+    bool readNextStartElement();
+    const QString &name() const;
+    int depth() const;
+    const QVector<Attribute> &attributes() const;
+    const Attribute *attribute(quint32 resourceId, const QString &name) const;
+    quint32 stringPoolOffset() const;
+
+private:
+    bool readStartElement(const BinaryResource::Chunk &chunk);
+
+    QByteArray data;
+    BinaryResource::StringPool strings;
+    quint32 stringsOffset = 0;
+    BinaryResource::Chunk resourceMap;
+    quint32 position = 0;
+    quint32 end = 0;
+    int currentDepth = 0;
+    QString currentName;
+    QVector<Attribute> currentAttributes;
+};
+
+#endif // BINARYXML_H
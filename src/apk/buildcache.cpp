@@ -0,0 +1,121 @@
+#include "apk/buildcache.h"
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QDirIterator>
+#include <QSaveFile>
+#include <QtConcurrent/QtConcurrent>
+#include <functional>
+
+BuildCache::BuildCache(const QString &contentsPath) : contentsPath(contentsPath)
+{
+}
+
+void BuildCache::prepare()
+{
+    const QDir contents(contentsPath);
+    const QDir buildDirectory(contents.filePath("build/apk"));
+    const QStringList smaliDirectories = contents.entryList({"smali", "smali_*"}, QDir::Dirs | QDir::NoDotAndDotDot);
+
+    std::function<QByteArray(const QString &)> hash = [contents](const QString &directory) {
+        return hashDirectory(contents.filePath(directory));
+    };
+    const QList<QByteArray> results = QtConcurrent::blockingMapped<QList<QByteArray>>(smaliDirectories, hash);
+    const QMap<QString, QByteArray> previousHashes = load();
+
+    hashes.clear();
+    QSet<QString> dexFilenames;
+    for (int i = 0; i < smaliDirectories.size(); ++i) {
+        const QString &directory = smaliDirectories.at(i);
+        const QString dexFilename = getDexFilename(directory);
+        const QString dexPath = buildDirectory.filePath(dexFilename);
+        dexFilenames.insert(dexFilename);
+        hashes.insert(directory, results.at(i));
+        if (previousHashes.value(directory) == results.at(i) && QFile::exists(dexPath)) {
+            // Unchanged sources: make apktool treat the assembled dex as up to date
+            QFile dex(dexPath);
+            if (dex.open(QFile::ReadWrite)) {
+                dex.setFileTime(QDateTime::currentDateTime(), QFileDevice::FileModificationTime);
+            }
+        } else {
+            QFile::remove(dexPath);
+        }
+    }
+
+    // Remove dex files left from deleted smali directories, unless they are copied as is:
+    const QStringList builtDexFilenames = buildDirectory.entryList({"*.dex"}, QDir::Files);
+    for (const QString &dexFilename : builtDexFilenames) {
+        if (!dexFilenames.contains(dexFilename) && !contents.exists(dexFilename)) {
+            QFile::remove(buildDirectory.filePath(dexFilename));
+        }
+    }
+
+    // Changes in resources and apktool.yml are not tracked, so always rebuild them:
+    QFile::remove(buildDirectory.filePath("resources.arsc"));
+    QFile::remove(buildDirectory.filePath("AndroidManifest.xml"));
+
+    // Invalidate the cache until the build succeeds:
+    QFile::remove(getCachePath());
+}
+
+void BuildCache::commit()
+{
+    QSaveFile file(getCachePath());
+    if (!file.open(QSaveFile::WriteOnly)) {
+        return;
+    }
+    for (auto it = hashes.constBegin(); it != hashes.constEnd(); ++it) {
+        file.write(it.key().toUtf8() + ' ' + it.value().toHex() + '\n');
+    }
+    file.commit();
+}
+
+QByteArray BuildCache::hashDirectory(const QString &path)
+{
+    QStringList files;
+    QDirIterator it(path, QDir::Files | QDir::Hidden, QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        files.append(it.next());
+    }
+    files.sort();
+
+    QCryptographicHash hash(QCryptographicHash::Md5);
+    for (const QString &filePath : qAsConst(files)) {
+        hash.addData(filePath.mid(path.size()).toUtf8());
+        hash.addData("\0", 1);
+        QFile file(filePath);
+        if (file.open(QFile::ReadOnly)) {
+            hash.addData(&file);
+        }
+    }
+    return hash.result();
+}
+
+QString BuildCache::getDexFilename(const QString &smaliDirectory)
+{
+    // Same naming as apktool: "smali" -> "classes.dex", "smali_classes2" -> "classes2.dex"
+    if (smaliDirectory == "smali") {
+        return QStringLiteral("classes.dex");
+    }
+    return smaliDirectory.mid(smaliDirectory.indexOf('_') + 1) + ".dex";
+}
+
+QString BuildCache::getCachePath() const
+{
+    return QDir(contentsPath).filePath("build/smali.hashes");
+}
+
+QMap<QString, QByteArray> BuildCache::load() const
+{
+    QMap<QString, QByteArray> result;
+    QFile file(getCachePath());
+    if (file.open(QFile::ReadOnly)) {
+        while (!file.atEnd()) {
+            const QList<QByteArray> parts = file.readLine().trimmed().split(' ');
+            if (parts.size() == 2) {
+                result.insert(QString::fromUtf8(parts.at(0)), QByteArray::fromHex(parts.at(1)));
+            }
+        }
+    }
+    return result;
+}
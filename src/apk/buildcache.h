@@ -0,0 +1,26 @@
+#ifndef BUILDCACHE_H
+#define BUILDCACHE_H
+
+#include <QMap>
+#include <QString>
+
+class BuildCache
+{
+public:
+    BuildCache(const QString &contentsPath);
+
+    void prepare();
+    void commit();
+
+private:
+    static QByteArray hashDirectory(const QString &path);
+    static QString getDexFilename(const QString &smaliDirectory);
+
+    QString getCachePath() const;
+    QMap<QString, QByteArray> load() const;
+
+    QString contentsPath;
+    QMap<QString, QByteArray> hashes;
+};
+
+#endif // BUILDCACHE_H
@@ -15,6 +15,9 @@ void FileSystemModel::setSourceModel(ResourceItemsModel *model)
     if (model) {
         connect(model, &ResourceItemsModel::dataChanged, this,
                 [=](const QModelIndex &topLeft, const QModelIndex &bottomRight, const QVector<int> &roles) {
+            if (roles == QVector<int>{Qt::DecorationRole}) {
+                return; // Resource thumbnails are irrelevant for the file system view
+            }
             const auto fromIndex = index(ResourceModelIndex(topLeft).path());
             const auto toIndex = index(ResourceModelIndex(bottomRight).path());
             updated(fromIndex.sibling(fromIndex.row(), 0),
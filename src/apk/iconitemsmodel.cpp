@@ -5,6 +5,7 @@
 #include "base/utils.h"
 #include <QDebug>
 #include <QDir>
+#include <algorithm>
 
 IconItemsModel::IconItemsModel(QObject *parent) : QAbstractProxyModel(parent)
 {
@@ -54,16 +55,28 @@ ResourceItemsModel *IconItemsModel::sourceModel() const
 
 QIcon IconItemsModel::getIcon() const
 {
+    // Densities which are not decoded yet are added once ThumbnailService::thumbnailReady is emitted for them:
     QIcon icon;
+    for (const QString &path : getIconPaths()) {
+        const QPixmap pixmap = app->thumbnails.getThumbnail(path);
+        if (!pixmap.isNull()) {
+            icon.addPixmap(pixmap);
+        }
+    }
+    return icon;
+}
+
+QStringList IconItemsModel::getIconPaths() const
+{
+    QStringList paths;
     const auto iconNodes = applicationNode->getChildren();
     for (auto node : iconNodes) {
         auto iconNode = static_cast<IconNode *>(node);
         if (iconNode->iconType == TypeIcon) {
-            const QPixmap pixmap = Utils::iconToPixmap(proxyToSourceMap.value(iconNode).data(Qt::DecorationRole).value<QIcon>());
-            icon.addPixmap(pixmap);
+            paths.append(sourceModel()->getResourcePath(proxyToSourceMap.value(iconNode)));
         }
     }
-    return icon;
+    return paths;
 }
 
 QIcon IconItemsModel::getIcon(const QModelIndex &index) const
@@ -239,47 +252,17 @@ void IconItemsModel::sort(int column, Qt::SortOrder order)
     Q_UNUSED(column)
     Q_UNUSED(order)
 
-    const auto applicationIndex = index(ApplicationRow, 0);
-    const auto activitiesIndex = index(ActivitiesRow, 0);
-    const QList<QPersistentModelIndex> rootIndexes{applicationIndex, activitiesIndex};
-    emit layoutAboutToBeChanged(rootIndexes, QAbstractItemModel::VerticalSortHint);
-
-    auto comparator = [this](TreeNode *node1, TreeNode *node2) -> bool {
-        auto icon1 = static_cast<IconNode *>(node1);
-        auto icon2 = static_cast<IconNode *>(node2);
-        auto index1 = proxyToSourceMap.value(icon1);
-        auto index2 = proxyToSourceMap.value(icon2);
-        const bool swap = ![&]() -> bool {
-            if (icon1->iconType < icon2->iconType) { return true; }
-            if (icon2->iconType < icon1->iconType) { return false; }
-            auto dpi1 = index1.sibling(index1.row(), ResourceItemsModel::DpiColumn).data(ResourceItemsModel::SortRole);
-            auto dpi2 = index2.sibling(index2.row(), ResourceItemsModel::DpiColumn).data(ResourceItemsModel::SortRole);
-            if (dpi1 < dpi2) { return true; }
-            if (dpi2 < dpi1) { return false; }
-            return false;
-        }();
-        if (swap) {
-            changePersistentIndex(mapFromSource(index1), mapFromSource(index2));
-        }
-        return !swap;
-    };
-
-    auto &applicationIcons = applicationNode->getChildren();
-    std::sort(applicationIcons.begin(), applicationIcons.end(), comparator);
-
-    auto &activityScopes = activitiesNode->getChildren();
-    std::sort(activityScopes.begin(), activityScopes.end(), [](const TreeNode *node1, const TreeNode *node2) -> bool {
-        auto activity1 = static_cast<const ActivityNode *>(node1);
-        auto activity2 = static_cast<const ActivityNode *>(node2);
-        return activity1->scope->type() < activity2->scope->type();
-    });
-
-    for (auto activityNode : activityScopes) {
-        auto &activityIcons = activityNode->getChildren();
-        std::sort(activityIcons.begin(), activityIcons.end(), comparator);
+    emit layoutAboutToBeChanged({}, QAbstractItemModel::VerticalSortHint);
+    const QModelIndexList oldIndexes = persistentIndexList();
+    sortNodes();
+    QModelIndexList newIndexes;
+    newIndexes.reserve(oldIndexes.size());
+    for (const QModelIndex &oldIndex : oldIndexes) {
+        auto node = static_cast<TreeNode *>(oldIndex.internalPointer());
+        newIndexes.append(createIndex(node->row(), oldIndex.column(), node));
     }
-
-    emit layoutChanged(rootIndexes, QAbstractItemModel::VerticalSortHint);
+    changePersistentIndexList(oldIndexes, newIndexes);
+    emit layoutChanged({}, QAbstractItemModel::VerticalSortHint);
 }
 
 int IconItemsModel::rowCount(const QModelIndex &parent) const
@@ -314,86 +297,133 @@ bool IconItemsModel::removeRows(int row, int count, const QModelIndex &parent)
     return sourceModel()->removeRows(index.row(), count, index.parent());
 }
 
-bool IconItemsModel::appendIcon(const QPersistentModelIndex &iconIndex, ManifestScope *scope, IconType iconType)
-{
-    if (!sourceToProxyMap.contains(iconIndex)) {
-        switch (scope->type()) {
-        case ManifestScope::Type::Application: {
-            const int row = applicationNode->childCount();
-            beginInsertRows(index(ApplicationRow, 0), row, row);
-                auto iconNode = new IconNode(iconType);
-                applicationNode->addChild(iconNode);
-                sourceToProxyMap.insert(iconIndex, iconNode);
-                proxyToSourceMap.insert(iconNode, iconIndex);
-            endInsertRows();
-            sort();
-            return true;
+void IconItemsModel::buildScopeLookup()
+{
+    scopeLookup.clear();
+    for (int order = 0; order < scopes.size(); ++order) {
+        ManifestScope *scope = scopes.at(order);
+        const QList<QPair<ManifestAttribute, IconType>> attributes = {
+            {scope->icon(), TypeIcon},
+            {scope->roundIcon(), TypeRoundIcon},
+            {scope->banner(), TypeBanner},
+        };
+        for (const auto &attribute : attributes) {
+            const QString name = attribute.first.getResourceName();
+            const QString type = attribute.first.getResourceType();
+            if (name.isEmpty() || type.isEmpty()) {
+                continue;
+            }
+            QVector<IconUsage> &usages = scopeLookup[type + '/' + name];
+            // A resource is listed once per scope, the icon taking precedence over the round icon and the banner:
+            if (usages.isEmpty() || usages.last().scope != scope) {
+                usages.append({scope, order, attribute.second});
+            }
+        }
+    }
+}
+
+void IconItemsModel::addIcons(const QModelIndex &parent, int first, int last, bool bulk)
+{
+    for (int row = first; row <= last; ++row) {
+        const auto index = sourceModel()->index(row, 0, parent);
+        // Resources may be inserted along with their whole subtree:
+        const int childCount = sourceModel()->rowCount(index);
+        if (childCount) {
+            addIcons(index, 0, childCount - 1, bulk);
         }
-        case ManifestScope::Type::Activity: {
-            ActivityNode *activityNode = nullptr;
-            // Try to find existing activity node:
-            const auto iconNodes = activitiesNode->getChildren();
-            for (auto node : iconNodes) {
-                auto interimActivityNode = static_cast<ActivityNode *>(node);
-                if (scope == interimActivityNode->scope) {
-                    activityNode = interimActivityNode;
-                    break;
-                }
+        const auto resource = sourceModel()->getResourceFile(index);
+        if (resource && Utils::isDrawableResource(resource->getFilePath())) {
+            const auto usages = scopeLookup.value(resource->getType() + '/' + resource->getName());
+            for (const IconUsage &usage : usages) {
+                addIcon(index, usage, bulk);
             }
-            if (!activityNode) {
-                // Create new activity node:
-                const int row = activitiesNode->childCount();
-                beginInsertRows(index(ActivitiesRow, 0), row, row);
-                    activityNode = new ActivityNode(scope);
+        }
+    }
+}
+
+void IconItemsModel::addIcon(const QModelIndex &sourceIndex, const IconUsage &usage, bool bulk)
+{
+    const QPersistentModelIndex iconIndex(sourceIndex);
+    if (sourceToProxyMap.contains(iconIndex)) {
+        return;
+    }
+    const ManifestScope::Type scopeType = usage.scope->type();
+    if (scopeType != ManifestScope::Type::Application && scopeType != ManifestScope::Type::Activity) {
+        return;
+    }
+
+    const auto dpiIndex = sourceIndex.sibling(sourceIndex.row(), ResourceItemsModel::DpiColumn);
+    auto iconNode = new IconNode(usage.type, dpiIndex.data(ResourceItemsModel::SortRole).toInt());
+    sourceToProxyMap.insert(iconIndex, iconNode);
+    proxyToSourceMap.insert(iconNode, iconIndex);
+
+    TreeNode *parentNode = applicationNode;
+    if (scopeType == ManifestScope::Type::Activity) {
+        ActivityNode *activityNode = activityNodes.value(usage.scope, nullptr);
+        if (!activityNode) {
+            activityNode = new ActivityNode(usage.scope, usage.order);
+            activityNode->addChild(iconNode);
+            activityNodes.insert(usage.scope, activityNode);
+            if (bulk) {
+                activitiesNode->addChild(activityNode);
+            } else if (!activitiesNode->hasChildren()) {
+                beginInsertRows({}, ActivitiesRow, ActivitiesRow);
                     activitiesNode->addChild(activityNode);
                 endInsertRows();
+            } else {
+                const auto &activities = activitiesNode->getChildren();
+                const int row = std::upper_bound(activities.begin(), activities.end(), activityNode, activityLessThan) - activities.begin();
+                beginInsertRows(index(ActivitiesRow, 0), row, row);
+                    activitiesNode->insertChild(row, activityNode);
+                endInsertRows();
             }
-            const QModelIndex activityIndex = index(activityNode->row(), 0, index(ActivitiesRow, 0));
-            const int row = activityNode->childCount();
-            beginInsertRows(activityIndex, row, row);
-                auto iconNode = new IconNode(iconType);
-                activityNode->addChild(iconNode);
-                sourceToProxyMap.insert(iconIndex, iconNode);
-                proxyToSourceMap.insert(iconNode, iconIndex);
-            endInsertRows();
-            sort();
-            return true;
-        }
+            return;
         }
+        parentNode = activityNode;
+    }
+
+    if (bulk) {
+        // Sorted at once when the population is over
+        parentNode->addChild(iconNode);
+        return;
     }
-    return false;
+    const auto &icons = parentNode->getChildren();
+    const int row = std::upper_bound(icons.begin(), icons.end(), iconNode, iconLessThan) - icons.begin();
+    const QModelIndex parentIndex = parentNode == applicationNode
+        ? index(ApplicationRow, 0)
+        : createIndex(parentNode->row(), 0, parentNode);
+    beginInsertRows(parentIndex, row, row);
+        parentNode->insertChild(row, iconNode);
+    endInsertRows();
 }
 
-void IconItemsModel::populateFromSource(const QModelIndex &parent)
+void IconItemsModel::sortNodes()
 {
-    const int rows = sourceModel()->rowCount(parent);
-    sourceRowsInserted(parent, 0, rows);
-    for (int row = 0; row < rows; ++row) {
-        populateFromSource(sourceModel()->index(row, 0, parent));
+    applicationNode->sortChildren(iconLessThan);
+    activitiesNode->sortChildren(activityLessThan);
+    for (auto activityNode : activitiesNode->getChildren()) {
+        activityNode->sortChildren(iconLessThan);
     }
 }
 
-void IconItemsModel::sourceRowsInserted(const QModelIndex &parent, int first, int last)
+bool IconItemsModel::iconLessThan(const TreeNode *node1, const TreeNode *node2)
 {
-    for (int row = first; row <= last; ++row) {
-        const auto index = sourceModel()->index(row, 0, parent);
-        const auto resource = sourceModel()->getResourceFile(index);
-        if (resource && Utils::isDrawableResource(resource->getFilePath())) {
-            auto resourceName = resource->getName();
-            auto resourceType = resource->getType();
-            if (!resourceName.isEmpty() && !resourceType.isEmpty()) {
-                for (ManifestScope *scope : qAsConst(scopes)) {
-                    if (resourceName == scope->icon().getResourceName() && resourceType == scope->icon().getResourceType()) {
-                        appendIcon(index, scope, TypeIcon);
-                    } else if (resourceName == scope->roundIcon().getResourceName() && resourceType == scope->roundIcon().getResourceType()) {
-                        appendIcon(index, scope, TypeRoundIcon);
-                    } else if (resourceName == scope->banner().getResourceName() && resourceType == scope->banner().getResourceType()) {
-                        appendIcon(index, scope, TypeBanner);
-                    }
-                }
-            }
-        }
+    auto icon1 = static_cast<const IconNode *>(node1);
+    auto icon2 = static_cast<const IconNode *>(node2);
+    if (icon1->iconType != icon2->iconType) {
+        return icon1->iconType < icon2->iconType;
     }
+    return icon1->dpiRank < icon2->dpiRank;
+}
+
+bool IconItemsModel::activityLessThan(const TreeNode *node1, const TreeNode *node2)
+{
+    return static_cast<const ActivityNode *>(node1)->order < static_cast<const ActivityNode *>(node2)->order;
+}
+
+void IconItemsModel::sourceRowsInserted(const QModelIndex &parent, int first, int last)
+{
+    addIcons(parent, first, last, false);
 }
 
 void IconItemsModel::sourceRowsAboutToBeRemoved(const QModelIndex &parent, int first, int last)
@@ -413,9 +443,13 @@ void IconItemsModel::sourceRowsAboutToBeRemoved(const QModelIndex &parent, int f
     }
 }
 
-void IconItemsModel::sourceDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight)
+void IconItemsModel::sourceDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight, const QVector<int> &roles)
 {
-    emit dataChanged(mapFromSource(topLeft), mapFromSource(bottomRight));
+    const QModelIndex proxyTopLeft = mapFromSource(topLeft);
+    const QModelIndex proxyBottomRight = mapFromSource(bottomRight);
+    if (proxyTopLeft.isValid() && proxyBottomRight.isValid()) {
+        emit dataChanged(proxyTopLeft, proxyBottomRight, roles);
+    }
 }
 
 void IconItemsModel::sourceModelReset()
@@ -423,9 +457,15 @@ void IconItemsModel::sourceModelReset()
     beginResetModel();
     sourceToProxyMap.clear();
     proxyToSourceMap.clear();
+    activityNodes.clear();
     applicationNode->removeChildren();
     activitiesNode->removeChildren();
-    populateFromSource();
+    buildScopeLookup();
+    const int rows = sourceModel()->rowCount();
+    if (!scopeLookup.isEmpty() && rows) {
+        addIcons({}, 0, rows - 1, true);
+        sortNodes();
+    }
     endResetModel();
 }
 
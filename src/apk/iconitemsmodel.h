@@ -40,6 +40,7 @@ public:
     ResourceItemsModel *sourceModel() const;
 
     QIcon getIcon() const;
+    QStringList getIconPaths() const;
     QIcon getIcon(const QModelIndex &index) const;
     QString getIconPath(const QModelIndex &index) const;
     QString getIconCaption(const QModelIndex &index) const;
@@ -64,26 +65,42 @@ public:
 private:
     struct IconNode : public TreeNode
     {
-        IconNode(IconType iconType) : iconType(iconType) {}
+        IconNode(IconType iconType, int dpiRank) : iconType(iconType), dpiRank(dpiRank) {}
         void addChild(TreeNode *node) = delete;
         const IconType iconType;
+        const int dpiRank;
     };
 
     struct ActivityNode : public TreeNode
     {
-        explicit ActivityNode(ManifestScope *scope) : scope(scope) {}
+        ActivityNode(ManifestScope *scope, int order) : scope(scope), order(order) {}
         void addChild(IconNode *node);
         const ManifestScope *scope;
+        const int order; // Position of the scope in the manifest
     };
 
-    bool appendIcon(const QPersistentModelIndex &index, ManifestScope *scope, IconType type = TypeIcon);
-    void populateFromSource(const QModelIndex &parent = {});
+    struct IconUsage
+    {
+        ManifestScope *scope;
+        int order;
+        IconType type;
+    };
+
+    void buildScopeLookup();
+    void addIcons(const QModelIndex &parent, int first, int last, bool bulk);
+    void addIcon(const QModelIndex &sourceIndex, const IconUsage &usage, bool bulk);
+    void sortNodes();
+    static bool iconLessThan(const TreeNode *node1, const TreeNode *node2);
+    static bool activityLessThan(const TreeNode *node1, const TreeNode *node2);
+
     void sourceRowsInserted(const QModelIndex &parent, int first, int last);
     void sourceRowsAboutToBeRemoved(const QModelIndex &parent, int first, int last);
-    void sourceDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight);
+    void sourceDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight, const QVector<int> &roles);
     void sourceModelReset();
 
     QList<ManifestScope *> scopes;
+    QHash<QString, QVector<IconUsage>> scopeLookup; // Resource "type/name" to the scopes using it
+    QHash<const ManifestScope *, ActivityNode *> activityNodes;
     QHash<QPersistentModelIndex, IconNode *> sourceToProxyMap;
     QHash<IconNode *, QPersistentModelIndex> proxyToSourceMap;
     TreeNode *root;
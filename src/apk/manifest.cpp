@@ -1,13 +1,25 @@
 #include "apk/manifest.h"
 #include <QDebug>
 #include <QFile>
+#include <QSaveFile>
 #include <QTextStream>
 
+namespace
+{
+    // Delay (in ms) after the last edit before the changes are written to disk
+    const int FlushDelay = 500;
+}
 
 Manifest::Manifest(const QString &xmlPath, const QString &ymlPath)
     : xmlPath(xmlPath)
     , ymlPath(ymlPath)
 {
+    flushTimer.setSingleShot(true);
+    flushTimer.setInterval(FlushDelay);
+    QObject::connect(&flushTimer, &QTimer::timeout, [this]() {
+        flush();
+    });
+
     // XML:
 
     QFile xmlFile(xmlPath);
@@ -64,6 +76,7 @@ Manifest::Manifest(const QString &xmlPath, const QString &ymlPath)
 
 Manifest::~Manifest()
 {
+    flush();
     qDeleteAll(scopes);
 }
 
@@ -96,7 +109,8 @@ bool Manifest::setApplicationLabel(const QString &value)
 {
     auto label = applicationScope->label();
     label.setValue(value);
-    return saveXml();
+    setXmlModified();
+    return true;
 }
 
 bool Manifest::setMinSdk(int value)
@@ -104,7 +118,8 @@ bool Manifest::setMinSdk(int value)
     value = qMax(0, value);
     minSdk = value;
     ymlContents.replace(regexMinSdk, QString::number(value));
-    return saveYml();
+    setYmlModified();
+    return true;
 }
 
 bool Manifest::setTargetSdk(int value)
@@ -112,7 +127,8 @@ bool Manifest::setTargetSdk(int value)
     value = qMax(1, value);
     targetSdk = value;
     ymlContents.replace(regexTargetSdk, QString::number(value));
-    return saveYml();
+    setYmlModified();
+    return true;
 }
 
 bool Manifest::setVersionCode(int value)
@@ -120,18 +136,24 @@ bool Manifest::setVersionCode(int value)
     value = qMax(0, value);
     versionCode = value;
     ymlContents.replace(regexVersionCode, QString::number(value));
-    return saveYml();
+    setYmlModified();
+    return true;
 }
 
 bool Manifest::setVersionName(const QString &value)
 {
     versionName = value;
     ymlContents.replace(regexVersionName, value);
-    return saveYml();
+    setYmlModified();
+    return true;
 }
 
 bool Manifest::setPackageName(const QString &newPackageName)
 {
+    // The file is modified directly, so pending edits have to be written first:
+    if (!flush()) {
+        return false;
+    }
     const auto originalPackageName = getPackageName();
     QFile xmlFile(xmlPath);
     if (!xmlFile.open(QFile::ReadWrite)) {
@@ -171,39 +193,76 @@ Permission Manifest::addPermission(const QString &permission)
     auto element = xmlDom.createElement("uses-permission");
     element.setAttribute("android:name", permission);
     manifestNode.appendChild(element);
-    saveXml();
+    setXmlModified();
     return Permission(element);
 }
 
 void Manifest::removePermission(const Permission &permission)
 {
     manifestNode.removeChild(permission.getNode());
-    saveXml();
+    setXmlModified();
+}
+
+bool Manifest::flush()
+{
+    flushTimer.stop();
+    if (xmlModified && saveXml()) {
+        xmlModified = false;
+    }
+    if (ymlModified && saveYml()) {
+        ymlModified = false;
+    }
+    return !hasPendingChanges();
+}
+
+bool Manifest::hasPendingChanges() const
+{
+    return xmlModified || ymlModified;
+}
+
+void Manifest::setXmlModified()
+{
+    xmlModified = true;
+    flushTimer.start();
+}
+
+void Manifest::setYmlModified()
+{
+    ymlModified = true;
+    flushTimer.start();
 }
 
 bool Manifest::saveXml()
 {
-    QFile xmlFile(xmlPath);
+    QSaveFile xmlFile(xmlPath);
     if (!xmlFile.open(QFile::WriteOnly)) {
         qWarning() << "Error: Could not save AndroidManifest.xml";
         return false;
     }
-    xmlFile.resize(0);
     QTextStream stream(&xmlFile);
     xmlDom.save(stream, 4);
+    stream.flush();
+    if (!xmlFile.commit()) {
+        qWarning() << "Error: Could not save AndroidManifest.xml";
+        return false;
+    }
     return true;
 }
 
 bool Manifest::saveYml()
 {
-    QFile ymlFile(ymlPath);
+    QSaveFile ymlFile(ymlPath);
     if (!ymlFile.open(QFile::WriteOnly)) {
         qWarning() << "Error: Could not save apktool.yml";
         return false;
     }
-    ymlFile.resize(0);
     QTextStream stream(&ymlFile);
     stream.setCodec("UTF-8");
     stream << ymlContents;
+    stream.flush();
+    if (!ymlFile.commit()) {
+        qWarning() << "Error: Could not save apktool.yml";
+        return false;
+    }
     return true;
 }
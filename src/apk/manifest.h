@@ -3,6 +3,7 @@
 
 #include <QDomDocument>
 #include <QRegularExpression>
+#include <QTimer>
 #include "apk/manifestscope.h"
 #include "apk/permission.h"
 
@@ -29,13 +30,23 @@ public:
     Permission addPermission(const QString &permission);
     void removePermission(const Permission &permission);
 
+    bool flush();
+    bool hasPendingChanges() const;
+
     QList<ManifestScope *> scopes;
     ManifestScope *applicationScope;
 
 private:
+    void setXmlModified();
+    void setYmlModified();
     bool saveXml();
     bool saveYml();
 
+    // Edits are kept in memory and written to disk once they settle down:
+    QTimer flushTimer;
+    bool xmlModified = false;
+    bool ymlModified = false;
+
     QString xmlPath;
     QDomDocument xmlDom;
 
@@ -1,30 +1,201 @@
 #include "apk/package.h"
 #include "apk/apkcloner.h"
+#include "apk/apkpatch.h"
+#include "apk/buildcache.h"
+#include "apk/resourcemodelindex.h"
+#include "apk/resourcetable.h"
+#include "apk/smaliindex.h"
+#include "apk/valuesindex.h"
 #include "base/application.h"
+#include "base/filecatalog.h"
+#include "base/searchindex.h"
 #include "base/settings.h"
 #include "base/utils.h"
+#include "base/ziparchive.h"
 #include "tools/adb.h"
 #include "tools/apktool.h"
 #include "tools/apksigner.h"
 #include "tools/keystore.h"
 #include "tools/zipalign.h"
 #include <QFutureWatcher>
+#include <QRegularExpression>
+#include <QtConcurrent/QtConcurrent>
 #include <QUuid>
 #include <QDebug>
 
+namespace
+{
+    bool isSafeEntryName(const QString &name)
+    {
+        // Skip entries which would end up outside of the contents directory:
+        QString path = name;
+        if (path.endsWith('/')) {
+            path.chop(1);
+        }
+        return !path.isEmpty() && !path.contains('\\') && QDir::cleanPath(path) == path
+            && !path.startsWith("../") && path != ".." && QDir::isRelativePath(path);
+    }
+
+    // Returns the path apktool has decoded the APK entry to, or an empty string if it can't be found.
+    // Resources may be renamed (obfuscated names are restored from the resource table)
+    // and moved (implied SDK version qualifiers like "-v4" are dropped).
+    QString getDecodedPath(const QDir &contents, const QString &entryName, const QHash<QString, QString> &resourceNames)
+    {
+        QStringList candidates{entryName};
+        if (entryName.startsWith("res/")) {
+            const QString fileName = entryName.section('/', -1);
+            QStringList directories;
+            if (entryName.count('/') == 2) {
+                const QString directory = entryName.section('/', 1, 1);
+                QString unversioned = directory;
+                unversioned.remove(QRegularExpression("-v\\d+$"));
+                directories << directory;
+                if (unversioned != directory) {
+                    directories << unversioned;
+                    candidates << QString("res/%1/%2").arg(unversioned, fileName);
+                }
+            }
+            const QString resourceName = resourceNames.value(entryName);
+            if (!resourceName.isEmpty()) {
+                const QString type = resourceName.section('/', 0, 0);
+                const QString name = resourceName.section('/', 1);
+                const int extensionStart = fileName.indexOf('.'); // Including nine-patch ".9.png"
+                const QString decodedName = name + (extensionStart != -1 ? fileName.mid(extensionStart) : QString());
+                for (const QString &directory : qAsConst(directories)) {
+                    const QString qualifiers = directory.section('-', 1);
+                    candidates << QString("res/%1%2/%3").arg(type, qualifiers.isEmpty() ? QString() : '-' + qualifiers, decodedName);
+                }
+                if (directories.isEmpty()) {
+                    // Flattened obfuscated paths have no qualifiers, the decoded file has to be unique:
+                    const QDir resources(contents.filePath("res"));
+                    QStringList matches;
+                    for (const QString &directory : resources.entryList({type, type + "-*"}, QDir::Dirs | QDir::NoDotAndDotDot)) {
+                        if (QFile::exists(resources.filePath(directory + '/' + decodedName))) {
+                            matches << QString("res/%1/%2").arg(directory, decodedName);
+                        }
+                    }
+                    if (matches.size() == 1) {
+                        candidates << matches.first();
+                    }
+                }
+            }
+        } else {
+            // Files apktool doesn't recognize are kept aside:
+            candidates << "unknown/" + entryName;
+        }
+        for (const QString &candidate : qAsConst(candidates)) {
+            const QString path = contents.filePath(candidate);
+            if (QFile::exists(path)) {
+                return path;
+            }
+        }
+        return QString();
+    }
+}
+
 Package::Package(const QString &path)
 {
     originalPath = QFileInfo(path).absoluteFilePath();
     manifest = nullptr;
+    fileCatalog = QSharedPointer<FileCatalog>::create();
+    searchIndex = QSharedPointer<SearchIndex>::create(fileCatalog);
+    valuesIndex = QSharedPointer<ValuesIndex>::create();
+    smaliIndex = QSharedPointer<SmaliIndex>::create();
+    apkPatch = QSharedPointer<ApkPatch>::create();
     filesystemModel.setSourceModel(&resourcesModel);
     iconsProxy.setSourceModel(&resourcesModel);
     logModel.setExclusiveLoading(true);
     connect(&state, &PackageState::changed, this, &Package::stateUpdated);
+
+    auto setModified = [this]() {
+        if (state.isUnpacked() || state.isQuickOpened()) {
+            state.setModified(true);
+        }
+    };
+    // Thumbnails being decoded are not modifications:
+    auto setModifiedUnlessDecoration = [=](const QModelIndex &, const QModelIndex &, const QVector<int> &roles) {
+        if (roles != QVector<int>{Qt::DecorationRole}) {
+            setModified();
+            apkPatch->requireRebuild();
+        }
+    };
+    connect(&resourcesModel, &ResourceItemsModel::dataChanged, this, setModifiedUnlessDecoration);
+    connect(&resourcesModel, &ResourceItemsModel::rowsRemoved, this, [=]() {
+        setModified();
+        apkPatch->requireRebuild();
+    });
+    connect(&resourcesModel, &ResourceItemsModel::dataChanged, this,
+            [=](const QModelIndex &topLeft, const QModelIndex &, const QVector<int> &roles) {
+        if (state.isUnpacked() && roles != QVector<int>{Qt::DecorationRole}) {
+            updateIndexes({ResourceModelIndex(topLeft).path()});
+        }
+    });
+    connect(&filesystemModel, &QFileSystemModel::dataChanged, this, [=](const QModelIndex &topLeft) {
+        // Quick-open placeholders being extracted are not modifications:
+        if (state.isUnpacked()) {
+            state.setModified(true);
+            updateIndexes({filesystemModel.filePath(topLeft)});
+        }
+    });
+    connect(&iconsProxy, &IconItemsModel::dataChanged, this, setModifiedUnlessDecoration);
+    connect(&app->thumbnails, &ThumbnailService::thumbnailReady, this, [this](const QString &path) {
+        // The application icon is decoded in the background, the APK thumbnail is shown until then:
+        if (iconsProxy.getIconPaths().contains(path)) {
+            emit stateUpdated();
+        }
+    });
+    connect(&manifestModel, &ManifestModel::dataChanged, this,
+            [=](const QModelIndex &topLeft, const QModelIndex &bottomRight, const QVector<int> &roles) {
+        if (!(roles.count() == 1 && roles.contains(Qt::UserRole))) {
+            setModified();
+        }
+        // Single rows are changed by the user, the whole range is reported on initialization:
+        if (!roles.isEmpty() || topLeft.row() != bottomRight.row()) {
+            return;
+        }
+        switch (topLeft.row()) {
+        case ManifestModel::ApplicationLabelRow:
+            apkPatch->setApplicationLabel(manifestModel.getApplicationLabel());
+            break;
+        case ManifestModel::VersionCodeRow:
+            apkPatch->setVersionCode(manifestModel.getVersionCode());
+            break;
+        case ManifestModel::VersionNameRow:
+            apkPatch->setVersionName(manifestModel.getVersionName());
+            break;
+        case ManifestModel::MinimumSdkRow:
+            apkPatch->setMinSdk(manifestModel.getMinimumSdk());
+            break;
+        case ManifestModel::TargetSdkRow:
+            apkPatch->setTargetSdk(manifestModel.getTargetSdk());
+            break;
+        }
+    });
+
+    // The binary manifest already provides the title and icon, no need to wait for the APK to be opened:
+    auto infoFuture = QtConcurrent::run([path]() {
+        return ApkInfo(path);
+    });
+    auto infoWatcher = new QFutureWatcher<ApkInfo>(this);
+    connect(infoWatcher, &QFutureWatcher<ApkInfo>::finished, this, [=]() {
+        info = infoWatcher->result();
+        if (!info.getIcon().isNull()) {
+            thumbnail = QIcon(QPixmap::fromImage(info.getIcon()));
+        }
+        infoWatcher->deleteLater();
+        emit stateUpdated();
+        // Listed as recent without waiting for the APK to be opened or unpacked:
+        if (info.isValid()) {
+            app->settings->addRecentApk(this);
+        }
+    });
+    infoWatcher->setFuture(infoFuture);
 }
 
 Package::~Package()
 {
     delete manifest;
+    delete archive;
 
     if (!contentsPath.isEmpty()) {
         qDebug() << qPrintable(QString("Removing \"%1\"...\n").arg(contentsPath));
@@ -51,12 +222,46 @@ QString Package::getContentsPath() const
 
 QString Package::getPackageName() const
 {
-    return manifest->getPackageName();
+    return manifest ? manifest->getPackageName() : info.getPackageName();
+}
+
+QString Package::getApplicationLabel() const
+{
+    const QString label = manifest ? manifestModel.getApplicationLabel() : QString();
+    QString type;
+    QString name;
+    if (ValuesIndex::parseReference(label, type, name)) {
+        // Decoded label is a reference to a string resource, the default locale is preferred:
+        QString value;
+        if (type == "string") {
+            for (const auto &entry : valuesIndex->find(type, name)) {
+                if (!entry.value.isEmpty() && !entry.value.startsWith('@') && (value.isEmpty() || entry.qualifiers.isEmpty())) {
+                    value = entry.value;
+                }
+            }
+        }
+        // The values may still be indexed:
+        return !value.isEmpty() ? value : info.getApplicationLabel();
+    }
+    return !label.isEmpty() && !label.startsWith('@') ? label : info.getApplicationLabel();
+}
+
+QString Package::getVersionName() const
+{
+    return manifest ? manifest->getVersionName() : info.getVersionName();
+}
+
+int Package::getVersionCode() const
+{
+    return manifest ? manifest->getVersionCode() : info.getVersionCode();
 }
 
 QIcon Package::getThumbnail() const
 {
-    QIcon thumbnail = iconsProxy.getIcon();
+    const QIcon icon = iconsProxy.getIcon();
+    if (!icon.isNull()) {
+        return icon;
+    }
     return !thumbnail.isNull() ? thumbnail : QIcon::fromTheme("apk-editor-studio");
 }
 
@@ -70,6 +275,51 @@ bool Package::hasSourcesUnpacked() const
     return withSources;
 }
 
+bool Package::extractFile(const QString &path)
+{
+    if (!archive || pendingEntries.isEmpty()) {
+        return true;
+    }
+
+    const QString entryName = QDir::fromNativeSeparators(QDir(contentsPath).relativeFilePath(path));
+    if (!pendingEntries.contains(entryName)) {
+        return true;
+    }
+
+    // Placeholder has already been replaced by the user:
+    if (QFileInfo(path).size() != 0) {
+        pendingEntries.remove(entryName);
+        return true;
+    }
+
+    const ZipArchive::Entry *entry = archive->getEntry(entryName);
+    if (!entry || !archive->extract(*entry, path)) {
+        qWarning() << "Error: Could not extract" << entryName;
+        return false;
+    }
+    pendingEntries.remove(entryName);
+    return true;
+}
+
+void Package::updateIndexes(const QStringList &paths)
+{
+    // Files written by the editor (saved, replaced) are re-indexed without rescanning the project:
+    QStringList filePaths;
+    for (const QString &path : paths) {
+        if (!path.isEmpty()) {
+            filePaths.append(path);
+        }
+    }
+    if (filePaths.isEmpty()) {
+        return;
+    }
+    searchIndex->update(filePaths);
+    for (const QString &path : qAsConst(filePaths)) {
+        valuesIndex->update(path);
+        smaliIndex->update(path);
+    }
+}
+
 void Package::setApplicationIcon(const QString &path, QWidget *parent)
 {
     iconsProxy.replaceApplicationIcons(path, parent);
@@ -82,6 +332,11 @@ void Package::setPackageName(const QString &packageName)
         return;
     }
 
+    // The cloner rewrites the manifest on disk:
+    if (manifest) {
+        manifest->flush();
+    }
+
     auto cloner = new ApkCloner(getContentsPath(), getPackageName(), packageName, this);
     connect(cloner, &ApkCloner::started, this, &Package::cloningStarted);
     connect(cloner, &ApkCloner::progressed, this, &Package::cloningProgressed);
@@ -89,7 +344,10 @@ void Package::setPackageName(const QString &packageName)
     connect(cloner, &ApkCloner::finished, this, [=](bool success) {
         if (success) {
             state.setModified(true);
+            apkPatch->requireRebuild();
             manifest->setPackageName(packageName);
+            // Smali trees and resources have been renamed and rewritten throughout:
+            buildIndexes();
         }
         cloner->deleteLater();
     });
@@ -113,14 +371,36 @@ Commands *Package::createCommandChain()
     return command;
 }
 
+Command *Package::createQuickOpenCommand()
+{
+    contentsPath = createContentsDirectory();
+    Q_ASSERT(!contentsPath.isEmpty());
+
+    delete archive;
+    archive = new ZipArchive(originalPath);
+    pendingEntries.clear();
+
+    auto command = new QuickOpenCommand(this);
+    connect(command, &Command::started, this, [=]() {
+        qDebug() << qPrintable(QString("Opening\n  from: %1\n    to: %2\n").arg(getOriginalPath(), getContentsPath()));
+        logModel.add(tr("Opening APK..."));
+        state.setCurrentStatus(PackageState::Status::Unpacking);
+    });
+    connect(command, &Command::finished, this, [=](bool success) {
+        if (!success) {
+            logModel.add(tr("Error opening APK."), LogEntry::Error);
+        }
+        state.setQuickOpened(success);
+    });
+    return command;
+}
+
 Command *Package::createUnpackCommand()
 {
-    QString target;
-    do {
-        const QString uuid = QUuid::createUuid().toString();
-        target = QDir::toNativeSeparators(QString("%1/%2").arg(Apktool::getOutputPath(), uuid));
-    } while (target.isEmpty() || QDir(target).exists());
+    // Quick-opened package is upgraded to a full unpack in a new directory:
+    const QString quickContentsPath = state.isQuickOpened() ? contentsPath : QString();
 
+    const QString target = createContentsDirectory();
     const QString source(getOriginalPath());
     const QString frameworks = Apktool::getFrameworksPath();
 
@@ -130,7 +410,6 @@ Command *Package::createUnpackCommand()
     withNoDebugInfo = app->settings->getDecompileNoDebugInfo();
     withOnlyMainClasses = app->settings->getDecompileOnlyMainClasses();
 
-    QDir().mkpath(target);
     QDir().mkpath(frameworks);
 
     contentsPath = target;
@@ -139,6 +418,9 @@ Command *Package::createUnpackCommand()
     auto apktoolDecode = new Apktool::Decode(source, target, frameworks, withResources, withSources, withNoDebugInfo, withOnlyMainClasses, withBrokenResources);
     connect(apktoolDecode, &Command::finished, this, [=](bool success) {
         if (success) {
+            if (!quickContentsPath.isEmpty()) {
+                applyQuickOpenChanges(quickContentsPath);
+            }
             filesystemModel.setRootPath(getContentsPath());
         } else {
             logModel.add(tr("Error unpacking APK."), apktoolDecode->output(), LogEntry::Error);
@@ -151,25 +433,21 @@ Command *Package::createUnpackCommand()
     connect(command, &Command::started, this, [=]() {
         qDebug() << qPrintable(QString("Unpacking\n  from: %1\n    to: %2\n").arg(source, target));
         logModel.add(tr("Unpacking APK..."));
+        state.setQuickOpened(false);
         state.setCurrentStatus(PackageState::Status::Unpacking);
     });
     connect(command, &Command::finished, this, [=](bool success) {
-        if (success) {
-            connect(&resourcesModel, &ResourceItemsModel::dataChanged, this, [=]() {
-                state.setModified(true);
-            });
-            connect(&filesystemModel, &QFileSystemModel::dataChanged, this, [=]() {
-                state.setModified(true);
-            });
-            connect(&iconsProxy, &IconItemsModel::dataChanged, this, [=]() {
-                state.setModified(true);
-            });
-            connect(&manifestModel, &ManifestModel::dataChanged, this,
-                    [=](const QModelIndex &, const QModelIndex &, const QVector<int> &roles) {
-                if (!(roles.count() == 1 && roles.contains(Qt::UserRole))) {
-                    state.setModified(true);
-                }
-            });
+        if (!quickContentsPath.isEmpty()) {
+            if (success) {
+                delete archive;
+                archive = nullptr;
+                pendingEntries.clear();
+                Utils::rmdir(quickContentsPath, QFile::exists(QString("%1/%2").arg(quickContentsPath, "AndroidManifest.xml")));
+            } else {
+                Utils::rmdir(target, QFile::exists(QString("%1/%2").arg(target, "AndroidManifest.xml")));
+                contentsPath = quickContentsPath;
+                state.setQuickOpened(true);
+            }
         }
         state.setUnpacked(success);
     });
@@ -177,15 +455,34 @@ Command *Package::createUnpackCommand()
 }
 
 Command *Package::createPackCommand(const QString &target)
+{
+    // Simple edits are written directly to the compiled files of the original APK:
+    if (apkPatch->isApplicable() && !app->settings->getMakeDebuggable()) {
+        return new PatchCommand(this, target, createBuildCommand(target));
+    }
+    return createBuildCommand(target);
+}
+
+Command *Package::createBuildCommand(const QString &target)
 {
     const QString source = getContentsPath();
     const QString frameworks = Apktool::getFrameworksPath();
     const bool aapt2 = app->settings->getUseAapt2();
     const bool debuggable = app->settings->getMakeDebuggable();
 
-    auto apktoolBuild = new Apktool::Build(source, target, frameworks, aapt2, debuggable);
+    // Smali directories with unchanged contents reuse the dex files from the previous build:
+    auto cache = QSharedPointer<BuildCache>::create(source);
 
-    connect(apktoolBuild, &Command::started, this, [=]() {
+    auto command = new Commands(this);
+    auto prepareBuild = new PrepareBuildCommand(cache);
+    auto apktoolBuild = new Apktool::Build(source, target, frameworks, aapt2, debuggable, true);
+    command->add(prepareBuild, true);
+    command->add(apktoolBuild, true);
+
+    connect(command, &Command::started, this, [=]() {
+        if (manifest) {
+            manifest->flush();
+        }
         qDebug() << qPrintable(QString("Packing\n  from: %1\n    to: %2\n").arg(source, target));
         logModel.add(tr("Packing APK..."));
         state.setCurrentStatus(PackageState::Status::Packing);
@@ -193,14 +490,16 @@ Command *Package::createPackCommand(const QString &target)
 
     connect(apktoolBuild, &Command::finished, this, [=](bool success) {
         if (success) {
+            cache->commit();
             originalPath = target;
             state.setModified(false);
+            resetPatch();
         } else {
             logModel.add(tr("Error packing APK."), apktoolBuild->output(), LogEntry::Error);
         }
     });
 
-    return apktoolBuild;
+    return command;
 }
 
 Command *Package::createZipalignCommand(const QString &apk)
@@ -257,6 +556,152 @@ Command *Package::createInstallCommand(const QString &serial, const QString &apk
     return install;
 }
 
+void Package::schedule(Commands *command)
+{
+    // The command chain is started once a slot is available in the global scheduler:
+    logModel.clear();
+    logModel.add(tr("Waiting in queue..."));
+    state.setCurrentStatus(PackageState::Status::Queued);
+    app->scheduler.enqueue(command, this);
+}
+
+QString Package::createContentsDirectory() const
+{
+    QString target;
+    do {
+        const QString uuid = QUuid::createUuid().toString();
+        target = QDir::toNativeSeparators(QString("%1/%2").arg(Apktool::getOutputPath(), uuid));
+    } while (target.isEmpty() || QDir(target).exists());
+    QDir().mkpath(target);
+    return target;
+}
+
+void Package::buildIndexes()
+{
+    const QString contentsPath = getContentsPath();
+    searchIndex->build(QDir::cleanPath(contentsPath));
+    valuesIndex->build(contentsPath + "/res");
+    smaliIndex->build(contentsPath);
+}
+
+void Package::resetPatch()
+{
+    apkPatch->clear();
+    updatePatchSnapshot();
+}
+
+void Package::updatePatchSnapshot()
+{
+    const QString contentsPath = this->contentsPath;
+    auto future = QtConcurrent::run([contentsPath]() {
+        return ApkPatch::createSnapshot(contentsPath);
+    });
+    auto watcher = new QFutureWatcher<ApkPatch::Snapshot>(this);
+    connect(watcher, &QFutureWatcher<ApkPatch::Snapshot>::finished, this, [=]() {
+        apkPatch->setSnapshot(watcher->result());
+        watcher->deleteLater();
+    });
+    watcher->setFuture(future);
+}
+
+void Package::applyQuickOpenChanges(const QString &quickContentsPath)
+{
+    // Carry over the files which were replaced or removed before the full unpack.
+    // The decoded contents differ from the original APK then, so the patch can't be applied to it.
+    const QDir source(quickContentsPath);
+    const QDir target(contentsPath);
+    const ZipArchive::Entry *resourcesEntry = archive->getEntry("resources.arsc");
+    const ResourceTable resources(resourcesEntry ? archive->read(*resourcesEntry) : QByteArray());
+    const QHash<QString, QString> resourceNames = resources.getFileNames();
+    QStringList skipped;
+    for (const ZipArchive::Entry &entry : archive->getEntries()) {
+        if (entry.isDirectory() || !isSafeEntryName(entry.name)) {
+            continue;
+        }
+        const QString sourcePath = source.filePath(entry.name);
+        const QFileInfo sourceInfo(sourcePath);
+        const bool removed = !sourceInfo.exists();
+        const bool modified = removed || (pendingEntries.contains(entry.name)
+            ? sourceInfo.size() != 0
+            : ZipArchive::checksum(sourcePath) != entry.crc);
+        if (!modified) {
+            continue;
+        }
+        apkPatch->requireRebuild();
+        const QString targetPath = getDecodedPath(target, entry.name, resourceNames);
+        if (targetPath.isEmpty()) {
+            skipped.append(entry.name);
+            continue;
+        }
+        QFile::remove(targetPath);
+        if (!removed && !QFile::copy(sourcePath, targetPath)) {
+            skipped.append(entry.name);
+        }
+    }
+    if (!skipped.isEmpty()) {
+        qWarning() << "Warning: Could not carry over the changes of" << skipped;
+        logModel.add(tr("Some changes made before unpacking could not be applied to the unpacked APK."),
+                     skipped.join('\n'), LogEntry::Error);
+        state.setModified(true);
+    }
+}
+
+void Package::QuickOpenCommand::run()
+{
+    emit started();
+
+    package->logModel.add(Package::tr("Reading APK contents..."));
+
+    const QString contentsPath = package->getContentsPath();
+    ZipArchive *archive = package->archive;
+    QSet<QString> *pendingEntries = &package->pendingEntries;
+
+    // Create a skeleton of empty placeholders which are extracted on demand:
+    auto future = QtConcurrent::run([=]() -> bool {
+        if (!archive->open()) {
+            return false;
+        }
+        const QDir contents(contentsPath);
+        QSet<QString> directories;
+        for (const ZipArchive::Entry &entry : archive->getEntries()) {
+            if (!isSafeEntryName(entry.name)) {
+                qWarning() << "Warning: Skipping ZIP entry" << entry.name;
+                continue;
+            }
+            if (entry.isDirectory()) {
+                contents.mkpath(entry.name);
+                continue;
+            }
+            const QString directory = QFileInfo(entry.name).path();
+            if (!directories.contains(directory)) {
+                contents.mkpath(directory);
+                directories.insert(directory);
+            }
+            QFile placeholder(contents.filePath(entry.name));
+            if (placeholder.open(QFile::WriteOnly)) {
+                pendingEntries->insert(entry.name);
+            }
+        }
+        return true;
+    });
+
+    auto futureWatcher = new QFutureWatcher<bool>(this);
+    connect(futureWatcher, &QFutureWatcher<bool>::finished, this, [=]() {
+        if (!futureWatcher->result()) {
+            emit finished(false);
+            return;
+        }
+        package->filesystemModel.setRootPath(contentsPath);
+        auto initResourcesFuture = package->resourcesModel.initialize(contentsPath + "/res/");
+        auto initResourcesFutureWatcher = new QFutureWatcher<void>(this);
+        connect(initResourcesFutureWatcher, &QFutureWatcher<void>::finished, this, [=]() {
+            emit finished(true);
+        });
+        initResourcesFutureWatcher->setFuture(initResourcesFuture);
+    });
+    futureWatcher->setFuture(future);
+}
+
 void Package::LoadUnpackedCommand::run()
 {
     emit started();
@@ -273,7 +718,63 @@ void Package::LoadUnpackedCommand::run()
     auto initResourcesFuture = package->resourcesModel.initialize(contentsPath + "/res/");
     auto initResourcesFutureWatcher = new QFutureWatcher<void>(this);
     connect(initResourcesFutureWatcher, &QFutureWatcher<void>::finished, this, [=]() {
+        package->buildIndexes();
+        package->updatePatchSnapshot();
         emit finished(true);
     });
     initResourcesFutureWatcher->setFuture(initResourcesFuture);
 }
+
+void Package::PrepareBuildCommand::run()
+{
+    emit started();
+    QSharedPointer<BuildCache> cache(this->cache);
+    auto future = QtConcurrent::run([=]() {
+        cache->prepare();
+    });
+    auto watcher = new QFutureWatcher<void>(this);
+    connect(watcher, &QFutureWatcher<void>::finished, this, [=]() {
+        emit finished(true);
+    });
+    watcher->setFuture(future);
+}
+
+Package::PatchCommand::PatchCommand(Package *package, const QString &target, Command *fallback)
+    : package(package), target(target), fallback(fallback)
+{
+    fallback->setParent(this);
+    connect(fallback, &Command::finished, this, &Command::finished);
+}
+
+void Package::PatchCommand::run()
+{
+    emit started();
+
+    if (package->manifest) {
+        package->manifest->flush();
+    }
+    const QString source = package->originalPath;
+    const QString contentsPath = package->getContentsPath();
+    qDebug() << qPrintable(QString("Patching\n  from: %1\n    to: %2\n").arg(source, target));
+    package->logModel.add(Package::tr("Patching APK..."));
+    package->state.setCurrentStatus(PackageState::Status::Packing);
+
+    const ApkPatch patch(*package->apkPatch);
+    const QString target = this->target;
+    auto future = QtConcurrent::run([=]() {
+        return patch.apply(source, target, contentsPath);
+    });
+    auto watcher = new QFutureWatcher<bool>(this);
+    connect(watcher, &QFutureWatcher<bool>::finished, this, [=]() {
+        if (watcher->result()) {
+            package->originalPath = target;
+            package->state.setModified(false);
+            package->resetPatch();
+            emit finished(true);
+        } else {
+            qDebug() << "Could not patch the APK, falling back to the full rebuild";
+            fallback->run();
+        }
+    });
+    watcher->setFuture(future);
+}
@@ -1,6 +1,7 @@
 #ifndef PACKAGE_H
 #define PACKAGE_H
 
+#include "apk/apkinfo.h"
 #include "apk/filesystemmodel.h"
 #include "apk/iconitemsmodel.h"
 #include "apk/logmodel.h"
@@ -9,8 +10,17 @@
 #include "apk/resourceitemsmodel.h"
 #include "base/command.h"
 #include <QIcon>
+#include <QSet>
+#include <QSharedPointer>
 
+class ApkPatch;
+class BuildCache;
+class FileCatalog;
 class Keystore;
+class SearchIndex;
+class SmaliIndex;
+class ValuesIndex;
+class ZipArchive;
 
 class Package : public QObject
 {
@@ -24,10 +34,15 @@ public:
     QString getOriginalPath() const;
     QString getContentsPath() const;
     QString getPackageName() const;
+    QString getApplicationLabel() const;
+    QString getVersionName() const;
+    int getVersionCode() const;
     QIcon getThumbnail() const;
     const PackageState &getState() const;
     bool hasSourcesUnpacked() const;
+    bool extractFile(const QString &path);
 
+    void updateIndexes(const QStringList &paths);
     void setApplicationIcon(const QString &path, QWidget *parent = nullptr);
     void setPackageName(const QString &packageName);
 
@@ -38,13 +53,20 @@ public:
     IconItemsModel iconsProxy;
     ManifestModel manifestModel;
     LogModel logModel;
+    QSharedPointer<FileCatalog> fileCatalog;
+    QSharedPointer<SearchIndex> searchIndex;
+    QSharedPointer<ValuesIndex> valuesIndex;
+    QSharedPointer<SmaliIndex> smaliIndex;
+    QSharedPointer<ApkPatch> apkPatch;
 
     Commands *createCommandChain();
+    Command *createQuickOpenCommand();
     Command *createUnpackCommand();
     Command *createPackCommand(const QString &target);
     Command *createZipalignCommand(const QString &apk = QString());
     Command *createSignCommand(const Keystore *keystore, const QString &apk = QString());
     Command *createInstallCommand(const QString &serial, const QString &apk = QString());
+    void schedule(Commands *command);
 
 signals:
     void stateUpdated();
@@ -63,12 +85,54 @@ private:
         Package *package;
     };
 
+    class QuickOpenCommand : public Command
+    {
+    public:
+        QuickOpenCommand(Package *package) : package(package) {}
+        void run() override;
+    private:
+        Package *package;
+    };
+
+    class PrepareBuildCommand : public Command
+    {
+    public:
+        PrepareBuildCommand(QSharedPointer<BuildCache> cache) : cache(cache) {}
+        void run() override;
+    private:
+        QSharedPointer<BuildCache> cache;
+    };
+
+    class PatchCommand : public Command
+    {
+    public:
+        PatchCommand(Package *package, const QString &target, Command *fallback);
+        void run() override;
+    private:
+        Package *package;
+        QString target;
+        Command *fallback;
+    };
+
+    Command *createBuildCommand(const QString &target);
+    QString createContentsDirectory() const;
+    void buildIndexes();
+    void resetPatch();
+    void updatePatchSnapshot();
+    void applyQuickOpenChanges(const QString &quickContentsPath);
+
     PackageState state;
 
     QString originalPath;
     QString contentsPath;
     QIcon thumbnail;
 
+    // Read from the binary manifest, available before the APK is decoded:
+    ApkInfo info;
+
+    ZipArchive *archive = nullptr;
+    QSet<QString> pendingEntries;
+
     bool withSources = false;
     bool withResources = false;
     bool withBrokenResources = false;
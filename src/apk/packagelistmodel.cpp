@@ -69,6 +69,20 @@ QVariant PackageListModel::data(const QModelIndex &index, int role) const
             case IsModifiedColumn:
                 return package->getState().isModified();
             }
+        } else if (role == Qt::ToolTipRole) {
+            if (column == TitleColumn) {
+                QStringList lines{package->getOriginalPath()};
+                if (!package->getApplicationLabel().isEmpty()) {
+                    lines.append(package->getApplicationLabel());
+                }
+                if (!package->getPackageName().isEmpty()) {
+                    lines.append(package->getPackageName());
+                }
+                if (!package->getVersionName().isEmpty()) {
+                    lines.append(package->getVersionName());
+                }
+                return lines.join('\n');
+            }
         } else if (role == Qt::DecorationRole) {
             switch (column) {
             case TitleColumn:
@@ -77,6 +91,8 @@ QVariant PackageListModel::data(const QModelIndex &index, int role) const
                 switch (package->getState().getCurrentStatus()) {
                 case PackageState::Status::Normal:
                     return QIcon::fromTheme("apk-idle");
+                case PackageState::Status::Queued:
+                    return QIcon(QIcon::fromTheme("apk-opening").pixmap(20, QIcon::Disabled));
                 case PackageState::Status::Unpacking:
                     return QIcon::fromTheme("apk-opening");
                 case PackageState::Status::Packing:
@@ -3,6 +3,7 @@
 PackageState::PackageState()
 {
     unpacked = false;
+    quickOpened = false;
     modified = false;
     status = Status::Normal;
 }
@@ -19,6 +20,12 @@ void PackageState::setUnpacked(bool unpacked)
     emit changed();
 }
 
+void PackageState::setQuickOpened(bool quickOpened)
+{
+    this->quickOpened = quickOpened;
+    emit changed();
+}
+
 void PackageState::setModified(bool modified)
 {
     this->modified = modified;
@@ -35,6 +42,11 @@ bool PackageState::isUnpacked() const
     return unpacked;
 }
 
+bool PackageState::isQuickOpened() const
+{
+    return quickOpened;
+}
+
 bool PackageState::isModified() const
 {
     return modified;
@@ -47,25 +59,26 @@ bool PackageState::isIdle() const
 
 bool PackageState::canEdit() const
 {
-    return isUnpacked();
+    // Quick-opened packages are upgraded to a full unpack on the first edit
+    return isUnpacked() || isQuickOpened();
 }
 
 bool PackageState::canSave() const
 {
-    return isUnpacked() && isIdle();
+    return (isUnpacked() || isQuickOpened()) && isIdle();
 }
 
 bool PackageState::canInstall() const
 {
-    return isUnpacked() && isIdle();
+    return (isUnpacked() || isQuickOpened()) && isIdle();
 }
 
 bool PackageState::canExplore() const
 {
-    return isUnpacked();
+    return isUnpacked() || isQuickOpened();
 }
 
 bool PackageState::canClose() const
 {
-    return isIdle();
+    return isIdle() || status == Status::Queued;
 }
@@ -11,6 +11,7 @@ public:
     enum class Status {
         Normal,
         Errored,
+        Queued,
         Unpacking,
         Packing,
         Signing,
@@ -22,10 +23,12 @@ public:
 
     void setCurrentStatus(const Status &status);
     void setUnpacked(bool unpacked);
+    void setQuickOpened(bool quickOpened);
     void setModified(bool modified);
 
     const Status &getCurrentStatus() const;
     bool isUnpacked() const;
+    bool isQuickOpened() const;
     bool isModified() const;
     bool isIdle() const;
 
@@ -40,6 +43,7 @@ signals:
 
 private:
     bool unpacked;
+    bool quickOpened;
     bool modified;
     Status status;
 };
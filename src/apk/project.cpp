@@ -1,6 +1,10 @@
 #include "apk/project.h"
+#include "apk/apkpatch.h"
 #include "apk/package.h"
+#include "apk/smaliindex.h"
+#include "apk/valuesindex.h"
 #include "base/application.h"
+#include "base/filecatalog.h"
 #include "base/settings.h"
 #include "base/utils.h"
 #include "sheets/codesheet.h"
@@ -14,9 +18,7 @@
 #include "windows/progressdialog.h"
 #include "windows/signatureviewer.h"
 #include "tools/keystore.h"
-#include <QImageReader>
 #include <QInputDialog>
-#include <QMimeDatabase>
 
 Project::Project(Package *package, QWidget *parent)
     : QObject(parent)
@@ -48,6 +50,7 @@ void Project::openProjectTab()
     auto tab = new ProjectSheet(package, parentWidget());
     tab->setProperty("identifier", identifier);
     connect(tab, &ProjectSheet::titleEditorRequested, this, &Project::openTitlesTab);
+    connect(tab, &ProjectSheet::iconEditorRequested, this, &Project::openIconEditor);
     connect(tab, &ProjectSheet::apkSaveRequested, this, &Project::saveProject);
     connect(tab, &ProjectSheet::apkInstallRequested, this, &Project::installProject);
     addTab(tab);
@@ -55,6 +58,10 @@ void Project::openProjectTab()
 
 void Project::openTitlesTab()
 {
+    if (!requireUnpacked()) {
+        return;
+    }
+
     const QString identifier = "titles";
     auto existing = getTabByIdentifier(identifier);
     if (existing) {
@@ -67,6 +74,16 @@ void Project::openTitlesTab()
     addTab(editor);
 }
 
+void Project::openIconEditor()
+{
+    if (!requireUnpacked()) {
+        return;
+    }
+
+    const QString iconSource(Dialogs::getOpenImageFilename(parentWidget()));
+    package->setApplicationIcon(iconSource, parentWidget());
+}
+
 void Project::openResourceTab(const ResourceModelIndex &index)
 {
     const QString path = index.path();
@@ -81,13 +98,28 @@ void Project::openResourceTab(const ResourceModelIndex &index)
         return;
     }
 
+    flushManifest();
+
+    if (package->getState().isQuickOpened()) {
+        // Binary XML and compiled resources are only readable after the full unpack:
+        const QString suffix = QFileInfo(path).suffix().toLower();
+        if (suffix == "xml" || suffix == "arsc" || suffix == "dex") {
+            requireUnpacked();
+            return;
+        }
+        if (!package->extractFile(path)) {
+            QMessageBox::warning(parentWidget(), {}, tr("Could not extract the file."));
+            return;
+        }
+    }
+
     BaseEditableSheet *editor = nullptr;
 
-    const auto extension = QFileInfo(path).suffix();
-    if (QImageReader::supportedImageFormats().contains(extension.toUtf8())) {
+    const auto file = package->fileCatalog->getEntry(path);
+    if (file.isImage()) {
         editor = new ImageSheet(index, parentWidget());
-    } else if (QMimeDatabase().mimeTypeForFile(path).inherits("text/plain")) {
-        editor = new CodeSheet(index, parentWidget());
+    } else if (file.isText()) {
+        editor = createCodeSheet(index);
     } else {
         QMessageBox::warning(parentWidget(), {}, tr("The format is not supported."));
         return;
@@ -121,7 +153,8 @@ void Project::openCodeSheetTab(const QString &filePath, int lineNumber, int colu
         return;
     }
 
-    auto codeEditor = new CodeSheet(index, parentWidget());
+    flushManifest();
+    auto codeEditor = createCodeSheet(index);
     codeEditor->setProperty("identifier", identifier);
     if (lineNumber != -1 && columnNumber != -1) {
         codeEditor->setTextCursor(lineNumber, columnNumber, selectionLength);
@@ -131,12 +164,31 @@ void Project::openCodeSheetTab(const QString &filePath, int lineNumber, int colu
 
 void Project::openPermissionEditor()
 {
+    if (!requireUnpacked()) {
+        return;
+    }
+
+    auto getPermissionNames = [this]() {
+        QStringList names;
+        for (const Permission &permission : package->manifest->getPermissionList()) {
+            names.append(permission.getName());
+        }
+        return names;
+    };
+    const QStringList permissions = getPermissionNames();
     PermissionEditor permissionEditor(package->manifest, parentWidget());
     permissionEditor.exec();
+    if (getPermissionNames() != permissions) {
+        package->apkPatch->requireRebuild();
+    }
 }
 
 void Project::openPackageCloner()
 {
+    if (!requireUnpacked()) {
+        return;
+    }
+
     RememberDialog::say("experimental-rename-package", tr(
         "Package renaming is an experimental function which, in its current state, "
         "may lead to crashes and data loss. You can join the discussion and help us "
@@ -193,6 +245,10 @@ void Project::openPackageCloner()
 
 void Project::openSearchTab()
 {
+    if (!requireUnpacked()) {
+        return;
+    }
+
     const QString identifier = "search";
     auto existing = getTabByIdentifier(identifier);
     if (existing) {
@@ -202,11 +258,26 @@ void Project::openSearchTab()
 
     auto tab = new SearchSheet(parentWidget());
     tab->setSearchPath(package->getContentsPath());
+    tab->setSearchIndex(package->searchIndex);
+    tab->setFileCatalog(package->fileCatalog);
     tab->setProperty("identifier", identifier);
     connect(tab, &SearchSheet::editRequested, this, &Project::openCodeSheetTab);
+    connect(tab, &SearchSheet::filesReplaced, this, [this](const QStringList &paths) {
+        package->apkPatch->requireRebuild();
+        package->updateIndexes(paths);
+    });
     addTab(tab);
 }
 
+void Project::openUsagesTab(const QString &symbol, const QList<SearchResult> &results)
+{
+    openSearchTab();
+    auto tab = qobject_cast<SearchSheet *>(getTabByIdentifier("search"));
+    if (tab) {
+        tab->setResults(symbol, results);
+    }
+}
+
 void Project::openSignatureViewer()
 {
     SignatureViewer signatureViewer(package->getOriginalPath(), parentWidget());
@@ -227,6 +298,10 @@ bool Project::saveTabs()
 
 bool Project::saveProject()
 {
+    if (!requireUnpacked()) {
+        return false;
+    }
+
     if (hasUnsavedTabs()) {
         const QString question = tr("Do you want to save changes before packing?");
         const int answer = QMessageBox::question(parentWidget(), {}, question,
@@ -259,12 +334,16 @@ bool Project::saveProject()
             command->add(package->createSignCommand(keystore.get(), target), false);
         }
     }
-    command->run();
+    package->schedule(command);
     return true;
 }
 
 bool Project::installProject()
 {
+    if (isUnsaved() && !requireUnpacked()) {
+        return false;
+    }
+
     const auto device = Dialogs::getInstallDevice(parentWidget());
     if (device.isNull()) {
         return false;
@@ -307,7 +386,27 @@ bool Project::installProject()
     }
 
     command->add(package->createInstallCommand(device.getSerial(), target));
-    command->run();
+    package->schedule(command);
+    return true;
+}
+
+bool Project::unpackProject()
+{
+    if (!package->getState().isIdle()) {
+        return false;
+    }
+
+    // Opened sheets refer to the files of the previous contents directory:
+    for (int index = tabWidget->count() - 1; index >= 0; --index) {
+        auto tab = static_cast<BaseSheet *>(tabWidget->widget(index));
+        if (tab->property("identifier") != "project" && !closeTab(tab)) {
+            return false;
+        }
+    }
+
+    auto command = package->createCommandChain();
+    command->add(package->createUnpackCommand(), true);
+    package->schedule(command);
     return true;
 }
 
@@ -336,6 +435,17 @@ bool Project::isUnsaved() const
     return package->getState().isModified() || hasUnsavedTabs();
 }
 
+CodeSheet *Project::createCodeSheet(const ResourceModelIndex &index)
+{
+    auto sheet = new CodeSheet(index, parentWidget());
+    if (SmaliIndex::isSmaliFile(index.path())) {
+        sheet->setSmaliIndex(package->smaliIndex);
+        connect(sheet, &CodeSheet::editRequested, this, &Project::openCodeSheetTab);
+        connect(sheet, &CodeSheet::usagesFound, this, &Project::openUsagesTab);
+    }
+    return sheet;
+}
+
 int Project::addTab(BaseSheet *tab)
 {
     // TODO Tab title is not retranslated on language change
@@ -343,9 +453,14 @@ int Project::addTab(BaseSheet *tab)
     tabWidget->setCurrentIndex(tabIndex);
     auto editor = qobject_cast<BaseEditableSheet *>(tab);
     if (editor) {
-        connect(editor, &BaseEditableSheet::saved, this, [this]() {
+        connect(editor, &BaseEditableSheet::saved, this, [=]() {
             // Project save indicator:
             const_cast<PackageState &>(package->getState()).setModified(true);
+            auto fileEditor = qobject_cast<BaseFileSheet *>(editor);
+            if (fileEditor) {
+                package->apkPatch->requireRebuild();
+                package->updateIndexes({fileEditor->getFilePath()});
+            }
         });
         connect(editor, &BaseEditableSheet::modifiedStateChanged, this, [=](bool modified) {
             // Tab save indicator:
@@ -385,6 +500,26 @@ void Project::setCurrentTab(BaseSheet *tab)
     tabWidget->setCurrentIndex(tabWidget->indexOf(tab));
 }
 
+bool Project::requireUnpacked()
+{
+    if (!package->getState().isQuickOpened()) {
+        return true;
+    }
+    const QString question = tr("This action requires the APK to be fully unpacked. Unpack it now?");
+    if (QMessageBox::question(parentWidget(), {}, question) == QMessageBox::Yes) {
+        unpackProject();
+    }
+    return false;
+}
+
+void Project::flushManifest()
+{
+    // Files opened in editors have to reflect the pending manifest edits:
+    if (package->manifest) {
+        package->manifest->flush();
+    }
+}
+
 bool Project::hasUnsavedTabs() const
 {
     for (int index = 0; index < tabWidget->count(); ++index) {
@@ -1,9 +1,11 @@
 #ifndef PROJECT_H
 #define PROJECT_H
 
+#include "base/searchresult.h"
 #include <QObject>
 
 class BaseSheet;
+class CodeSheet;
 class Package;
 class ResourceModelIndex;
 class QTabWidget;
@@ -17,6 +19,7 @@ public:
 
     void openProjectTab();
     void openTitlesTab();
+    void openIconEditor();
     void openResourceTab(const ResourceModelIndex &index);
     void openResourceTab(const QString &filePath);
     void openCodeSheetTab(const QString &filePath, int lineNumber, int columnNumber, int selectionLength);
@@ -27,6 +30,7 @@ public:
 
     bool saveTabs();
     bool saveProject();
+    bool unpackProject();
     bool installProject();
     bool exploreProject();
 
@@ -39,11 +43,15 @@ signals:
     void currentTabChanged(BaseSheet *tab);
 
 private:
+    CodeSheet *createCodeSheet(const ResourceModelIndex &index);
+    void openUsagesTab(const QString &symbol, const QList<SearchResult> &results);
     int addTab(BaseSheet *tab);
     bool closeTab(BaseSheet *tab);
     void setCurrentTab(BaseSheet *tab);
+    bool requireUnpacked();
 
     bool hasUnsavedTabs() const;
+    void flushManifest();
     BaseSheet *getTabByIdentifier(const QString &identifier) const;
     QWidget *parentWidget() const;
 
@@ -1,4 +1,5 @@
 #include "apk/resourcefile.h"
+#include "base/application.h"
 #include "base/utils.h"
 #include <QDir>
 #include <QFileIconProvider>
@@ -99,6 +100,12 @@ ResourceFile::ResourceFile(const QString &path)
     }
 }
 
+ResourceFile::ResourceFile(const QString &path, const ResourceFile &sibling) : ResourceFile(sibling)
+{
+    // Files in the same directory share all the qualifiers
+    this->path = QDir::fromNativeSeparators(path);
+}
+
 QString ResourceFile::getQualifiers() const
 {
     return qualifiers;
@@ -164,8 +171,12 @@ QIcon ResourceFile::getFileIcon(const QFileIconProvider &iconProvider) const
 {
     const QString filePath = getFilePath();
     if (Utils::isImageReadable(filePath)) {
-        QPixmap thumbnail(filePath);
-        return thumbnail;
+        // Decoded in background; a generic icon is shown until the thumbnail is ready
+        const QPixmap thumbnail = app->thumbnails.getThumbnail(filePath);
+        if (!thumbnail.isNull()) {
+            return thumbnail;
+        }
+        return iconProvider.icon(QFileIconProvider::File);
     }
     return iconProvider.icon(filePath);
 }
@@ -9,6 +9,7 @@ class ResourceFile
 {
 public:
     ResourceFile(const QString &path);
+    ResourceFile(const QString &path, const ResourceFile &sibling);
 
     QString getQualifiers() const;
     QString getReadableQualifiers() const;
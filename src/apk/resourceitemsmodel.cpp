@@ -1,10 +1,12 @@
 #include "apk/resourceitemsmodel.h"
 #include "apk/resourcenode.h"
 #include "apk/resourcemodelindex.h"
+#include "base/application.h"
 #include "base/utils.h"
 #include <QtConcurrent/QtConcurrent>
 #include <QDirIterator>
 #include <QIcon>
+#include <functional>
 
 #ifdef QT_DEBUG
     #include <QDebug>
@@ -13,58 +15,206 @@
 ResourceItemsModel::ResourceItemsModel(QObject *parent)
     : QAbstractItemModel(parent)
     , root(new ResourceNode)
-{}
+    , scanWatcher(nullptr)
+    , nodeArena(QSharedPointer<TreeNodeArena>::create())
+{
+    connect(&app->thumbnails, &ThumbnailService::thumbnailReady, this, [this](const QString &path) {
+        const QModelIndex index = findIndex(path);
+        if (index.isValid()) {
+            const QModelIndex captionIndex = index.sibling(index.row(), CaptionColumn);
+            emit dataChanged(captionIndex, captionIndex, {Qt::DecorationRole});
+        }
+    });
+}
 
 ResourceItemsModel::~ResourceItemsModel()
 {
+    cancelInitialization();
     delete root;
 }
 
 QFuture<void> ResourceItemsModel::initialize(const QString &path)
 {
-    beginResetModel();
+    cancelInitialization();
 
-    return QtConcurrent::run([=] {
+    beginResetModel();
+    root->removeChildren();
+    typeNodes.clear();
+    groupNodes.clear();
+    pathNodes.clear();
+    arenas.clear();
+    nodeArena = QSharedPointer<TreeNodeArena>::create();
+    endResetModel();
+
+    // Scan resource directories in parallel; each scanned directory
+    // is merged into the tree as soon as it is ready:
+
+    QStringList directories;
+    QDirIterator resourceDirectories(path, QDir::Dirs | QDir::NoDotAndDotDot);
+    while (resourceDirectories.hasNext()) {
+        directories.append(resourceDirectories.next());
+    }
 
-        // Parse resource directories:
+    initialization = QFutureInterface<void>();
+    initialization.reportStarted();
+
+    scanWatcher = new QFutureWatcher<ResourceDirectory>(this);
+    connect(scanWatcher, &QFutureWatcher<ResourceDirectory>::resultsReadyAt, this, &ResourceItemsModel::insertDirectories);
+    connect(scanWatcher, &QFutureWatcher<ResourceDirectory>::finished, this, [this]() {
+        scanWatcher->deleteLater();
+        scanWatcher = nullptr;
+        typeNodes.clear();
+        groupNodes.clear();
+        initialization.reportFinished();
+    });
+    std::function<ResourceDirectory(const QString &)> scan = &ResourceItemsModel::scanDirectory;
+    scanWatcher->setFuture(QtConcurrent::mapped(directories, scan));
 
-        QMap<QString, ResourceNode *> mapResourceTypes;
-        QMap<QString, ResourceNode *> mapResourceGroups;
+    return initialization.future();
+}
 
-        QDirIterator resourceDirectories(path, QDir::Dirs | QDir::NoDotAndDotDot);
-        while (resourceDirectories.hasNext()) {
+ResourceItemsModel::ResourceDirectory ResourceItemsModel::scanDirectory(const QString &path)
+{
+    auto directory = ResourceDirectory::create();
+    directory->arena = QSharedPointer<TreeNodeArena>::create();
+    directory->type = QFileInfo(path).fileName().split('-').first(); // E.g., "drawable", "values"...
+
+    // Files of the same directory share their qualifiers, so these are only parsed once:
+    const ResourceFile *sibling = nullptr;
+    QDirIterator resourceFiles(path, QDir::Files);
+    while (resourceFiles.hasNext()) {
+        const QFileInfo resourceFile(resourceFiles.next());
+        auto file = sibling
+            ? new ResourceFile(resourceFile.filePath(), *sibling)
+            : new ResourceFile(resourceFile.filePath());
+        sibling = file;
+        directory->files.append(directory->arena->create<ResourceNode>(resourceFile.fileName(), file));
+    }
+    return directory;
+}
 
-            const QFileInfo resourceDirectory = QFileInfo(resourceDirectories.next());
-            const QString resourceTypeTitle = resourceDirectory.fileName().split('-').first(); // E.g., "drawable", "values"...
-            ResourceNode *resourceTypeNode = mapResourceTypes.value(resourceTypeTitle, nullptr);
-            if (!resourceTypeNode) {
-                resourceTypeNode = new ResourceNode(resourceTypeTitle, nullptr);
-                root->addChild(resourceTypeNode);
-                mapResourceTypes[resourceTypeTitle] = resourceTypeNode;
-            }
+ResourceItemsModel::ScannedDirectory::~ScannedDirectory()
+{
+    // Directories which have not been merged into the tree (e.g., cancelled ones)
+    for (ResourceNode *file : qAsConst(files)) {
+        TreeNode::destroy(file);
+    }
+}
 
-            // Parse resource files:
+void ResourceItemsModel::insertDirectories(int first, int last)
+{
+    // Merge the batch by resource type to insert each type's rows at once:
+    QMap<QString, QVector<ResourceNode *>> batch;
+    for (int i = first; i < last; ++i) {
+        const ResourceDirectory directory = scanWatcher->resultAt(i);
+        arenas.append(directory->arena);
+        batch[directory->type] += directory->files;
+        directory->files.clear();
+    }
+    for (auto it = batch.constBegin(); it != batch.constEnd(); ++it) {
+        insertFiles(it.key(), it.value());
+    }
+}
 
-            QDirIterator resourceFiles(resourceDirectory.filePath(), QDir::Files);
-            while (resourceFiles.hasNext()) {
+void ResourceItemsModel::insertFiles(const QString &type, const QVector<ResourceNode *> &files)
+{
+    ResourceNode *typeNode = typeNodes.value(type, nullptr);
+    const bool isNewType = !typeNode;
+    if (isNewType) {
+        typeNode = nodeArena->create<ResourceNode>(type, nullptr);
+        typeNodes.insert(type, typeNode);
+    }
 
-                const QFileInfo resourceFile(resourceFiles.next());
-                const QString resourceFilename = resourceFile.fileName();
+    // Files of new groups are attached right away, as their groups are not visible yet:
+    QVector<ResourceNode *> newGroups;
+    QMap<ResourceNode *, QVector<ResourceNode *>> existingGroups;
+    for (ResourceNode *file : files) {
+        indexNode(file);
+        const QString groupKey = type + '/' + file->getCaption();
+        ResourceNode *groupNode = groupNodes.value(groupKey, nullptr);
+        if (!groupNode) {
+            groupNode = nodeArena->create<ResourceNode>(file->getCaption(), nullptr);
+            groupNodes.insert(groupKey, groupNode);
+            newGroups.append(groupNode);
+        }
+        // Share the caption string with the group instead of keeping a copy per file
+        file->setCaption(groupNode->getCaption());
+        if (groupNode->getParent()) {
+            existingGroups[groupNode].append(file);
+        } else {
+            groupNode->addChild(file);
+        }
+    }
 
-                ResourceNode *resourceGroupNode  = mapResourceGroups.value(resourceFilename, nullptr);
-                if (!resourceGroupNode) {
-                    resourceGroupNode = new ResourceNode(resourceFilename, nullptr);
-                    resourceTypeNode->addChild(resourceGroupNode);
-                    mapResourceGroups[resourceFilename] = resourceGroupNode;
-                }
+    if (isNewType) {
+        for (ResourceNode *groupNode : qAsConst(newGroups)) {
+            typeNode->addChild(groupNode);
+        }
+        const int row = root->childCount();
+        beginInsertRows({}, row, row);
+            root->addChild(typeNode);
+        endInsertRows();
+        return;
+    }
 
-                ResourceNode *fileNode = new ResourceNode(resourceFilename, new ResourceFile(resourceFile.filePath()));
-                resourceGroupNode->addChild(fileNode);
-            }
+    const QModelIndex typeIndex = createIndex(typeNode->row(), 0, typeNode);
+    for (auto it = existingGroups.constBegin(); it != existingGroups.constEnd(); ++it) {
+        ResourceNode *groupNode = it.key();
+        const QModelIndex groupIndex = createIndex(groupNode->row(), 0, groupNode);
+        const int row = groupNode->childCount();
+        beginInsertRows(groupIndex, row, row + it.value().size() - 1);
+        for (ResourceNode *file : it.value()) {
+            groupNode->addChild(file);
+        }
+        endInsertRows();
+    }
+    if (!newGroups.isEmpty()) {
+        const int row = typeNode->childCount();
+        beginInsertRows(typeIndex, row, row + newGroups.size() - 1);
+        for (ResourceNode *groupNode : qAsConst(newGroups)) {
+            typeNode->addChild(groupNode);
         }
+        endInsertRows();
+    }
+}
 
-        endResetModel();
-    });
+void ResourceItemsModel::cancelInitialization()
+{
+    if (scanWatcher) {
+        scanWatcher->disconnect(this);
+        scanWatcher->cancel();
+        scanWatcher->waitForFinished();
+        scanWatcher->deleteLater();
+        scanWatcher = nullptr;
+    }
+    if (initialization.isRunning()) {
+        initialization.reportFinished();
+    }
+}
+
+void ResourceItemsModel::indexNode(ResourceNode *node)
+{
+    if (node->getFile()) {
+        pathNodes.insert(getPathKey(node->getFile()->getFilePath()), node);
+    }
+    for (int row = 0; row < node->childCount(); ++row) {
+        indexNode(node->getChild(row));
+    }
+}
+
+void ResourceItemsModel::unindexNode(ResourceNode *node)
+{
+    if (node->getFile()) {
+        pathNodes.remove(getPathKey(node->getFile()->getFilePath()));
+    }
+    for (int row = 0; row < node->childCount(); ++row) {
+        unindexNode(node->getChild(row));
+    }
+}
+
+QString ResourceItemsModel::getPathKey(const QString &path)
+{
+    return QDir::cleanPath(path);
 }
 
 QModelIndex ResourceItemsModel::addNode(ResourceNode *node, const QModelIndex &parent)
@@ -72,6 +222,7 @@ QModelIndex ResourceItemsModel::addNode(ResourceNode *node, const QModelIndex &p
     ResourceNode *parentNode = parent.isValid() ? static_cast<ResourceNode *>(parent.internalPointer()) : root;
     beginInsertRows(parent, rowCount(parent), rowCount(parent));
         parentNode->addChild(node);
+        indexNode(node);
     endInsertRows();
     auto index = createIndex(rowCount(parent) - 1, 0, node);
     return index;
@@ -242,6 +393,7 @@ bool ResourceItemsModel::removeRows(int row, int count, const QModelIndex &paren
     // Proceed by removing the corresponsing rows
     beginRemoveRows(parent, row, lastDeleteRow);
     for (int i = row; i <= lastDeleteRow; ++i) {
+        unindexNode(parentNode->getChild(row));
         parentNode->removeChild(row);
     }
     endRemoveRows();
@@ -252,6 +404,7 @@ bool ResourceItemsModel::removeRows(int row, int count, const QModelIndex &paren
         if (grandparent.isValid()) {
             beginRemoveRows(grandparent, parent.row(), parent.row());
                 auto grandparentNode = static_cast<ResourceNode *>(grandparent.internalPointer());
+                groupNodes.remove(grandparentNode->getCaption() + '/' + parentNode->getCaption());
                 grandparentNode->removeChild(parent.row());
             endRemoveRows();
         }
@@ -262,22 +415,11 @@ bool ResourceItemsModel::removeRows(int row, int count, const QModelIndex &paren
 
 QModelIndex ResourceItemsModel::findIndex(const QString &path) const
 {
-    return findIndex(path, {});
-}
-
-QModelIndex ResourceItemsModel::findIndex(const QString &path, const QModelIndex &parent) const
-{
-    for (int row = 0; row < rowCount(parent); ++row) {
-        auto resource = index(row, PathColumn, parent);
-        if (resource.data().toString() == path) {
-            return resource;
-        }
-        resource = findIndex(path, resource);
-        if (resource.isValid()) {
-            return resource;
-        }
+    ResourceNode *node = pathNodes.value(getPathKey(path), nullptr);
+    if (!node) {
+        return {};
     }
-    return {};
+    return createIndex(node->row(), PathColumn, node);
 }
 
 const ResourceFile *ResourceItemsModel::getResourceFile(const QModelIndex &index) const
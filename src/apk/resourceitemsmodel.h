@@ -4,10 +4,12 @@
 #include "apk/iresourceitemsmodel.h"
 #include <QAbstractItemModel>
 #include <QFileIconProvider>
-#include <QFuture>
+#include <QFutureWatcher>
+#include <QSharedPointer>
 
 class ResourceFile;
 class ResourceNode;
+class TreeNodeArena;
 
 class ResourceItemsModel : public QAbstractItemModel, public IResourceItemsModel
 {
@@ -48,11 +50,34 @@ public:
     bool removeRows(int row, int count, const QModelIndex &parent = QModelIndex()) override;
 
     QModelIndex findIndex(const QString &path) const;
-    QModelIndex findIndex(const QString &path, const QModelIndex &parent) const;
     const ResourceFile *getResourceFile(const QModelIndex &index) const;
 
 private:
+    struct ScannedDirectory
+    {
+        ~ScannedDirectory();
+        QSharedPointer<TreeNodeArena> arena;
+        QString type;
+        QVector<ResourceNode *> files;
+    };
+    typedef QSharedPointer<ScannedDirectory> ResourceDirectory;
+
+    static ResourceDirectory scanDirectory(const QString &path);
+    void insertDirectories(int first, int last);
+    void insertFiles(const QString &type, const QVector<ResourceNode *> &files);
+    void cancelInitialization();
+    void indexNode(ResourceNode *node);
+    void unindexNode(ResourceNode *node);
+    static QString getPathKey(const QString &path);
+
     ResourceNode *root;
+    QHash<QString, ResourceNode *> typeNodes;
+    QHash<QString, ResourceNode *> groupNodes;
+    QHash<QString, ResourceNode *> pathNodes;
+    QFutureWatcher<ResourceDirectory> *scanWatcher;
+    QFutureInterface<void> initialization;
+    QSharedPointer<TreeNodeArena> nodeArena;
+    QList<QSharedPointer<TreeNodeArena>> arenas;
     QFileIconProvider iconProvider;
 };
 
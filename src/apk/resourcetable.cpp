@@ -0,0 +1,250 @@
+#include "apk/resourcetable.h"
+
+using namespace BinaryResource;
+
+namespace
+{
+    const quint32 TableHeaderSize = 12;
+    const quint32 PackageHeaderSize = 12;
+    const quint32 PackageHeaderSizeWithKeys = 284;
+    const quint32 PackageHeaderSizeWithTypeIdOffset = 288;
+    const quint32 ConfigDensityEnd = 16;
+    const quint32 ValueSize = 8;
+    const quint16 DensityDefault = 0;
+    const quint16 DensityMedium = 160;
+    const quint16 DensityAny = 0xfffe;
+    const quint16 DensityNone = 0xffff;
+    const int MaxReferenceDepth = 8;
+
+    bool isImage(const QString &path)
+    {
+        return path.endsWith(".png", Qt::CaseInsensitive)
+            || path.endsWith(".webp", Qt::CaseInsensitive)
+            || path.endsWith(".jpg", Qt::CaseInsensitive);
+    }
+
+    int getDensityRank(quint16 density)
+    {
+        switch (density) {
+        case DensityDefault:
+            return DensityMedium;
+        case DensityAny:
+        case DensityNone:
+            return 0;
+        }
+        return density;
+    }
+}
+
+ResourceTable::ResourceTable(const QByteArray &data) : data(data)
+{
+    const uchar *bytes = reinterpret_cast<const uchar *>(data.constData());
+    const Chunk chunk = readChunk(bytes, data.size());
+    if (chunk.type != TableChunk || chunk.headerSize < TableHeaderSize) {
+        return;
+    }
+    root = chunk;
+    const Chunk pool = readChunk(bytes + root.headerSize, root.size - root.headerSize);
+    strings = StringPool(pool);
+}
+
+bool ResourceTable::isValid() const
+{
+    return !root.isNull();
+}
+
+QVector<ResourceTable::Entry> ResourceTable::getEntries(quint32 id) const
+{
+    QVector<Entry> entries;
+    if (root.isNull()) {
+        return entries;
+    }
+    const quint32 packageId = id >> 24;
+    const quint8 typeId = (id >> 16) & 0xff;
+    const quint16 entryIndex = id & 0xffff;
+
+    for (quint32 offset = root.headerSize; offset < root.size;) {
+        const Chunk package = readChunk(root.data + offset, root.size - offset);
+        if (package.isNull()) {
+            break;
+        }
+        offset += package.size;
+        if (package.type != TablePackageChunk || package.headerSize < PackageHeaderSize
+                || readUInt32(package.data + 8) != packageId) {
+            continue;
+        }
+        for (quint32 typeOffset = package.headerSize; typeOffset < package.size;) {
+            const Chunk type = readChunk(package.data + typeOffset, package.size - typeOffset);
+            if (type.isNull()) {
+                break;
+            }
+            typeOffset += type.size;
+            if (type.type != TableTypeChunk || type.headerSize < TypeHeaderSize || type.data[8] != typeId) {
+                continue;
+            }
+            const quint32 entryOffset = findEntryOffset(type, entryIndex);
+            if (entryOffset == NoEntry) {
+                continue;
+            }
+            const quint64 position = quint64(readUInt32(type.data + 16)) + entryOffset;
+            if (position + EntryHeaderSize > type.size) {
+                continue;
+            }
+            const uchar *source = type.data + position;
+            const quint16 flags = readUInt16(source + 2);
+
+            Entry entry;
+            if (flags & CompactEntryFlag) {
+                entry.value.type = flags >> 8;
+                entry.value.data = readUInt32(source + 4);
+            } else if (flags & ComplexEntryFlag) {
+                continue; // Styles, arrays and plurals are not needed here
+            } else {
+                const quint16 size = readUInt16(source);
+                if (position + size + ValueSize > type.size) {
+                    continue;
+                }
+                entry.value.type = source[size + 3];
+                entry.value.data = readUInt32(source + size + 4);
+            }
+            if (entry.value.type == Value::String) {
+                entry.value.string = strings.at(entry.value.data);
+            }
+
+            // Configuration of the type: size, IMSI, locale, screen type (including density) and more
+            const uchar *config = type.data + TypeHeaderSize;
+            const bool hasConfig = type.headerSize >= TypeHeaderSize + ConfigDensityEnd;
+            entry.density = hasConfig ? readUInt16(config + 14) : DensityDefault;
+            if (hasConfig && config[8]) {
+                entry.language = QString::fromLatin1(reinterpret_cast<const char *>(config + 8), config[9] ? 2 : 1);
+            }
+            entries.append(entry);
+        }
+    }
+    return entries;
+}
+
+QString ResourceTable::getString(quint32 id) const
+{
+    // Prefer the default locale:
+    const QVector<Entry> entries = getEntries(id);
+    QString result;
+    for (const Entry &entry : entries) {
+        const Value value = resolve(entry.value);
+        if (value.type != Value::String) {
+            continue;
+        }
+        if (entry.language.isEmpty()) {
+            return value.string;
+        }
+        if (result.isNull()) {
+            result = value.string;
+        }
+    }
+    return result;
+}
+
+QString ResourceTable::getFilePath(quint32 id) const
+{
+    // Prefer raster images of the highest density:
+    QString result;
+    int resultRank = -1;
+    for (const Entry &entry : getEntries(id)) {
+        const Value value = resolve(entry.value);
+        if (value.type != Value::String || value.string.isEmpty()) {
+            continue;
+        }
+        const int rank = (isImage(value.string) ? 0x10000 : 0) + getDensityRank(entry.density);
+        if (rank > resultRank) {
+            result = value.string;
+            resultRank = rank;
+        }
+    }
+    return result;
+}
+
+QHash<QString, QString> ResourceTable::getFileNames() const
+{
+    QHash<QString, QString> names;
+    if (root.isNull()) {
+        return names;
+    }
+    for (quint32 offset = root.headerSize; offset < root.size;) {
+        const Chunk package = readChunk(root.data + offset, root.size - offset);
+        if (package.isNull()) {
+            break;
+        }
+        offset += package.size;
+        if (package.type != TablePackageChunk || package.headerSize < PackageHeaderSizeWithKeys) {
+            continue;
+        }
+        const quint32 typeStringsOffset = readUInt32(package.data + 268);
+        const quint32 keyStringsOffset = readUInt32(package.data + 276);
+        const quint32 typeIdOffset = package.headerSize >= PackageHeaderSizeWithTypeIdOffset ? readUInt32(package.data + 284) : 0;
+        if (typeStringsOffset >= package.size || keyStringsOffset >= package.size) {
+            continue;
+        }
+        const StringPool typeNames(readChunk(package.data + typeStringsOffset, package.size - typeStringsOffset));
+        const StringPool keyNames(readChunk(package.data + keyStringsOffset, package.size - keyStringsOffset));
+
+        for (quint32 typeOffset = package.headerSize; typeOffset < package.size;) {
+            const Chunk type = readChunk(package.data + typeOffset, package.size - typeOffset);
+            if (type.isNull()) {
+                break;
+            }
+            typeOffset += type.size;
+            if (type.type != TableTypeChunk || type.headerSize < TypeHeaderSize || type.data[8] <= typeIdOffset) {
+                continue;
+            }
+            const QString typeName = typeNames.at(type.data[8] - 1 - typeIdOffset);
+            const quint32 entriesStart = readUInt32(type.data + 16);
+            for (const quint32 entryOffset : getEntryOffsets(type)) {
+                const quint64 position = quint64(entriesStart) + entryOffset;
+                if (position + EntryHeaderSize > type.size) {
+                    continue;
+                }
+                const uchar *source = type.data + position;
+                const quint16 flags = readUInt16(source + 2);
+                quint32 key;
+                Value value;
+                if (flags & CompactEntryFlag) {
+                    key = readUInt16(source);
+                    value.type = flags >> 8;
+                    value.data = readUInt32(source + 4);
+                } else if (flags & ComplexEntryFlag) {
+                    continue;
+                } else {
+                    const quint16 size = readUInt16(source);
+                    if (position + size + ValueSize > type.size) {
+                        continue;
+                    }
+                    key = readUInt32(source + 4);
+                    value.type = source[size + 3];
+                    value.data = readUInt32(source + size + 4);
+                }
+                if (value.type != Value::String) {
+                    continue;
+                }
+                const QString path = strings.at(value.data);
+                if (path.startsWith("res/")) {
+                    names.insert(path, QString("%1/%2").arg(typeName, keyNames.at(key)));
+                }
+            }
+        }
+    }
+    return names;
+}
+
+Value ResourceTable::resolve(const Value &value, int depth) const
+{
+    if (value.type != Value::Reference || depth >= MaxReferenceDepth) {
+        return value;
+    }
+    const QVector<Entry> entries = getEntries(value.data);
+    for (const Entry &entry : entries) {
+        if (entry.language.isEmpty()) {
+            return resolve(entry.value, depth + 1);
+        }
+    }
+    return !entries.isEmpty() ? resolve(entries.first().value, depth + 1) : Value();
+}
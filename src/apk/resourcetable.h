@@ -0,0 +1,40 @@
+#ifndef RESOURCETABLE_H
+#define RESOURCETABLE_H
+
+#include "apk/binaryresource.h"
+#include <QByteArray>
+#include <QHash>
+#include <QVector>
+
+// Reader of the compiled resource table (resources.arsc). Entries are looked up
+// by walking the chunk headers, so nothing is indexed or copied up front.
+
+class ResourceTable
+{
+public:
+    struct Entry
+    {
+        BinaryResource::Value value;
+        quint16 density;
+        QString language;
+    };
+
+    explicit ResourceTable(const QByteArray &data);
+
+    bool isValid() const;
+    QVector<Entry> getEntries(quint32 id) const;
+    QString getString(quint32 id) const;
+    QString getFilePath(quint32 id) const;
+
+    // Names of the file resources by their paths in the APK, e.g. "res/a.png" -> "drawable/ic_launcher"
+    QHash<QString, QString> getFileNames() const;
+
+private:
+    BinaryResource::Value resolve(const BinaryResource::Value &value, int depth = 0) const;
+
+    QByteArray data;
+    BinaryResource::StringPool strings;
+    BinaryResource::Chunk root;
+};
+
+#endif // RESOURCETABLE_H
@@ -0,0 +1,421 @@
+#include "apk/smaliindex.h"
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QRegularExpression>
+#include <QtConcurrent/QtConcurrent>
+#include <algorithm>
+#include <functional>
+
+namespace
+{
+    bool isWhitespace(char c)
+    {
+        return c == ' ' || c == '\t';
+    }
+
+    // Returns the position of the last space-separated token of the line
+    int lastTokenStart(const QByteArray &line)
+    {
+        int start = line.size();
+        while (start > 0 && !isWhitespace(line.at(start - 1))) {
+            --start;
+        }
+        return start;
+    }
+
+    bool isFieldOpcode(const QByteArray &opcode)
+    {
+        return (opcode.startsWith('i') || opcode.startsWith('s'))
+            && (opcode.mid(1, 3) == "get" || opcode.mid(1, 3) == "put");
+    }
+
+    bool isTypeOpcode(const QByteArray &opcode)
+    {
+        return opcode == "new-instance" || opcode == "check-cast" || opcode == "const-class"
+            || opcode == "instance-of" || opcode == "new-array" || opcode.startsWith("filled-new-array");
+    }
+}
+
+SmaliIndex::~SmaliIndex()
+{
+    cancel();
+}
+
+void SmaliIndex::build(const QString &contentsPath)
+{
+    cancel();
+    const QString path = QDir::cleanPath(contentsPath);
+    const QStringList directories = QDir(path).entryList({"smali", "smali_*"}, QDir::Dirs | QDir::NoDotAndDotDot, QDir::Name);
+
+    QMutexLocker locker(&mutex);
+    this->contentsPath = path;
+    files.clear();
+    fileIds.clear();
+    definitions.clear();
+    usages.clear();
+    fileKeys.clear();
+    pendingUpdates.clear();
+    building = true;
+    locker.unlock();
+
+    future = QtConcurrent::run([this, path, directories]() {
+        QVector<int> ids;
+        for (const QString &directory : directories) {
+            QDirIterator it(QString("%1/%2").arg(path, directory), {"*.smali"}, QDir::Files, QDirIterator::Subdirectories);
+            while (it.hasNext()) {
+                const QString filePath = it.next();
+                QMutexLocker locker(&mutex);
+                ids.append(getFileId(filePath));
+            }
+        }
+
+        // Files are parsed in parallel and merged as soon as they are ready,
+        // so that the partially built index can already be queried.
+        std::function<QPair<int, FileSymbols>(int)> parse = [this](int file) {
+            if (cancelRequested) {
+                return qMakePair(file, FileSymbols());
+            }
+            QMutexLocker locker(&mutex);
+            const QString filePath = files.at(file);
+            locker.unlock();
+            return qMakePair(file, parseFile(filePath));
+        };
+        std::function<void(int &, const QPair<int, FileSymbols> &)> merge = [this](int &count, const QPair<int, FileSymbols> &result) {
+            if (!cancelRequested) {
+                QMutexLocker locker(&mutex);
+                insert(result.first, result.second);
+                ++count;
+            }
+        };
+        QtConcurrent::blockingMappedReduced<int>(ids, parse, merge, QtConcurrent::UnorderedReduce);
+        applyPendingUpdates();
+    });
+}
+
+void SmaliIndex::update(const QString &filePath)
+{
+    const QString path = QDir::cleanPath(filePath);
+    if (!isSmaliFile(path)) {
+        return;
+    }
+    QMutexLocker locker(&mutex);
+    if (contentsPath.isEmpty() || !path.startsWith(contentsPath + '/')) {
+        return;
+    }
+    if (building) {
+        // Applied by the build itself, so that the caller doesn't wait for it:
+        pendingUpdates.insert(path);
+        return;
+    }
+    locker.unlock();
+    reindex(path);
+}
+
+QList<SearchResult> SmaliIndex::findDefinitions(const QString &symbol)
+{
+    return getResults(getLocations(definitions, symbol));
+}
+
+QList<SearchResult> SmaliIndex::findUsages(const QString &symbol)
+{
+    return getResults(getLocations(usages, symbol));
+}
+
+bool SmaliIndex::isSmaliFile(const QString &filePath)
+{
+    return filePath.endsWith(".smali", Qt::CaseInsensitive);
+}
+
+QString SmaliIndex::getSymbol(const QString &line, int column, const QString &className)
+{
+    const QString text = line.trimmed();
+
+    // Definitions:
+    if (text.startsWith(".class ")) {
+        return text.section(' ', -1);
+    }
+    if (text.startsWith(".method ") && !className.isEmpty()) {
+        return className + "->" + text.section(' ', -1);
+    }
+    if (text.startsWith(".field ") && !className.isEmpty()) {
+        return className + "->" + text.section(" = ", 0, 0).section(' ', -1);
+    }
+
+    // String literals:
+    if (text.startsWith("const-string")) {
+        const int quote = line.indexOf('"');
+        if (quote != -1 && column >= quote) {
+            return line.mid(quote).trimmed();
+        }
+    }
+
+    // References (the token under the cursor):
+    auto isDelimiter = [](QChar c) {
+        return c.isSpace() || c == ',' || c == '{' || c == '}';
+    };
+    if (column < 0 || column > line.size()) {
+        return QString();
+    }
+    if (column == line.size() || isDelimiter(line.at(column))) {
+        if (column == 0 || isDelimiter(line.at(column - 1))) {
+            return QString();
+        }
+        --column;
+    }
+    int start = column;
+    while (start > 0 && !isDelimiter(line.at(start - 1))) {
+        --start;
+    }
+    int end = column;
+    while (end < line.size() && !isDelimiter(line.at(end))) {
+        ++end;
+    }
+    const QString token = line.mid(start, end - start);
+
+    // Class descriptors, including the ones inside method references:
+    static const QRegularExpression descriptor("\\[*(L[^;()]+;)");
+    auto it = descriptor.globalMatch(token);
+    while (it.hasNext()) {
+        const auto match = it.next();
+        const int position = column - start;
+        if (position >= match.capturedStart() && position < match.capturedEnd()) {
+            return match.captured(1);
+        }
+    }
+    return token.contains("->") ? token : QString();
+}
+
+QString SmaliIndex::getClassName(const QString &line)
+{
+    const QString text = line.trimmed();
+    return text.startsWith(".class ") ? text.section(' ', -1) : QString();
+}
+
+void SmaliIndex::cancel()
+{
+    cancelRequested = 1;
+    future.waitForFinished();
+    cancelRequested = 0;
+}
+
+void SmaliIndex::reindex(const QString &filePath)
+{
+    const bool exists = QFile::exists(filePath);
+    const FileSymbols symbols = exists ? parseFile(filePath) : FileSymbols();
+    QMutexLocker locker(&mutex);
+    const int file = getFileId(filePath);
+    remove(file);
+    if (exists) {
+        insert(file, symbols);
+    }
+}
+
+void SmaliIndex::applyPendingUpdates()
+{
+    forever {
+        QMutexLocker locker(&mutex);
+        if (cancelRequested || pendingUpdates.isEmpty()) {
+            building = false;
+            return;
+        }
+        const QString filePath = *pendingUpdates.constBegin();
+        pendingUpdates.remove(filePath);
+        locker.unlock();
+        reindex(filePath);
+    }
+}
+
+void SmaliIndex::insert(int file, const FileSymbols &symbols)
+{
+    QVector<QByteArray> &keys = fileKeys[file];
+    for (auto symbol : symbols.definitions) {
+        symbol.second.file = file;
+        definitions[symbol.first].append(symbol.second);
+        keys.append(symbol.first);
+    }
+    for (auto symbol : symbols.usages) {
+        symbol.second.file = file;
+        usages[symbol.first].append(symbol.second);
+        keys.append(symbol.first);
+    }
+}
+
+void SmaliIndex::remove(int file)
+{
+    QVector<QByteArray> keys = fileKeys.take(file);
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+    auto isInFile = [file](const Occurrence &occurrence) {
+        return occurrence.file == file;
+    };
+    for (const QByteArray &key : qAsConst(keys)) {
+        for (auto table : {&definitions, &usages}) {
+            auto it = table->find(key);
+            if (it == table->end()) {
+                continue;
+            }
+            QVector<Occurrence> &occurrences = it.value();
+            occurrences.erase(std::remove_if(occurrences.begin(), occurrences.end(), isInFile), occurrences.end());
+            if (occurrences.isEmpty()) {
+                table->erase(it);
+            }
+        }
+    }
+}
+
+int SmaliIndex::getFileId(const QString &filePath)
+{
+    auto it = fileIds.constFind(filePath);
+    if (it != fileIds.constEnd()) {
+        return it.value();
+    }
+    files.append(filePath);
+    fileIds.insert(filePath, files.size() - 1);
+    return files.size() - 1;
+}
+
+QVector<QPair<QString, SmaliIndex::Occurrence>> SmaliIndex::getLocations(const QHash<QByteArray, QVector<Occurrence>> &table, const QString &symbol) const
+{
+    // Only the occurrences are copied under the lock, the lines are read without holding it:
+    QMutexLocker locker(&mutex);
+    const QVector<Occurrence> occurrences = table.value(symbol.toUtf8());
+    QVector<QPair<QString, Occurrence>> locations;
+    locations.reserve(occurrences.size());
+    for (const Occurrence &occurrence : occurrences) {
+        locations.append({files.at(occurrence.file), occurrence});
+    }
+    return locations;
+}
+
+QList<SearchResult> SmaliIndex::getResults(QVector<QPair<QString, Occurrence>> locations)
+{
+    std::sort(locations.begin(), locations.end(), [](const QPair<QString, Occurrence> &a, const QPair<QString, Occurrence> &b) {
+        if (a.first != b.first) {
+            return a.first < b.first;
+        }
+        return a.second.line < b.second.line;
+    });
+
+    QList<SearchResult> results;
+    QFile file;
+    for (const auto &location : qAsConst(locations)) {
+        const QString &filePath = location.first;
+        const Occurrence &occurrence = location.second;
+        if (file.fileName() != filePath) {
+            file.close();
+            file.setFileName(filePath);
+            file.open(QFile::ReadOnly);
+        }
+        QString lineContent;
+        if (file.isOpen() && file.seek(occurrence.offset)) {
+            QByteArray line = file.readLine();
+            while (line.endsWith('\n') || line.endsWith('\r')) {
+                line.chop(1);
+            }
+            lineContent = QString::fromUtf8(line);
+        }
+        results.append(SearchResult(filePath, lineContent, occurrence.line, occurrence.column, occurrence.length));
+    }
+    return results;
+}
+
+SmaliIndex::FileSymbols SmaliIndex::parseFile(const QString &filePath)
+{
+    QFile file(filePath);
+    if (!file.open(QFile::ReadOnly)) {
+        return {};
+    }
+    const QByteArray data = file.readAll();
+
+    FileSymbols symbols;
+    QByteArray className;
+    int lineNumber = 0;
+    int offset = 0;
+    while (offset < data.size()) {
+        int lineEnd = data.indexOf('\n', offset);
+        if (lineEnd == -1) {
+            lineEnd = data.size();
+        }
+        ++lineNumber;
+        const int lineOffset = offset;
+        offset = lineEnd + 1;
+
+        int indent = lineOffset;
+        while (indent < lineEnd && isWhitespace(data.at(indent))) {
+            ++indent;
+        }
+        int end = lineEnd;
+        while (end > indent && (data.at(end - 1) == '\r' || isWhitespace(data.at(end - 1)))) {
+            --end;
+        }
+        if (indent == end || data.at(indent) == '#') {
+            continue;
+        }
+        const QByteArray line = QByteArray::fromRawData(data.constData() + indent, end - indent);
+        const int column = indent - lineOffset;
+
+        // Byte positions are converted to UTF-16 ones, same as the columns of the editor (non-ASCII lines only):
+        const bool ascii = std::all_of(data.constData() + lineOffset, data.constData() + end, [](char c) {
+            return static_cast<uchar>(c) < 0x80;
+        });
+        auto add = [&](QVector<QPair<QByteArray, Occurrence>> &table, const QByteArray &key, int start, int length) {
+            int matchColumn = column + start;
+            int matchLength = length;
+            if (!ascii) {
+                matchColumn = QString::fromUtf8(data.constData() + lineOffset, column + start).size();
+                matchLength = QString::fromUtf8(line.constData() + start, length).size();
+            }
+            table.append({key, Occurrence{-1, lineNumber, matchColumn, matchLength, lineOffset}});
+        };
+
+        if (line.startsWith('.')) {
+            const int tokenStart = lastTokenStart(line);
+            const QByteArray token(line.constData() + tokenStart, line.size() - tokenStart);
+            if (line.startsWith(".class ")) {
+                className = token;
+                add(symbols.definitions, className, tokenStart, token.size());
+            } else if (line.startsWith(".super ") || line.startsWith(".implements ")) {
+                add(symbols.usages, token, tokenStart, token.size());
+            } else if (line.startsWith(".method ") && !className.isEmpty()) {
+                add(symbols.definitions, className + "->" + token, tokenStart, token.size());
+            } else if (line.startsWith(".field ") && !className.isEmpty()) {
+                // Initial value is optional: ".field static final NAME:I = 0x1"
+                const int valueStart = line.indexOf(" = ");
+                const QByteArray declaration = QByteArray::fromRawData(line.constData(), valueStart == -1 ? line.size() : valueStart);
+                const int nameStart = lastTokenStart(declaration);
+                const QByteArray name(declaration.constData() + nameStart, declaration.size() - nameStart);
+                add(symbols.definitions, className + "->" + name, nameStart, name.size());
+            }
+            continue;
+        }
+
+        const int opcodeEnd = line.indexOf(' ');
+        if (opcodeEnd == -1) {
+            continue;
+        }
+        const QByteArray opcode(line.constData(), opcodeEnd);
+        if (opcode.startsWith("invoke-") || isFieldOpcode(opcode)) {
+            const int tokenStart = lastTokenStart(line);
+            const QByteArray reference(line.constData() + tokenStart, line.size() - tokenStart);
+            if (reference.contains("->")) {
+                add(symbols.usages, reference, tokenStart, reference.size());
+            }
+        } else if (opcode.startsWith("const-string")) {
+            const int quote = line.indexOf('"');
+            if (quote != -1) {
+                add(symbols.usages, QByteArray(line.constData() + quote, line.size() - quote), quote, line.size() - quote);
+            }
+        } else if (isTypeOpcode(opcode)) {
+            int tokenStart = lastTokenStart(line);
+            while (tokenStart < line.size() && line.at(tokenStart) == '[') {
+                ++tokenStart;
+            }
+            const QByteArray type(line.constData() + tokenStart, line.size() - tokenStart);
+            if (type.startsWith('L') && type.endsWith(';')) {
+                add(symbols.usages, type, tokenStart, type.size());
+            }
+        }
+    }
+    return symbols;
+}
@@ -0,0 +1,75 @@
+#ifndef SMALIINDEX_H
+#define SMALIINDEX_H
+
+#include "base/searchresult.h"
+#include <QAtomicInt>
+#include <QFuture>
+#include <QHash>
+#include <QMutex>
+#include <QPair>
+#include <QSet>
+#include <QStringList>
+#include <QVector>
+
+// Symbols of all smali trees of the project: class, method and field definitions,
+// method invocations, field accesses, type references and string literals.
+// Symbols are keyed the same way they are referenced in smali, e.g.
+// "Lcom/example/Foo;", "Lcom/example/Foo;->bar(I)V", "Lcom/example/Foo;->baz:I".
+// Lookups read the matched lines from the files, so they are meant to be run off the GUI thread.
+
+class SmaliIndex
+{
+public:
+    ~SmaliIndex();
+
+    void build(const QString &contentsPath);
+    void update(const QString &filePath);
+    QList<SearchResult> findDefinitions(const QString &symbol);
+    QList<SearchResult> findUsages(const QString &symbol);
+
+    static bool isSmaliFile(const QString &filePath);
+    static QString getSymbol(const QString &line, int column, const QString &className);
+    static QString getClassName(const QString &line);
+
+private:
+    struct Occurrence
+    {
+        int file;
+        int line;
+        int column; // In UTF-16 code units, same as the length
+        int length;
+        qint64 offset; // Byte offset of the line in the file
+    };
+
+    struct FileSymbols
+    {
+        QVector<QPair<QByteArray, Occurrence>> definitions;
+        QVector<QPair<QByteArray, Occurrence>> usages;
+    };
+
+    void cancel();
+    void reindex(const QString &filePath);
+    void applyPendingUpdates();
+    void insert(int file, const FileSymbols &symbols);
+    void remove(int file);
+    int getFileId(const QString &filePath);
+    QVector<QPair<QString, Occurrence>> getLocations(const QHash<QByteArray, QVector<Occurrence>> &table, const QString &symbol) const;
+
+    static QList<SearchResult> getResults(QVector<QPair<QString, Occurrence>> locations);
+
+    static FileSymbols parseFile(const QString &filePath);
+
+    QString contentsPath;
+    QStringList files;
+    QHash<QString, int> fileIds;
+    QHash<QByteArray, QVector<Occurrence>> definitions;
+    QHash<QByteArray, QVector<Occurrence>> usages;
+    QHash<int, QVector<QByteArray>> fileKeys;
+    QSet<QString> pendingUpdates; // Files saved while the index is being built
+    bool building = false;
+    mutable QMutex mutex;
+    QFuture<void> future;
+    QAtomicInt cancelRequested;
+};
+
+#endif // SMALIINDEX_H
@@ -1,63 +1,26 @@
 #include "apk/titleitemsmodel.h"
-#include <QFile>
-#include <QDirIterator>
-#include <QTextStream>
+#include "apk/apkpatch.h"
+#include "apk/valuesindex.h"
 #include <QDebug>
 #include <QtConcurrent/QtConcurrent>
 
-TitleItemsModel::TitleItemsModel(const Package *apk, QObject *parent) : QAbstractTableModel(parent)
+TitleItemsModel::TitleItemsModel(const Package *apk, QObject *parent) : QAbstractTableModel(parent), valuesIndex(apk->valuesIndex), apkPatch(apk->apkPatch)
 {
-    // Parse application label attribute (android:label):
-
-    auto finishedFuture = QtConcurrent::run([=]() -> QList<TitleNode *> {
-        QList<TitleNode *> result;
-        QString labelAttribute = apk->manifest->applicationScope->label().getValue();
-        if (!labelAttribute.startsWith("@string/")) {
+    // Find application label values (android:label):
+
+    const QString labelAttribute = apk->manifest->applicationScope->label().getValue();
+    const QSharedPointer<ValuesIndex> valuesIndex = this->valuesIndex;
+    auto finishedFuture = QtConcurrent::run([labelAttribute, valuesIndex]() -> QList<TitleNode *> {
+        QString type;
+        QString name;
+        if (!ValuesIndex::parseReference(labelAttribute, type, name) || type != "string") {
             return {};
         }
-        QString labelKey = labelAttribute.mid(QString("@string/").length());
-
-        // Parse resource directories:
-
-        QDirIterator resourceDirectories(apk->getContentsPath() + "/res/", QDir::Dirs | QDir::NoDotAndDotDot);
-        while (resourceDirectories.hasNext()) {
-
-            const QString resourceDirectory = QFileInfo(resourceDirectories.next()).fileName();
-            const QString resourceType = resourceDirectory.split('-').first();
-
-            if (resourceType == "values") {
-
-                // Parse resource files:
-
-                QDirIterator resourceFiles(apk->getContentsPath() + "/res/" + resourceDirectory, QDir::Files);
-                while (resourceFiles.hasNext()) {
-                    const QString resourceFile = QFileInfo(resourceFiles.next()).filePath();
-                    QFile xml(resourceFile);
-                    if (xml.open(QFile::ReadOnly)) {
-                        QTextStream stream(&xml);
-                        stream.setCodec("UTF-8");
-                        QDomDocument xmlDocument;
-                        xmlDocument.setContent(stream.readAll());
-
-                        // Iterate through XML child elements:
-
-                        QDomNodeList xmlNodes = xmlDocument.firstChildElement("resources").childNodes();
-                        for (int i = 0; i < xmlNodes.count(); ++i) {
-                            QDomElement xmlNode = xmlNodes.at(i).toElement();
-                            if (Q_LIKELY(!xmlNode.isNull())) {
-
-                                // Find application label nodes:
-
-                                if (xmlNode.nodeName() == "string" && xmlNode.attribute("name") == labelKey) {
-                                    result << new TitleNode(new XmlNode(xmlNode, true), new ResourceFile(resourceFile));
-                                }
-                            } else {
-                                qWarning() << "CRITICAL: Element \"resources\" contains non-element child nodes";
-                            }
-                        }
-                    }
-                }
-            }
+        QList<TitleNode *> result;
+        valuesIndex->waitForBuild();
+        const auto entries = valuesIndex->find(type, name);
+        for (const auto &entry : entries) {
+            result << new TitleNode(name, entry.value, new ResourceFile(entry.file));
         }
         return result;
     });
@@ -82,8 +45,15 @@ TitleItemsModel::~TitleItemsModel()
 
 void TitleItemsModel::save() const
 {
-    for (const TitleNode *title : nodes) {
-        title->save();
+    for (TitleNode *title : nodes) {
+        const bool modified = title->isModified();
+        const QString savedValue = title->getSavedValue();
+        if (title->save()) {
+            valuesIndex->update(title->file->getFilePath());
+            if (modified) {
+                apkPatch->setString(title->getName(), title->file->getQualifiers().section('-', 1), savedValue, title->getValue());
+            }
+        }
     }
 }
 
@@ -92,8 +62,8 @@ bool TitleItemsModel::setData(const QModelIndex &index, const QVariant &value, i
     if (index.isValid() && role == Qt::EditRole) {
         const int row = index.row();
         TitleNode *title = nodes.at(row);
-        if (title->node->getValue() != value) {
-            title->node->setValue(value.toString());
+        if (title->getValue() != value) {
+            title->setValue(value.toString());
             emit dataChanged(index, index);
             return true;
         }
@@ -108,7 +78,7 @@ QVariant TitleItemsModel::data(const QModelIndex &index, int role) const
         if (role == Qt::DisplayRole || role == Qt::EditRole) {
             switch (index.column()) {
             case ValueColumn:
-                return title->node->getValue();
+                return title->getValue();
             case LanguageColumn:
                 return title->file->getLanguageName();
             case QualifiersColumn:
@@ -5,6 +5,9 @@
 #include "apk/titlenode.h"
 #include <QAbstractTableModel>
 
+class ApkPatch;
+class ValuesIndex;
+
 class TitleItemsModel : public QAbstractTableModel
 {
     Q_OBJECT
@@ -36,6 +39,8 @@ signals:
 
 private:
     QList<TitleNode *> nodes;
+    QSharedPointer<ValuesIndex> valuesIndex;
+    QSharedPointer<ApkPatch> apkPatch;
 };
 
 #endif // TITLEITEMSMODEL_H
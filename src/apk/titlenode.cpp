@@ -1,30 +1,92 @@
 #include "apk/titlenode.h"
+#include <QDomDocument>
 #include <QFile>
+#include <QSaveFile>
+#include <QTextStream>
 #include <QDebug>
 
-TitleNode::TitleNode(XmlNode *node, ResourceFile *file)
+TitleNode::TitleNode(const QString &name, const QString &value, ResourceFile *file)
 {
-    this->node = node;
+    this->name = name;
+    this->value = value;
+    this->savedValue = value;
     this->file = file;
+    modified = false;
 }
 
 TitleNode::~TitleNode()
 {
-    delete node;
     delete file;
 }
 
-bool TitleNode::save() const
+const QString &TitleNode::getName() const
 {
-    if (node->wasModified()) {
-        QFile xml(file->getFilePath());
-        if (!xml.open(QFile::ReadWrite)) {
-            qWarning() << "Error: Could not save titles resource file";
-            return false;
-        }
-        xml.resize(0);
-        QTextStream stream(&xml);
-        node->getDocument().save(stream, 4);
+    return name;
+}
+
+const QString &TitleNode::getValue() const
+{
+    return value;
+}
+
+const QString &TitleNode::getSavedValue() const
+{
+    return savedValue;
+}
+
+bool TitleNode::isModified() const
+{
+    return modified;
+}
+
+void TitleNode::setValue(const QString &value)
+{
+    this->value = value;
+    modified = true;
+}
+
+bool TitleNode::save()
+{
+    if (!modified) {
+        return true;
+    }
+
+    // The document is only parsed when it actually needs to be written:
+    QDomDocument document;
+    QFile input(file->getFilePath());
+    if (!input.open(QFile::ReadOnly) || !document.setContent(&input)) {
+        qWarning() << "Error: Could not read titles resource file";
+        return false;
+    }
+    input.close();
+
+    QDomElement element = document.firstChildElement("resources").firstChildElement("string");
+    while (!element.isNull() && element.attribute("name") != name) {
+        element = element.nextSiblingElement("string");
+    }
+    if (element.isNull()) {
+        qWarning() << "Error: Could not find title in resource file";
+        return false;
+    }
+    if (element.firstChild().isNull()) {
+        element.appendChild(document.createTextNode(value));
+    } else {
+        element.firstChild().setNodeValue(value);
+    }
+
+    QSaveFile output(file->getFilePath());
+    if (!output.open(QFile::WriteOnly)) {
+        qWarning() << "Error: Could not save titles resource file";
+        return false;
+    }
+    QTextStream stream(&output);
+    document.save(stream, 4);
+    stream.flush();
+    if (!output.commit()) {
+        qWarning() << "Error: Could not save titles resource file";
+        return false;
     }
+    savedValue = value;
+    modified = false;
     return true;
 }
@@ -1,19 +1,28 @@
 #ifndef TITLENODE_H
 #define TITLENODE_H
 
-#include "apk/xmlnode.h"
 #include "apk/resourcefile.h"
 
 class TitleNode
 {
 public:
-    TitleNode(XmlNode *node, ResourceFile *file);
+    TitleNode(const QString &name, const QString &value, ResourceFile *file);
     ~TitleNode();
 
-    bool save() const;
+    const QString &getName() const;
+    const QString &getValue() const;
+    const QString &getSavedValue() const;
+    bool isModified() const;
+    void setValue(const QString &value);
+    bool save();
 
-    XmlNode *node;
     const ResourceFile *file;
+
+private:
+    QString name;
+    QString value;
+    QString savedValue;
+    bool modified;
 };
 
 #endif // TITLENODE_H
@@ -0,0 +1,248 @@
+#include "apk/valuesindex.h"
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QXmlStreamReader>
+#include <QtConcurrent/QtConcurrent>
+#include <algorithm>
+#include <functional>
+
+namespace
+{
+    // Converts the UTF-16 offsets reported by QXmlStreamReader to UTF-8 byte offsets.
+    // Offsets only grow while reading, so the conversion is a single pass over the file.
+    class ByteOffsetCounter
+    {
+    public:
+        explicit ByteOffsetCounter(const QByteArray &data) : data(data) {}
+
+        qint64 toByteOffset(qint64 characterOffset)
+        {
+            while (characters < characterOffset && bytes < data.size()) {
+                const uchar byte = static_cast<uchar>(data.at(bytes));
+                if (byte < 0x80) {
+                    bytes += 1;
+                } else if (byte < 0xE0) {
+                    bytes += 2;
+                } else if (byte < 0xF0) {
+                    bytes += 3;
+                } else {
+                    bytes += 4;
+                    ++characters; // Surrogate pair
+                }
+                ++characters;
+            }
+            return qMin<qint64>(bytes, data.size());
+        }
+
+    private:
+        const QByteArray &data;
+        qint64 bytes = 0;
+        qint64 characters = 0;
+    };
+}
+
+ValuesIndex::~ValuesIndex()
+{
+    cancel();
+}
+
+void ValuesIndex::build(const QString &resourcesPath)
+{
+    cancel();
+    {
+        QMutexLocker locker(&mutex);
+        this->resourcesPath = QDir::cleanPath(resourcesPath);
+        entries.clear();
+        fileKeys.clear();
+        pendingUpdates.clear();
+        building = true;
+    }
+
+    const QString path = this->resourcesPath;
+    QFuture<void> future = QtConcurrent::run([this, path]() {
+        QStringList files;
+        const QStringList directories = QDir(path).entryList({"values", "values-*"}, QDir::Dirs | QDir::NoDotAndDotDot, QDir::Name);
+        for (const QString &directory : directories) {
+            QDirIterator it(QString("%1/%2").arg(path, directory), {"*.xml"}, QDir::Files);
+            while (it.hasNext()) {
+                files.append(it.next());
+            }
+        }
+
+        // Files are merged as soon as they are parsed, so that lookups don't have to wait for the whole build:
+        std::function<QPair<QString, FileEntries>(const QString &)> parse = [this](const QString &filePath) {
+            return qMakePair(filePath, cancelRequested ? FileEntries() : parseFile(filePath));
+        };
+        std::function<void(int &, const QPair<QString, FileEntries> &)> merge = [this](int &count, const QPair<QString, FileEntries> &result) {
+            if (!cancelRequested) {
+                QMutexLocker locker(&mutex);
+                insert(result.first, result.second);
+                ++count;
+            }
+        };
+        QtConcurrent::blockingMappedReduced<int>(files, parse, merge, QtConcurrent::OrderedReduce);
+        applyPendingUpdates();
+    });
+    QMutexLocker locker(&mutex);
+    this->future = future;
+}
+
+void ValuesIndex::update(const QString &filePath)
+{
+    const QString path = QDir::cleanPath(filePath);
+    QMutexLocker locker(&mutex);
+    if (!isValuesFile(path)) {
+        return;
+    }
+    if (building) {
+        // Applied by the build itself, so that the caller doesn't wait for it:
+        pendingUpdates.insert(path);
+        return;
+    }
+    locker.unlock();
+    reindex(path);
+}
+
+void ValuesIndex::waitForBuild()
+{
+    // Only to be called from worker threads, lookups on the GUI thread use whatever is indexed so far
+    QMutexLocker locker(&mutex);
+    QFuture<void> future = this->future;
+    locker.unlock();
+    future.waitForFinished();
+}
+
+QVector<ValuesIndex::Entry> ValuesIndex::find(const QString &type, const QString &name)
+{
+    QMutexLocker locker(&mutex);
+    return entries.value(getKey(type, name));
+}
+
+bool ValuesIndex::parseReference(const QString &reference, QString &type, QString &name)
+{
+    // E.g., "@string/app_name" or "@android:string/ok" (the latter is not a part of the package)
+    if (!reference.startsWith('@') || reference.contains(':')) {
+        return false;
+    }
+    const int slash = reference.indexOf('/');
+    if (slash < 2 || slash == reference.size() - 1) {
+        return false;
+    }
+    type = reference.mid(1, slash - 1);
+    name = reference.mid(slash + 1);
+    return true;
+}
+
+void ValuesIndex::cancel()
+{
+    cancelRequested = 1;
+    future.waitForFinished();
+    cancelRequested = 0;
+}
+
+void ValuesIndex::reindex(const QString &filePath)
+{
+    const bool exists = QFile::exists(filePath);
+    const FileEntries fileEntries = exists ? parseFile(filePath) : FileEntries();
+    QMutexLocker locker(&mutex);
+    remove(filePath);
+    if (exists) {
+        insert(filePath, fileEntries);
+    }
+}
+
+void ValuesIndex::applyPendingUpdates()
+{
+    forever {
+        QMutexLocker locker(&mutex);
+        if (cancelRequested || pendingUpdates.isEmpty()) {
+            building = false;
+            return;
+        }
+        const QString filePath = *pendingUpdates.constBegin();
+        pendingUpdates.remove(filePath);
+        locker.unlock();
+        reindex(filePath);
+    }
+}
+
+void ValuesIndex::insert(const QString &filePath, const FileEntries &fileEntries)
+{
+    QStringList &keys = fileKeys[filePath];
+    for (const auto &entry : fileEntries) {
+        entries[entry.first].append(entry.second);
+        keys.append(entry.first);
+    }
+}
+
+void ValuesIndex::remove(const QString &filePath)
+{
+    const QStringList keys = fileKeys.take(filePath);
+    for (const QString &key : keys) {
+        auto it = entries.find(key);
+        if (it == entries.end()) {
+            continue;
+        }
+        QVector<Entry> &keyEntries = it.value();
+        keyEntries.erase(std::remove_if(keyEntries.begin(), keyEntries.end(), [&filePath](const Entry &entry) {
+            return entry.file == filePath;
+        }), keyEntries.end());
+        if (keyEntries.isEmpty()) {
+            entries.erase(it);
+        }
+    }
+}
+
+bool ValuesIndex::isValuesFile(const QString &filePath) const
+{
+    const QFileInfo fileInfo(filePath);
+    const QString directory = fileInfo.dir().dirName();
+    return !resourcesPath.isEmpty()
+        && fileInfo.dir().path() == QString("%1/%2").arg(resourcesPath, directory)
+        && (directory == "values" || directory.startsWith("values-"))
+        && fileInfo.suffix() == "xml";
+}
+
+ValuesIndex::FileEntries ValuesIndex::parseFile(const QString &filePath)
+{
+    QFile file(filePath);
+    if (!file.open(QFile::ReadOnly)) {
+        return {};
+    }
+    const QByteArray data = file.readAll();
+
+    // Shared by all the entries of the file:
+    const QString directory = QFileInfo(filePath).dir().dirName();
+    const QString qualifiers = directory.mid(QString("values").length() + 1);
+
+    FileEntries result;
+    ByteOffsetCounter counter(data);
+    QXmlStreamReader xml(data);
+    if (!xml.readNextStartElement() || xml.name() != QLatin1String("resources")) {
+        return {};
+    }
+    while (xml.readNextStartElement()) {
+        // Type is either the tag name or the "type" attribute of <item> elements:
+        const QXmlStreamAttributes attributes = xml.attributes();
+        const QString name = attributes.value("name").toString();
+        QString type = xml.name().toString();
+        if (type == QLatin1String("item") && attributes.hasAttribute("type")) {
+            type = attributes.value("type").toString();
+        }
+        Entry entry;
+        entry.qualifiers = qualifiers;
+        entry.file = filePath;
+        entry.offset = counter.toByteOffset(xml.characterOffset());
+        entry.value = xml.readElementText(QXmlStreamReader::IncludeChildElements);
+        if (!name.isEmpty()) {
+            result.append({getKey(type, name), entry});
+        }
+    }
+    return result;
+}
+
+QString ValuesIndex::getKey(const QString &type, const QString &name)
+{
+    return type + '/' + name;
+}
@@ -0,0 +1,56 @@
+#ifndef VALUESINDEX_H
+#define VALUESINDEX_H
+
+#include <QAtomicInt>
+#include <QFuture>
+#include <QHash>
+#include <QMutex>
+#include <QPair>
+#include <QSet>
+#include <QStringList>
+#include <QVector>
+
+class ValuesIndex
+{
+public:
+    struct Entry
+    {
+        QString qualifiers; // E.g., "ru", "v21", or empty for the default "values" directory
+        QString value;
+        QString file;
+        qint64 offset = -1; // Byte offset of the element contents in the file
+    };
+
+    ~ValuesIndex();
+
+    void build(const QString &resourcesPath);
+    void update(const QString &filePath);
+    void waitForBuild();
+    QVector<Entry> find(const QString &type, const QString &name);
+
+    static bool parseReference(const QString &reference, QString &type, QString &name);
+
+private:
+    typedef QVector<QPair<QString, Entry>> FileEntries;
+
+    void cancel();
+    void reindex(const QString &filePath);
+    void applyPendingUpdates();
+    void insert(const QString &filePath, const FileEntries &fileEntries);
+    void remove(const QString &filePath);
+    bool isValuesFile(const QString &filePath) const;
+
+    static FileEntries parseFile(const QString &filePath);
+    static QString getKey(const QString &type, const QString &name);
+
+    QString resourcesPath;
+    QHash<QString, QVector<Entry>> entries;
+    QHash<QString, QStringList> fileKeys;
+    QSet<QString> pendingUpdates; // Files saved while the index is being built
+    bool building = false;
+    QMutex mutex;
+    QFuture<void> future;
+    QAtomicInt cancelRequested;
+};
+
+#endif // VALUESINDEX_H
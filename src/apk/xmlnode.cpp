@@ -1,11 +1,8 @@
 #include "apk/xmlnode.h"
 
-XmlNode::XmlNode(const QDomElement &node, bool keepDocument)
+XmlNode::XmlNode(const QDomElement &node)
 {
     this->node = node;
-    if (keepDocument) {
-        document = node.ownerDocument();
-    }
     modified = false;
 }
 
@@ -64,11 +61,6 @@ QString XmlNode::getReadableType() const
     }
 }
 
-QDomDocument XmlNode::getDocument() const
-{
-    return document;
-}
-
 bool XmlNode::wasModified() const
 {
     return modified;
@@ -10,14 +10,13 @@ class XmlNode
     Q_DECLARE_TR_FUNCTIONS(XmlNode)
 
 public:
-    explicit XmlNode(const QDomElement &node, bool keepDocument = false);
+    explicit XmlNode(const QDomElement &node);
     ~XmlNode();
 
     QString getTagName() const;
     QString getAttribute(const QString &attribute) const;
     QString getValue() const;
     QString getReadableType() const;
-    QDomDocument getDocument() const;
 
     bool wasModified() const;
 
@@ -32,7 +31,6 @@ public:
 
 private:
     QDomElement node;
-    QDomDocument document;
 
     bool modified;
 
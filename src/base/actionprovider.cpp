@@ -206,6 +206,32 @@ QAction *ActionProvider::getReplace(QWidget *parent) const
     return action;
 }
 
+QAction *ActionProvider::getGoToDefinition(QWidget *parent) const
+{
+    auto action = new QAction(QIcon::fromTheme("go-jump-definition"), {}, parent);
+    action->setShortcut(QKeySequence("F2"));
+    action->setShortcutContext(Qt::WidgetWithChildrenShortcut);
+
+    auto translate = [=]() { action->setText(tr("Go to &Definition")); };
+    connect(this, &ActionProvider::languageChanged, action, translate);
+    translate();
+
+    return action;
+}
+
+QAction *ActionProvider::getFindUsages(QWidget *parent) const
+{
+    auto action = new QAction(QIcon::fromTheme("edit-find"), {}, parent);
+    action->setShortcut(QKeySequence("Shift+F2"));
+    action->setShortcutContext(Qt::WidgetWithChildrenShortcut);
+
+    auto translate = [=]() { action->setText(tr("Find &Usages")); };
+    connect(this, &ActionProvider::languageChanged, action, translate);
+    translate();
+
+    return action;
+}
+
 QAction *ActionProvider::getSearchCaseSensitive(QWidget *parent) const
 {
     auto action = new QAction(QIcon::fromTheme("edit-find-case-sensitive"), {}, parent);
@@ -37,6 +37,8 @@ public:
     QAction *getFindNext(QWidget *parent) const;
     QAction *getFindPrevious(QWidget *parent) const;
     QAction *getReplace(QWidget *parent) const;
+    QAction *getGoToDefinition(QWidget *parent) const;
+    QAction *getFindUsages(QWidget *parent) const;
 
     QAction *getSearchCaseSensitive(QWidget *parent) const;
     QAction *getSearchByRegex(QWidget *parent) const;
@@ -3,7 +3,10 @@
 
 #include "apk/packagelistmodel.h"
 #include "base/actionprovider.h"
+#include "base/jarworker.h"
 #include "base/language.h"
+#include "base/scheduler.h"
+#include "base/thumbnailservice.h"
 #include <SingleApplication>
 #include <KSyntaxHighlighting/Repository>
 #include <QTranslator>
@@ -30,6 +33,9 @@ public:
     Settings *settings;
     ActionProvider actions;
     KSyntaxHighlighting::Repository highlightingRepository;
+    JarWorkerPool jarWorkers;
+    Scheduler scheduler;
+    ThumbnailService thumbnails;
 
 protected:
     bool event(QEvent *event) override;
@@ -0,0 +1,81 @@
+#include "base/filecatalog.h"
+#include <QFileInfo>
+#include <QImageReader>
+#include <QMimeDatabase>
+#include <QTextCodec>
+
+namespace
+{
+    // Amount of data used to detect the encoding
+    const int EncodingHeadSize = 16 * 1024;
+}
+
+FileCatalog::Entry FileCatalog::getEntry(const QString &path)
+{
+    return getEntry(QFileInfo(path));
+}
+
+FileCatalog::Entry FileCatalog::getEntry(const QFileInfo &fileInfo)
+{
+    // Cached entries are valid until the file size or modification time changes:
+    const QString path = fileInfo.filePath();
+    const qint64 size = fileInfo.size();
+    const QDateTime modified = fileInfo.lastModified();
+    {
+        QMutexLocker locker(&mutex);
+        auto it = entries.constFind(path);
+        if (it != entries.constEnd() && it->size == size && it->modified == modified) {
+            return it.value();
+        }
+    }
+    const Entry entry = classify(fileInfo);
+    QMutexLocker locker(&mutex);
+    if (fileInfo.exists()) {
+        entries.insert(path, entry);
+    } else {
+        entries.remove(path);
+    }
+    return entry;
+}
+
+void FileCatalog::clear()
+{
+    QMutexLocker locker(&mutex);
+    entries.clear();
+}
+
+FileCatalog::Entry FileCatalog::classify(const QFileInfo &fileInfo)
+{
+    static const QList<QByteArray> imageFormats = QImageReader::supportedImageFormats();
+
+    Entry entry;
+    entry.size = fileInfo.size();
+    entry.modified = fileInfo.lastModified();
+
+    if (imageFormats.contains(fileInfo.suffix().toUtf8())) {
+        entry.kind = Kind::Image;
+    } else if (QMimeDatabase().mimeTypeForFile(fileInfo).inherits("text/plain")) {
+        entry.kind = Kind::Text;
+        QFile file(fileInfo.filePath());
+        if (file.open(QFile::ReadOnly)) {
+            entry.encoding = detectEncoding(file.read(EncodingHeadSize));
+        }
+    }
+    return entry;
+}
+
+QByteArray FileCatalog::detectEncoding(const QByteArray &head)
+{
+    if (head.startsWith("\xEF\xBB\xBF")) {
+        return "UTF-8";
+    }
+    if (head.startsWith("\xFF\xFE")) {
+        return "UTF-16LE";
+    }
+    if (head.startsWith("\xFE\xFF")) {
+        return "UTF-16BE";
+    }
+    QTextCodec::ConverterState state;
+    QTextCodec::codecForName("UTF-8")->toUnicode(head.constData(), head.size(), &state);
+    return state.invalidChars ? "ISO-8859-1" : "UTF-8";
+}
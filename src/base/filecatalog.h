@@ -0,0 +1,42 @@
+#ifndef FILECATALOG_H
+#define FILECATALOG_H
+
+#include <QDateTime>
+#include <QHash>
+#include <QMutex>
+
+class QFileInfo;
+
+class FileCatalog
+{
+public:
+    enum class Kind {
+        Text,
+        Image,
+        Binary
+    };
+
+    struct Entry
+    {
+        Kind kind = Kind::Binary;
+        QByteArray encoding;
+        qint64 size = 0;
+        QDateTime modified;
+
+        bool isText() const { return kind == Kind::Text; }
+        bool isImage() const { return kind == Kind::Image; }
+    };
+
+    Entry getEntry(const QString &path);
+    Entry getEntry(const QFileInfo &fileInfo);
+    void clear();
+
+private:
+    static Entry classify(const QFileInfo &fileInfo);
+    static QByteArray detectEncoding(const QByteArray &head);
+
+    QHash<QString, Entry> entries;
+    QMutex mutex;
+};
+
+#endif // FILECATALOG_H
@@ -1,19 +1,44 @@
 #include "base/jarprocess.h"
 #include "base/application.h"
+#include "base/jarworker.h"
 #include "base/settings.h"
 #include "tools/java.h"
 
 void JarProcess::run(const QString &jar, const QStringList &jarArguments)
 {
-    QStringList arguments;
+    QStringList javaArguments;
     const int minHeapSize = app->settings->getJavaMinHeapSize();
     const int maxHeapSize = app->settings->getJavaMaxHeapSize();
     if (app->settings->getJavaMinHeapSize()) {
-        arguments << QString("-Xms%1m").arg(minHeapSize);
+        javaArguments << QString("-Xms%1m").arg(minHeapSize);
     }
     if (app->settings->getJavaMaxHeapSize()) {
-        arguments << QString("-Xmx%1m").arg(maxHeapSize);
+        javaArguments << QString("-Xmx%1m").arg(maxHeapSize);
     }
+
+    JarWorker *worker = app->settings->getJavaWorkers() ? app->jarWorkers.acquire(jar, javaArguments) : nullptr;
+    if (!worker) {
+        runStandalone(jar, javaArguments, jarArguments);
+        return;
+    }
+
+    connect(worker, &JarWorker::finished, this, [=](bool success, const QString &output) {
+        worker->disconnect(this);
+        emit finished(success, output);
+    });
+    connect(worker, &JarWorker::unsupported, this, [=]() {
+        // Worker could not be started, fall back to a separate JVM:
+        worker->disconnect(this);
+        disconnect(&process, &QProcess::started, this, &Process::started);
+        runStandalone(jar, javaArguments, jarArguments);
+    });
+    emit started();
+    worker->run(jarArguments);
+}
+
+void JarProcess::runStandalone(const QString &jar, const QStringList &javaArguments, const QStringList &jarArguments)
+{
+    QStringList arguments(javaArguments);
     arguments << "-jar" << jar << jarArguments;
     Process::run(Java::getBinaryPath("java"), arguments);
 }
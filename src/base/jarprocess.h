@@ -10,6 +10,9 @@ class JarProcess : public Process
 public:
     JarProcess(QObject *parent = nullptr) : Process(parent) {}
     void run(const QString &jar, const QStringList &arguments = {}) override;
+
+private:
+    void runStandalone(const QString &jar, const QStringList &javaArguments, const QStringList &jarArguments);
 };
 
 #endif // JARPROCESS_H
@@ -0,0 +1,194 @@
+#include "base/jarworker.h"
+#include "base/utils.h"
+#include "tools/java.h"
+#include <QUuid>
+#include <QDebug>
+
+namespace
+{
+    const int MaxWorkersPerTool = 2;
+    const int IdleTimeout = 5 * 60 * 1000;
+}
+
+JarWorker::JarWorker(const QString &jar, const QStringList &javaArguments, QObject *parent)
+    : QObject(parent)
+    , jar(jar)
+    , javaArguments(javaArguments)
+    , ready(false)
+    , busy(false)
+    , exitTrapped(false)
+{
+    token = QUuid::createUuid().toByteArray();
+
+    process.setProcessChannelMode(QProcess::MergedChannels);
+    connect(&process, &QProcess::readyReadStandardOutput, this, &JarWorker::onOutput);
+    connect(&process, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
+            this, [this](int exitCode, QProcess::ExitStatus exitStatus) {
+        onExit(exitStatus == QProcess::NormalExit && exitCode == 0);
+    });
+    connect(&process, &QProcess::errorOccurred, this, [this](QProcess::ProcessError error) {
+        if (error == QProcess::FailedToStart) {
+            onExit(false);
+        }
+    });
+
+    // Shut down the JVM to free the memory when it has not been used for a while:
+    idleTimer.setSingleShot(true);
+    idleTimer.setInterval(IdleTimeout);
+    connect(&idleTimer, &QTimer::timeout, this, [this]() {
+        if (!busy) {
+            // Leave the pool first, the JVM may take a while to exit:
+            emit stopping();
+            process.closeWriteChannel();
+        }
+    });
+}
+
+JarWorker::~JarWorker()
+{
+    disconnect(&process, nullptr, this, nullptr);
+    if (process.state() != QProcess::NotRunning) {
+        process.kill();
+        process.waitForFinished(1000);
+    }
+}
+
+void JarWorker::run(const QStringList &arguments)
+{
+    Q_ASSERT(!busy);
+    busy = true;
+    idleTimer.stop();
+    if (ready) {
+        write(arguments);
+        return;
+    }
+    pendingArguments = arguments;
+    if (process.state() == QProcess::NotRunning) {
+        start();
+    }
+}
+
+bool JarWorker::isBusy() const
+{
+    return busy;
+}
+
+void JarWorker::start()
+{
+    buffer.clear();
+    QStringList arguments(javaArguments);
+    arguments << "-cp" << jar << Utils::getSharedPath("tools/JarWorker.java") << jar << token;
+    process.start(Java::getBinaryPath("java"), arguments);
+}
+
+void JarWorker::write(const QStringList &arguments)
+{
+    QByteArray request = QByteArray::number(arguments.size()) + '\n';
+    for (const QString &argument : arguments) {
+        QByteArray escaped = argument.toUtf8();
+        escaped.replace('%', "%25").replace('\n', "%0A").replace('\r', "%0D");
+        request += escaped + '\n';
+    }
+    process.write(request);
+}
+
+void JarWorker::onOutput()
+{
+    buffer.append(process.readAllStandardOutput());
+
+    if (!ready) {
+        const QByteArray readyMarker = token + " ready ";
+        const int index = buffer.indexOf(readyMarker);
+        const int end = index != -1 ? buffer.indexOf('\n', index) : -1;
+        if (end == -1) {
+            return;
+        }
+        exitTrapped = buffer.mid(index + readyMarker.size(), end - index - readyMarker.size()).trimmed() == "1";
+        buffer.remove(0, end + 1);
+        ready = true;
+        if (busy) {
+            write(pendingArguments);
+            pendingArguments.clear();
+        }
+        return;
+    }
+
+    if (!busy) {
+        buffer.clear();
+        return;
+    }
+
+    const QByteArray marker = token + ' ';
+    const int index = buffer.indexOf(marker);
+    const int end = index != -1 ? buffer.indexOf('\n', index) : -1;
+    if (end == -1) {
+        return;
+    }
+    const int status = buffer.mid(index + marker.size(), end - index - marker.size()).trimmed().toInt();
+    const QString output = QString::fromUtf8(buffer.left(index)).replace("\r\n", "\n").trimmed();
+    buffer.remove(0, end + 1);
+    busy = false;
+    idleTimer.start();
+    emit finished(status == 0, output);
+}
+
+void JarWorker::onExit(bool success)
+{
+    const bool wasReady = ready;
+    const bool wasBusy = busy;
+    ready = false;
+    busy = false;
+
+    if (!wasReady) {
+        // E.g., the JVM does not support launching single-file source code programs
+        qWarning() << "Warning: Could not start JAR worker:" << buffer.trimmed();
+        emit unsupported();
+    } else if (wasBusy) {
+        const QString output = QString::fromUtf8(buffer).replace("\r\n", "\n").trimmed();
+        buffer.clear();
+        emit finished(success, output);
+        if (!exitTrapped) {
+            // The tool terminates the JVM by itself, so the worker can not be reused
+            emit unsupported();
+            return;
+        }
+        emit stopped();
+    } else {
+        emit stopped();
+    }
+}
+
+JarWorker *JarWorkerPool::acquire(const QString &jar, const QStringList &javaArguments)
+{
+    const QString key = QStringList(javaArguments + QStringList{Java::getBinaryPath("java"), jar}).join('\n');
+    if (unsupportedKeys.contains(key)) {
+        return nullptr;
+    }
+
+    const QList<JarWorker *> existing = workers.values(key);
+    for (JarWorker *worker : existing) {
+        if (!worker->isBusy()) {
+            return worker;
+        }
+    }
+    if (existing.size() >= MaxWorkersPerTool) {
+        return nullptr;
+    }
+
+    auto worker = new JarWorker(jar, javaArguments, this);
+    connect(worker, &JarWorker::unsupported, this, [=]() {
+        unsupportedKeys.insert(key);
+        workers.remove(key, worker);
+        worker->deleteLater();
+    });
+    connect(worker, &JarWorker::stopping, this, [=]() {
+        workers.remove(key, worker);
+    });
+    connect(worker, &JarWorker::stopped, this, [=]() {
+        // Crashed or idle workers are restarted on the next request
+        workers.remove(key, worker);
+        worker->deleteLater();
+    });
+    workers.insert(key, worker);
+    return worker;
+}
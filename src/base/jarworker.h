@@ -0,0 +1,58 @@
+#ifndef JARWORKER_H
+#define JARWORKER_H
+
+#include <QMultiHash>
+#include <QProcess>
+#include <QSet>
+#include <QTimer>
+
+class JarWorker : public QObject
+{
+    Q_OBJECT
+
+public:
+    JarWorker(const QString &jar, const QStringList &javaArguments, QObject *parent = nullptr);
+    ~JarWorker() override;
+
+    void run(const QStringList &arguments);
+    bool isBusy() const;
+
+signals:
+    void finished(bool success, const QString &output);
+    void unsupported();
+    void stopping();
+    void stopped();
+
+private:
+    void start();
+    void write(const QStringList &arguments);
+    void onOutput();
+    void onExit(bool success);
+
+    QProcess process;
+    QTimer idleTimer;
+    QString jar;
+    QStringList javaArguments;
+    QByteArray token;
+    QByteArray buffer;
+    QStringList pendingArguments;
+    bool ready;
+    bool busy;
+    bool exitTrapped;
+};
+
+class JarWorkerPool : public QObject
+{
+    Q_OBJECT
+
+public:
+    JarWorkerPool(QObject *parent = nullptr) : QObject(parent) {}
+
+    JarWorker *acquire(const QString &jar, const QStringList &javaArguments);
+
+private:
+    QMultiHash<QString, JarWorker *> workers;
+    QSet<QString> unsupportedKeys;
+};
+
+#endif // JARWORKER_H
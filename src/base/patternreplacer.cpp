@@ -0,0 +1,109 @@
+#include "base/patternreplacer.h"
+#include <QQueue>
+
+// Aho-Corasick automaton over raw bytes, compiled into a full transition table, so that
+// all of the patterns are found in a single pass regardless of their count.
+
+void PatternReplacer::add(const QByteArray &pattern, const QByteArray &replacement)
+{
+    if (pattern.isEmpty()) {
+        return;
+    }
+    patterns.append(pattern);
+    replacements.append(replacement);
+    build();
+}
+
+QByteArray PatternReplacer::apply(const QByteArray &data, bool *changed) const
+{
+    if (changed) {
+        *changed = false;
+    }
+    if (patterns.isEmpty()) {
+        return data;
+    }
+
+    // Matches are replaced as soon as they end (the longest pattern wins), without overlapping:
+    QByteArray result;
+    int copied = 0;
+    int state = 0;
+    const auto *bytes = reinterpret_cast<const uchar *>(data.constData());
+    for (int i = 0; i < data.size(); ++i) {
+        state = states.at(state).next[bytes[i]];
+        const int pattern = states.at(state).pattern;
+        if (pattern == -1) {
+            continue;
+        }
+        const int start = i + 1 - patterns.at(pattern).size();
+        if (result.isEmpty()) {
+            result.reserve(data.size());
+        }
+        result.append(data.constData() + copied, start - copied);
+        result.append(replacements.at(pattern));
+        copied = i + 1;
+        state = 0;
+    }
+
+    if (!copied) {
+        return data;
+    }
+    result.append(data.constData() + copied, data.size() - copied);
+    if (changed) {
+        *changed = result != data;
+    }
+    return result;
+}
+
+void PatternReplacer::build()
+{
+    State root;
+    root.next.fill(-1);
+    states = {root};
+
+    for (int p = 0; p < patterns.size(); ++p) {
+        int state = 0;
+        for (const char c : patterns.at(p)) {
+            const uchar byte = static_cast<uchar>(c);
+            if (states[state].next[byte] == -1) {
+                State node;
+                node.next.fill(-1);
+                states.append(node);
+                states[state].next[byte] = states.size() - 1;
+            }
+            state = states[state].next[byte];
+        }
+        if (states[state].pattern == -1 || patterns.at(states[state].pattern).size() < patterns.at(p).size()) {
+            states[state].pattern = p;
+        }
+    }
+
+    // Resolve the failure links breadth-first and turn them into direct transitions:
+    QQueue<int> queue;
+    for (int &next : states[0].next) {
+        if (next == -1) {
+            next = 0;
+        } else {
+            states[next].fail = 0;
+            queue.enqueue(next);
+        }
+    }
+    while (!queue.isEmpty()) {
+        const int state = queue.dequeue();
+        const int fail = states.at(state).fail;
+        // Inherit the longest pattern which ends here as a suffix:
+        const int inherited = states.at(fail).pattern;
+        if (inherited != -1 && (states.at(state).pattern == -1
+                || patterns.at(inherited).size() > patterns.at(states.at(state).pattern).size())) {
+            states[state].pattern = inherited;
+        }
+        for (int byte = 0; byte < 256; ++byte) {
+            const int next = states.at(state).next[byte];
+            if (next == -1) {
+                states[state].next[byte] = states.at(fail).next[byte];
+            } else {
+                states[next].fail = states.at(fail).next[byte];
+                queue.enqueue(next);
+            }
+        }
+    }
+}
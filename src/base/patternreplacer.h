@@ -0,0 +1,29 @@
+#ifndef PATTERNREPLACER_H
+#define PATTERNREPLACER_H
+
+#include <QByteArray>
+#include <QVector>
+#include <array>
+
+class PatternReplacer
+{
+public:
+    void add(const QByteArray &pattern, const QByteArray &replacement);
+    QByteArray apply(const QByteArray &data, bool *changed = nullptr) const;
+
+private:
+    struct State
+    {
+        std::array<int, 256> next;
+        int fail = 0;
+        int pattern = -1;
+    };
+
+    void build();
+
+    QVector<QByteArray> patterns;
+    QVector<QByteArray> replacements;
+    QVector<State> states;
+};
+
+#endif // PATTERNREPLACER_H
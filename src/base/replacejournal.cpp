@@ -0,0 +1,87 @@
+#include "base/replacejournal.h"
+#include <QCryptographicHash>
+#include <QSaveFile>
+#include <QDebug>
+
+bool ReplaceJournal::record(const QString &path, const QByteArray &original, const QByteArray &modified)
+{
+    // The original contents are kept until the journal is destroyed:
+    QMutexLocker locker(&mutex);
+    const QString backupPath = directory.filePath(QString::number(counter++));
+    locker.unlock();
+
+    QFile backup(backupPath);
+    if (!directory.isValid() || !backup.open(QFile::WriteOnly) || backup.write(original) != original.size()) {
+        qWarning() << "Error: Could not write the replace journal.";
+        return false;
+    }
+
+    locker.relock();
+    entries.append({path, backupPath, hash(modified)});
+    return true;
+}
+
+void ReplaceJournal::discard(const QString &path)
+{
+    QMutexLocker locker(&mutex);
+    for (int i = entries.size() - 1; i >= 0; --i) {
+        if (entries.at(i).path == path) {
+            QFile::remove(entries.at(i).backupPath);
+            entries.removeAt(i);
+        }
+    }
+}
+
+bool ReplaceJournal::undo(int &restoredCount)
+{
+    QMutexLocker locker(&mutex);
+    bool success = true;
+    restoredCount = 0;
+    for (int i = entries.size() - 1; i >= 0; --i) {
+        const Entry &entry = entries.at(i);
+
+        // Files changed after the replacement are left as is:
+        QFile current(entry.path);
+        if (!current.open(QFile::ReadOnly) || hash(current.readAll()) != entry.hash) {
+            success = false;
+            continue;
+        }
+        current.close();
+
+        QFile backup(entry.backupPath);
+        QSaveFile target(entry.path);
+        if (!backup.open(QFile::ReadOnly) || !target.open(QFile::WriteOnly)) {
+            success = false;
+            continue;
+        }
+        target.write(backup.readAll());
+        if (!target.commit()) {
+            success = false;
+            continue;
+        }
+        ++restoredCount;
+    }
+    entries.clear();
+    return success;
+}
+
+bool ReplaceJournal::isEmpty() const
+{
+    QMutexLocker locker(&mutex);
+    return entries.isEmpty();
+}
+
+QStringList ReplaceJournal::getPaths() const
+{
+    QMutexLocker locker(&mutex);
+    QStringList paths;
+    for (const Entry &entry : entries) {
+        paths.append(entry.path);
+    }
+    return paths;
+}
+
+QByteArray ReplaceJournal::hash(const QByteArray &data)
+{
+    return QCryptographicHash::hash(data, QCryptographicHash::Md5);
+}
@@ -0,0 +1,33 @@
+#ifndef REPLACEJOURNAL_H
+#define REPLACEJOURNAL_H
+
+#include <QMutex>
+#include <QStringList>
+#include <QTemporaryDir>
+
+class ReplaceJournal
+{
+public:
+    bool record(const QString &path, const QByteArray &original, const QByteArray &modified);
+    void discard(const QString &path);
+    bool undo(int &restoredCount);
+    bool isEmpty() const;
+    QStringList getPaths() const;
+
+private:
+    struct Entry
+    {
+        QString path;
+        QString backupPath;
+        QByteArray hash;
+    };
+
+    static QByteArray hash(const QByteArray &data);
+
+    QTemporaryDir directory;
+    QList<Entry> entries;
+    int counter = 0;
+    mutable QMutex mutex;
+};
+
+#endif // REPLACEJOURNAL_H
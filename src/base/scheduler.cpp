@@ -0,0 +1,79 @@
+#include "base/scheduler.h"
+#include "base/application.h"
+#include "base/command.h"
+#include "base/settings.h"
+#include <QThread>
+
+namespace
+{
+    // Approximate amount of memory (in MB) which may be occupied by simultaneously running JVMs
+    const int HeapBudget = 4096;
+    // Used when the maximum heap size is not configured (JVM picks it by itself)
+    const int DefaultHeapSize = 1024;
+}
+
+void Scheduler::enqueue(Command *command, QObject *owner)
+{
+    if (owner == priorityOwner) {
+        // Behind the owner's own jobs which are already at the front:
+        int position = 0;
+        while (position < queue.size() && queue.at(position).owner == owner) {
+            ++position;
+        }
+        queue.insert(position, {command, owner});
+    } else {
+        queue.append({command, owner});
+    }
+
+    // Queued commands of a closed owner are destroyed along with it:
+    if (!owners.contains(owner)) {
+        owners.insert(owner);
+        connect(owner, &QObject::destroyed, this, [=]() {
+            owners.remove(owner);
+            if (priorityOwner == owner) {
+                priorityOwner = nullptr;
+            }
+            for (int i = queue.size() - 1; i >= 0; --i) {
+                if (queue.at(i).owner == owner) {
+                    queue.removeAt(i);
+                }
+            }
+        });
+    }
+
+    connect(command, &Command::finished, this, [=]() {
+        --running;
+        dequeue();
+    });
+
+    dequeue();
+}
+
+void Scheduler::prioritize(QObject *owner)
+{
+    // Move the owner's jobs to the front, keeping their order. Jobs enqueued later go to the front as well.
+    priorityOwner = owner;
+    int position = 0;
+    for (int i = 0; i < queue.size(); ++i) {
+        if (queue.at(i).owner == owner) {
+            queue.move(i, position++);
+        }
+    }
+}
+
+int Scheduler::getMaxRunningCount()
+{
+    const int maxHeapSize = app->settings->getJavaMaxHeapSize();
+    const int byMemory = HeapBudget / (maxHeapSize > 0 ? maxHeapSize : DefaultHeapSize);
+    const int byCores = QThread::idealThreadCount() / 2;
+    return qMax(1, qMin(byMemory, byCores));
+}
+
+void Scheduler::dequeue()
+{
+    while (!queue.isEmpty() && running < getMaxRunningCount()) {
+        Command *command = queue.takeFirst().command;
+        ++running;
+        command->run();
+    }
+}
@@ -0,0 +1,37 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <QList>
+#include <QObject>
+#include <QSet>
+
+class Command;
+
+class Scheduler : public QObject
+{
+    Q_OBJECT
+
+public:
+    Scheduler(QObject *parent = nullptr) : QObject(parent) {}
+
+    void enqueue(Command *command, QObject *owner);
+    void prioritize(QObject *owner);
+
+    static int getMaxRunningCount();
+
+private:
+    struct Job
+    {
+        Command *command;
+        QObject *owner;
+    };
+
+    void dequeue();
+
+    QList<Job> queue;
+    QSet<QObject *> owners;
+    QObject *priorityOwner = nullptr; // Its jobs jump the queue, e.g. the focused package
+    int running = 0;
+};
+
+#endif // SCHEDULER_H
@@ -0,0 +1,218 @@
+#include "base/searchindex.h"
+#include "base/filecatalog.h"
+#include <QDirIterator>
+#include <QTextCodec>
+#include <QtConcurrent/QtConcurrent>
+#include <algorithm>
+
+// Each file is represented with a Bloom filter of its trigrams. The filter has ~2-4 bits
+// per distinct trigram, which keeps the index small while multi-trigram queries still
+// reject almost all of the files which can't contain the query.
+
+namespace
+{
+    const int MinSignatureBits = 64;
+    const int MaxSignatureBits = 1 << 20;
+
+    inline quint32 hashTrigram(quint32 trigram)
+    {
+        return trigram * 2654435761u;
+    }
+}
+
+SearchIndex::~SearchIndex()
+{
+    cancel();
+}
+
+void SearchIndex::build(const QString &directory)
+{
+    cancel();
+    {
+        QMutexLocker locker(&mutex);
+        this->directory = directory;
+        entries.clear();
+        staleEntries.clear();
+        ready = false;
+    }
+
+    future = QtConcurrent::run([this, directory]() {
+        QDirIterator it(directory, QDir::Files, QDirIterator::Subdirectories);
+        while (it.hasNext()) {
+            if (cancelRequested) {
+                return;
+            }
+            const QString path = it.next();
+            const Entry entry = createEntry(it.fileInfo());
+            QMutexLocker locker(&mutex);
+            entries.insert(path, entry);
+        }
+        {
+            QMutexLocker locker(&mutex);
+            ready = true;
+        }
+        // Files updated during the build:
+        refresh();
+    });
+}
+
+void SearchIndex::update(const QStringList &paths)
+{
+    // Updated files stay candidates for every query until they are re-indexed in the background:
+    QMutexLocker locker(&mutex);
+    for (const QString &path : paths) {
+        staleEntries.insert(QDir::cleanPath(path), ++updateCounter);
+    }
+    if (ready && refreshFuture.isFinished()) {
+        refreshFuture = QtConcurrent::run([this]() {
+            refresh();
+        });
+    }
+}
+
+bool SearchIndex::getCandidates(const QString &directory, const QString &query, bool caseSensitive, QStringList &candidates)
+{
+    QMutexLocker locker(&mutex);
+    if (!ready || directory != this->directory) {
+        return false;
+    }
+
+    // Case-insensitive match of non-ASCII characters can't be predicted, so they are skipped:
+    const QVector<quint32> trigrams = getTrigrams(query.toUtf8(), !caseSensitive);
+
+    for (auto entry = entries.constBegin(); entry != entries.constEnd(); ++entry) {
+        if (staleEntries.contains(entry.key()) || (entry->text && entry->mayContain(trigrams))) {
+            candidates.append(entry.key());
+        }
+    }
+    for (auto entry = staleEntries.constBegin(); entry != staleEntries.constEnd(); ++entry) {
+        if (!entries.contains(entry.key())) {
+            candidates.append(entry.key());
+        }
+    }
+    candidates.sort();
+    return true;
+}
+
+bool SearchIndex::isReady() const
+{
+    QMutexLocker locker(&mutex);
+    return ready;
+}
+
+void SearchIndex::cancel()
+{
+    cancelRequested = 1;
+    future.waitForFinished();
+    QFuture<void> refreshing;
+    {
+        // Updates may be requested from other threads:
+        QMutexLocker locker(&mutex);
+        refreshing = refreshFuture;
+    }
+    refreshing.waitForFinished();
+    cancelRequested = 0;
+}
+
+void SearchIndex::refresh()
+{
+    forever {
+        QString path;
+        quint64 counter;
+        {
+            QMutexLocker locker(&mutex);
+            if (staleEntries.isEmpty() || cancelRequested) {
+                return;
+            }
+            path = staleEntries.constBegin().key();
+            counter = staleEntries.constBegin().value();
+        }
+        const QFileInfo fileInfo(path);
+        const bool exists = fileInfo.isFile();
+        const Entry entry = exists ? createEntry(fileInfo) : Entry();
+        QMutexLocker locker(&mutex);
+        if (exists) {
+            entries.insert(path, entry);
+        } else {
+            entries.remove(path);
+        }
+        // The file may have been updated again while it was being indexed:
+        if (staleEntries.value(path) == counter) {
+            staleEntries.remove(path);
+        }
+    }
+}
+
+bool SearchIndex::Entry::mayContain(const QVector<quint32> &trigrams) const
+{
+    if (signature.isEmpty()) {
+        return trigrams.isEmpty();
+    }
+    const quint32 mask = signature.size() * 32 - 1;
+    for (const quint32 trigram : trigrams) {
+        const quint32 bit = hashTrigram(trigram) & mask;
+        if (!(signature.at(bit / 32) & (1u << (bit % 32)))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+SearchIndex::Entry SearchIndex::createEntry(const QFileInfo &fileInfo) const
+{
+    Entry entry;
+    const FileCatalog::Entry catalogEntry = catalog->getEntry(fileInfo);
+    entry.text = catalogEntry.isText();
+    if (!entry.text) {
+        return entry;
+    }
+
+    QFile file(fileInfo.filePath());
+    if (!file.open(QFile::ReadOnly)) {
+        return entry;
+    }
+    // Queries are matched against the decoded text, so the trigrams are taken from its UTF-8 form:
+    QByteArray data = file.readAll();
+    if (!catalogEntry.encoding.isEmpty() && catalogEntry.encoding != "UTF-8") {
+        QTextCodec *codec = QTextCodec::codecForName(catalogEntry.encoding);
+        if (codec) {
+            data = codec->toUnicode(data).toUtf8();
+        }
+    }
+    QVector<quint32> trigrams = getTrigrams(data, false);
+    std::sort(trigrams.begin(), trigrams.end());
+    trigrams.erase(std::unique(trigrams.begin(), trigrams.end()), trigrams.end());
+
+    int bits = MinSignatureBits;
+    while (bits < trigrams.size() * 2 && bits < MaxSignatureBits) {
+        bits *= 2;
+    }
+    entry.signature.fill(0, bits / 32);
+    const quint32 mask = bits - 1;
+    for (const quint32 trigram : qAsConst(trigrams)) {
+        const quint32 bit = hashTrigram(trigram) & mask;
+        entry.signature[bit / 32] |= 1u << (bit % 32);
+    }
+    return entry;
+}
+
+QVector<quint32> SearchIndex::getTrigrams(const QByteArray &data, bool asciiOnly)
+{
+    // Trigrams are ASCII-lowercased, so that the same index serves case-insensitive queries
+    QVector<quint32> trigrams;
+    if (data.size() < 3) {
+        return trigrams;
+    }
+    trigrams.reserve(data.size() - 2);
+    const auto *bytes = reinterpret_cast<const uchar *>(data.constData());
+    auto fold = [](uchar c) -> quint32 {
+        return (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+    };
+    for (int i = 0; i + 2 < data.size(); ++i) {
+        if (asciiOnly && ((bytes[i] | bytes[i + 1] | bytes[i + 2]) & 0x80)) {
+            continue;
+        }
+        trigrams.append(fold(bytes[i]) | fold(bytes[i + 1]) << 8 | fold(bytes[i + 2]) << 16);
+    }
+    return trigrams;
+}
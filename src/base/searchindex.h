@@ -0,0 +1,52 @@
+#ifndef SEARCHINDEX_H
+#define SEARCHINDEX_H
+
+#include <QAtomicInt>
+#include <QFuture>
+#include <QHash>
+#include <QMutex>
+#include <QSharedPointer>
+#include <QVector>
+
+class FileCatalog;
+class QFileInfo;
+
+class SearchIndex
+{
+public:
+    SearchIndex(QSharedPointer<FileCatalog> catalog) : catalog(catalog) {}
+    ~SearchIndex();
+
+    void build(const QString &directory);
+    void update(const QStringList &paths);
+    bool getCandidates(const QString &directory, const QString &query, bool caseSensitive, QStringList &candidates);
+    bool isReady() const;
+
+private:
+    struct Entry
+    {
+        bool text = false;
+        QVector<quint32> signature;
+
+        bool mayContain(const QVector<quint32> &trigrams) const;
+    };
+
+    void cancel();
+    void refresh();
+
+    Entry createEntry(const QFileInfo &fileInfo) const;
+    static QVector<quint32> getTrigrams(const QByteArray &data, bool asciiOnly);
+
+    QSharedPointer<FileCatalog> catalog;
+    QString directory;
+    QHash<QString, Entry> entries;
+    QHash<QString, quint64> staleEntries;
+    quint64 updateCounter = 0;
+    mutable QMutex mutex;
+    QFuture<void> future;
+    QFuture<void> refreshFuture;
+    QAtomicInt cancelRequested;
+    bool ready = false;
+};
+
+#endif // SEARCHINDEX_H
@@ -0,0 +1,301 @@
+#include "base/searchmatcher.h"
+#include <QFile>
+#include <QStack>
+#include <QTextCodec>
+#include <algorithm>
+#include <cstring>
+
+// Files are searched as raw UTF-8 bytes: the needle (the query itself, or a literal which
+// every match of the regular expression must contain) is looked up with memchr/memcmp,
+// and only the lines containing it are decoded and matched exactly.
+
+namespace
+{
+    inline bool isAscii(const QByteArray &data)
+    {
+        return std::all_of(data.cbegin(), data.cend(), [](char c) {
+            return !(static_cast<uchar>(c) & 0x80);
+        });
+    }
+
+    void foldCase(const char *source, char *target, qint64 size)
+    {
+        // Simple loop which compilers vectorize:
+        for (qint64 i = 0; i < size; ++i) {
+            const uchar c = static_cast<uchar>(source[i]);
+            target[i] = static_cast<char>(c + (static_cast<uchar>(c - 'A') < 26 ? 'a' - 'A' : 0));
+        }
+    }
+}
+
+SearchMatcher::SearchMatcher(const QString &query, bool caseSensitive, bool regex)
+    : query(query)
+    , caseSensitive(caseSensitive)
+    , byRegex(regex)
+{
+    if (byRegex) {
+        this->regex.setPattern(query);
+        if (!caseSensitive) {
+            this->regex.setPatternOptions(QRegularExpression::CaseInsensitiveOption);
+        }
+        this->regex.optimize();
+        literal = extractLiteral(query);
+    } else {
+        literal = query;
+    }
+
+    // Without a usable needle, every line is decoded and matched:
+    needle = literal.toUtf8();
+    if (!caseSensitive) {
+        if (isAscii(needle)) {
+            foldCase(needle.constData(), needle.data(), needle.size());
+        } else {
+            needle.clear();
+        }
+    }
+}
+
+QString SearchMatcher::getLiteral() const
+{
+    return literal;
+}
+
+QList<SearchResult> SearchMatcher::searchFile(const QString &filePath, const QByteArray &encoding) const
+{
+    QList<SearchResult> results;
+    if (byRegex && !regex.isValid()) {
+        return results;
+    }
+
+    QFile file(filePath);
+    if (!file.open(QFile::ReadOnly)) {
+        return results;
+    }
+
+    if (encoding != "UTF-8" && encoding != "ISO-8859-1") {
+        // Multi-byte encodings (e.g., UTF-16) are decoded as a whole
+        QTextCodec *codec = QTextCodec::codecForName(encoding);
+        if (!codec) {
+            return results;
+        }
+        QStringList lines = codec->toUnicode(file.readAll()).split('\n');
+        if (lines.last().isEmpty()) {
+            lines.removeLast();
+        }
+        for (int i = 0; i < lines.size(); ++i) {
+            QString line = lines.at(i);
+            if (line.endsWith('\r')) {
+                line.chop(1);
+            }
+            matchLine(filePath, line, i + 1, -1, false, results);
+        }
+        return results;
+    }
+    const bool latin1 = encoding == "ISO-8859-1";
+    const qint64 size = file.size();
+    if (!size) {
+        return results;
+    }
+    QByteArray buffer;
+    const char *data = reinterpret_cast<const char *>(file.map(0, size));
+    if (!data) {
+        buffer = file.readAll();
+        data = buffer.constData();
+    }
+
+    // Skip the byte order mark:
+    const qint64 begin = (size >= 3 && !memcmp(data, "\xEF\xBB\xBF", 3)) ? 3 : 0;
+
+    auto decodeLine = [data, latin1](qint64 lineStart, qint64 lineEnd) {
+        if (lineEnd > lineStart && data[lineEnd - 1] == '\r') {
+            --lineEnd;
+        }
+        const int length = static_cast<int>(lineEnd - lineStart);
+        return latin1 ? QString::fromLatin1(data + lineStart, length) : QString::fromUtf8(data + lineStart, length);
+    };
+    auto findLineEnd = [data, size](qint64 position) -> qint64 {
+        const void *newline = memchr(data + position, '\n', static_cast<size_t>(size - position));
+        return newline ? static_cast<const char *>(newline) - data : size;
+    };
+
+    // Non-ASCII needle bytes are UTF-8, so they can't be looked up in Latin-1 files:
+    if (needle.isEmpty() || (latin1 && !isAscii(needle))) {
+        int lineNumber = 0;
+        for (qint64 lineStart = begin; lineStart < size;) {
+            const qint64 lineEnd = findLineEnd(lineStart);
+            matchLine(filePath, decodeLine(lineStart, lineEnd), ++lineNumber, lineStart, latin1, results);
+            lineStart = lineEnd + 1;
+        }
+        return results;
+    }
+
+    QByteArray folded;
+    const char *haystack = data;
+    if (!caseSensitive) {
+        folded.resize(static_cast<int>(size));
+        foldCase(data, folded.data(), size);
+        haystack = folded.constData();
+    }
+
+    int lineNumber = 1;
+    qint64 countedUntil = begin;
+    qint64 position = begin;
+    while ((position = findBytes(haystack, size, position, needle)) != -1) {
+        qint64 lineStart = position;
+        while (lineStart > begin && data[lineStart - 1] != '\n') {
+            --lineStart;
+        }
+        const qint64 lineEnd = findLineEnd(position);
+        lineNumber += static_cast<int>(std::count(data + countedUntil, data + lineStart, '\n'));
+        countedUntil = lineStart;
+        matchLine(filePath, decodeLine(lineStart, lineEnd), lineNumber, lineStart, latin1, results);
+        position = lineEnd + 1;
+    }
+    return results;
+}
+
+void SearchMatcher::matchLine(const QString &filePath, const QString &line, int lineNumber,
+                              qint64 lineOffset, bool latin1, QList<SearchResult> &results) const
+{
+    int matchOffset = 0;
+    forever {
+        int matchStart = -1;
+        int matchLength = 0;
+
+        if (!byRegex) {
+            matchStart = line.indexOf(query, matchOffset, caseSensitive ? Qt::CaseSensitive : Qt::CaseInsensitive);
+            matchLength = query.length();
+        } else {
+            const auto match = regex.match(line, matchOffset);
+            matchStart = match.capturedStart(1);
+            matchLength = match.capturedLength(1);
+        }
+
+        if (matchStart == -1) {
+            break;
+        }
+
+        SearchResult result(filePath, line, lineNumber, matchStart, matchLength);
+        if (lineOffset != -1) {
+            // Byte range of the match in the file, used to replace it without re-encoding the file
+            result.byteStart = lineOffset + (latin1 ? matchStart : line.leftRef(matchStart).toUtf8().size());
+            result.byteLength = latin1 ? matchLength : line.midRef(matchStart, matchLength).toUtf8().size();
+        }
+        results.append(result);
+        matchOffset = matchStart + matchLength;
+    }
+}
+
+QString SearchMatcher::extractLiteral(const QString &pattern)
+{
+    // Find the longest run of plain characters which every match must contain. Anything
+    // which is hard to reason about (alternation, inline options, quoting) disables it.
+    if (pattern.contains('|') || pattern.contains("(?") || pattern.contains("(*") || pattern.contains("\\Q")) {
+        return QString();
+    }
+
+    QString best;
+    QString current;
+    QStack<QString> groups;
+    auto flush = [&]() {
+        if (current.length() > best.length()) {
+            best = current;
+        }
+        current.clear();
+    };
+    auto isQuantifier = [&](int i) {
+        return i < pattern.length() && (pattern.at(i) == '?' || pattern.at(i) == '*' || pattern.at(i) == '{');
+    };
+
+    for (int i = 0; i < pattern.length(); ++i) {
+        const QChar c = pattern.at(i);
+        QChar character;
+        if (c == '\\') {
+            if (++i >= pattern.length()) {
+                return QString();
+            }
+            const QChar escaped = pattern.at(i);
+            if (escaped.isLetterOrNumber()) {
+                // Character classes and assertions; other escapes (\x, \p, back-references) are not parsed
+                if (!QString("dDwWsSbBhHvVRAzZGnrtfe").contains(escaped)) {
+                    return QString();
+                }
+                flush();
+                continue;
+            }
+            character = escaped;
+        } else if (c == '(') {
+            flush();
+            groups.push(best);
+            continue;
+        } else if (c == ')') {
+            flush();
+            if (groups.isEmpty()) {
+                return QString();
+            }
+            const QString outerBest = groups.pop();
+            if (isQuantifier(i + 1)) {
+                // Optional group: its contents are not required
+                best = outerBest;
+            }
+            continue;
+        } else if (c == '[') {
+            flush();
+            int j = i + 1;
+            if (j < pattern.length() && pattern.at(j) == '^') {
+                ++j;
+            }
+            if (j < pattern.length() && pattern.at(j) == ']') {
+                ++j;
+            }
+            while (j < pattern.length() && pattern.at(j) != ']') {
+                j += pattern.at(j) == '\\' ? 2 : 1;
+            }
+            if (j >= pattern.length()) {
+                return QString();
+            }
+            i = j;
+            continue;
+        } else if (c == '?' || c == '*' || c == '{') {
+            // The previous character is optional
+            current.chop(1);
+            flush();
+            if (c == '{') {
+                while (i < pattern.length() && pattern.at(i) != '}') {
+                    ++i;
+                }
+            }
+            continue;
+        } else if (c == '+' || c == '.' || c == '^' || c == '$') {
+            flush();
+            continue;
+        } else {
+            character = c;
+        }
+
+        if (isQuantifier(i + 1)) {
+            flush();
+            continue;
+        }
+        current.append(character);
+    }
+    flush();
+    return groups.isEmpty() ? best : QString();
+}
+
+qint64 SearchMatcher::findBytes(const char *data, qint64 size, qint64 from, const QByteArray &needle)
+{
+    const qint64 length = needle.size();
+    const char first = needle.at(0);
+    const char *end = data + size - length + 1;
+    for (const char *p = data + from; p < end; ++p) {
+        p = static_cast<const char *>(memchr(p, first, static_cast<size_t>(end - p)));
+        if (!p) {
+            return -1;
+        }
+        if (!memcmp(p + 1, needle.constData() + 1, static_cast<size_t>(length - 1))) {
+            return p - data;
+        }
+    }
+    return -1;
+}
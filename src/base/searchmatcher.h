@@ -0,0 +1,30 @@
+#ifndef SEARCHMATCHER_H
+#define SEARCHMATCHER_H
+
+#include "base/searchresult.h"
+#include <QRegularExpression>
+
+class SearchMatcher
+{
+public:
+    SearchMatcher(const QString &query, bool caseSensitive, bool regex);
+
+    QString getLiteral() const;
+    QList<SearchResult> searchFile(const QString &filePath, const QByteArray &encoding = "UTF-8") const;
+
+private:
+    void matchLine(const QString &filePath, const QString &line, int lineNumber,
+                   qint64 lineOffset, bool latin1, QList<SearchResult> &results) const;
+
+    static QString extractLiteral(const QString &pattern);
+    static qint64 findBytes(const char *data, qint64 size, qint64 from, const QByteArray &needle);
+
+    QString query;
+    QString literal;
+    QByteArray needle;
+    QRegularExpression regex;
+    bool caseSensitive;
+    bool byRegex;
+};
+
+#endif // SEARCHMATCHER_H
@@ -1,197 +1,360 @@
 #include "base/searchmodel.h"
+#include "base/filecatalog.h"
+#include "base/replacejournal.h"
+#include "base/searchindex.h"
+#include "base/searchmatcher.h"
 #include "base/searchresult.h"
 #include <QtConcurrent/QtConcurrent>
+#include <functional>
 
 // SearchModelWorker
 
+namespace
+{
+    // Number of files claimed by a search thread at once
+    const int SearchChunkSize = 16;
+    // Results are delivered to the model in batches of this size or at this interval (ms)
+    const int SearchBatchSize = 500;
+    const int SearchBatchInterval = 100;
+}
+
 void SearchModelWorker::search(const QString &query, const QString &directory)
 {
     if (query.isEmpty() || directory.isEmpty()) {
         return;
     }
 
-    QtConcurrent::run([this, query, directory]() {
-        searchCancelRequested = false;
-        emit searchStarted();
+    QSharedPointer<SearchIndex> index(searchIndex);
+    QSharedPointer<FileCatalog> catalog(getFileCatalog());
+    const SearchMatcher matcher(query, searchCaseSensitive, searchByRegex);
+    const int generation = searchGeneration.fetchAndAddOrdered(1) + 1;
+
+    QtConcurrent::run([this, matcher, directory, index, catalog, generation]() {
+        // Stopped or superseded by another search:
+        auto isCancelled = [this, generation]() {
+            return generation != searchGeneration.loadAcquire() || generation == cancelledSearch.loadAcquire();
+        };
+        emit searchStarted(generation);
+
+        // Narrow down the files using the index (for regular expressions, by the literal all matches contain):
+        QStringList filePaths;
+        const bool indexed = index && index->getCandidates(directory, matcher.getLiteral(), searchCaseSensitive, filePaths);
+        if (!indexed) {
+            QDirIterator files(directory, QDir::Files, QDirIterator::Subdirectories);
+            while (files.hasNext()) {
+                filePaths.append(files.next());
+            }
+        }
+
+        // Files are claimed in small chunks by each thread, while the results are delivered
+        // strictly in the file order, so that the result list is the same for every run.
+        const int fileCount = filePaths.size();
+        QAtomicInt nextFile(0);
+        QMutex deliveryMutex;
+        QVector<QList<SearchResult>> fileResults(fileCount);
+        QVector<bool> fileDone(fileCount, false);
+        int deliveredFiles = 0;
         int resultCount = 0;
         int resultFileCount = 0;
-        QMimeDatabase database;
-        QDirIterator files(directory, QDir::Files, QDirIterator::Subdirectories);
-        while (files.hasNext()) {
-            if (searchCancelRequested) {
-                break;
+        QList<SearchResult> batch;
+        QElapsedTimer batchTimer;
+        batchTimer.start();
+
+        auto deliver = [&](bool force) {
+            while (deliveredFiles < fileCount && fileDone.at(deliveredFiles)) {
+                QList<SearchResult> &results = fileResults[deliveredFiles];
+                if (!results.isEmpty()) {
+                    resultCount += results.size();
+                    ++resultFileCount;
+                    batch.append(results);
+                    results.clear();
+                }
+                ++deliveredFiles;
             }
-
-            const QString filePath(files.next());
-            emit searchProgressed(filePath);
-
-            if (!database.mimeTypeForFile(filePath).inherits("text/plain")) {
-                continue;
+            if (force || batch.size() >= SearchBatchSize || batchTimer.elapsed() >= SearchBatchInterval) {
+                if (!batch.isEmpty()) {
+                    emit matchesFound(generation, batch);
+                    batch.clear();
+                }
+                if (deliveredFiles < fileCount) {
+                    emit searchProgressed(generation, filePaths.at(deliveredFiles));
+                }
+                batchTimer.restart();
             }
-
-            QFile file(filePath);
-            if (file.open(QFile::ReadOnly)) {
-                QTextStream stream(&file);
-                stream.setCodec("UTF-8");
-                int currentLineNumber = 0;
-                bool fileHasResult = false;
-
-                while (!stream.atEnd()) {
-                    ++currentLineNumber;
-                    const QString line = stream.readLine();
-                    int matchOffset = 0;
-
-                    forever {
-                        QString match;
-                        int matchStart = -1;
-                        int matchLength = 0;
-
-                        if (!searchByRegex) {
-                            const auto caseSensitivity = searchCaseSensitive ? Qt::CaseSensitive : Qt::CaseInsensitive;
-                            matchStart = line.indexOf(query, matchOffset, caseSensitivity);
-                            matchLength = query.length();
-                        } else {
-                            auto regex = QRegularExpression(query);
-                            if (!searchCaseSensitive) {
-                                regex.setPatternOptions(QRegularExpression::CaseInsensitiveOption);
-                            }
-                            const auto match = regex.match(line, matchOffset);
-                            matchStart = match.capturedStart(1);
-                            matchLength = match.capturedLength(1);
-                        }
-
-                        if (matchStart == -1) {
-                            break;
-                        }
-
-                        emit matchFound(filePath, line, currentLineNumber, matchStart, matchLength);
-                        ++resultCount;
-                        if (!fileHasResult) {
-                            ++resultFileCount;
-                            fileHasResult = true;
-                        }
-                        matchOffset = matchStart + matchLength;
+        };
+
+        QVector<int> threads(qMax(1, QThread::idealThreadCount()));
+        QtConcurrent::blockingMap(threads, [&](int &) {
+            const SearchMatcher threadMatcher(matcher);
+            forever {
+                const int first = nextFile.fetchAndAddRelaxed(SearchChunkSize);
+                if (first >= fileCount || isCancelled()) {
+                    break;
+                }
+                const int last = qMin(first + SearchChunkSize, fileCount);
+                QVector<QList<SearchResult>> chunk(last - first);
+                for (int i = first; i < last && !isCancelled(); ++i) {
+                    const QString &filePath = filePaths.at(i);
+                    const FileCatalog::Entry file = catalog->getEntry(filePath);
+                    if (file.isText()) {
+                        chunk[i - first] = threadMatcher.searchFile(filePath, file.encoding);
                     }
                 }
+                QMutexLocker locker(&deliveryMutex);
+                for (int i = first; i < last; ++i) {
+                    fileResults[i] = chunk.at(i - first);
+                    fileDone[i] = true;
+                }
+                deliver(false);
             }
-        }
+        });
 
-        emit searchFinished(resultCount, resultFileCount);
+        deliver(true);
+        emit searchFinished(generation, resultCount, resultFileCount);
     });
 }
 
 void SearchModelWorker::cancelSearch()
 {
-    searchCancelRequested = true;
+    // The stopped search still delivers what it has found so far:
+    cancelledSearch.storeRelease(searchGeneration.loadAcquire());
+}
+
+void SearchModelWorker::discardSearch()
+{
+    searchGeneration.fetchAndAddOrdered(1);
+}
+
+bool SearchModelWorker::isCurrentSearch(int generation) const
+{
+    return generation == searchGeneration.loadAcquire();
 }
 
 void SearchModelWorker::replace(const QList<SearchResultFile *> &resultFiles, const QString &with)
 {
-    QtConcurrent::run([this, resultFiles, with]() {
-        int totalFilesReplaced = 0;
-        int totalResultsReplaced = 0;
-        bool success = true;
+    QSharedPointer<FileCatalog> catalog(getFileCatalog());
+
+    // Only the last replacement can be undone:
+    QSharedPointer<ReplaceJournal> journal = QSharedPointer<ReplaceJournal>::create();
+    replaceJournal = journal;
+
+    QList<SearchResultFile *> checkedFiles;
+    for (auto resultFile : resultFiles) {
+        if (resultFile->getCheckState() != Qt::Unchecked) {
+            checkedFiles.append(resultFile);
+        }
+    }
+
+    QtConcurrent::run([this, checkedFiles, with, catalog, journal]() {
+        QAtomicInt totalFilesReplaced(0);
+        QAtomicInt totalResultsReplaced(0);
+        QAtomicInt failed(0);
+        QMutex progressMutex;
+        QList<SearchResult *> pendingReplaced;
+        QElapsedTimer progressTimer;
+        progressTimer.start();
 
         replaceCancelRequested = false;
         emit replaceStarted();
 
-        for (const auto &resultFile : resultFiles) {
+        QList<SearchResultFile *> files(checkedFiles);
+        QtConcurrent::blockingMap(files, [&](SearchResultFile *resultFile) {
             if (replaceCancelRequested) {
-                break;
+                return;
             }
 
-            if (resultFile->getCheckState() == Qt::Unchecked) {
-                continue;
+            QList<SearchResult *> replaced;
+            const QByteArray encoding = catalog->getEntry(resultFile->path).encoding;
+            if (!replaceInFile(resultFile, with, encoding, journal.data(), replaced)) {
+                failed = 1;
             }
-
-            const auto filePath = resultFile->path;
-            emit replaceProgressed(filePath);
-
-            QFile inputFile(filePath);
-            if (!inputFile.open(QFile::ReadOnly)) {
-                qWarning() << "Could not open the original match file.";
-                success = false;
-                continue;
+            if (!replaced.isEmpty()) {
+                totalFilesReplaced.fetchAndAddRelaxed(1);
+                totalResultsReplaced.fetchAndAddRelaxed(replaced.size());
             }
-            QTextStream inputStream(&inputFile);
-            inputStream.setCodec("UTF-8");
 
-            QTemporaryFile outputFile(filePath);
-            if (!outputFile.open()) {
-                qWarning() << "Could not open the temporary match file.";
-                success = false;
-                continue;
+            // Replaced matches are removed from the model in batches:
+            QMutexLocker locker(&progressMutex);
+            pendingReplaced.append(replaced);
+            if (progressTimer.elapsed() >= SearchBatchInterval) {
+                emit replaceProgressed(resultFile->path);
+                if (!pendingReplaced.isEmpty()) {
+                    emit matchesReplaced(pendingReplaced);
+                    pendingReplaced.clear();
+                }
+                progressTimer.restart();
             }
-            QTextStream outputStream(&outputFile);
-
-            int currentLineNumber = 0;
-            QList<SearchResult *> unsavedResults;
-
-            while (!inputStream.atEnd()) {
-                auto results = resultFile->results;
-                QString line = inputStream.readLine();
-                ++currentLineNumber;
-
-                for (auto itResult = results.begin(); itResult != results.end(); ++itResult) {
-                    const auto result = *itResult;
-
-                    if (result->lineNumber != currentLineNumber || result->checkState != Qt::Checked) {
-                        continue;
-                    }
+        });
 
-                    if (!result->matches(line)) {
-                        // File has been modified, and the search result doesn't match anymore
-                        success = false;
-                        continue;
-                    }
+        if (!pendingReplaced.isEmpty()) {
+            emit matchesReplaced(pendingReplaced);
+        }
 
-                    const int matchStartOffset = result->match().length() - with.length();
+        const QStringList paths = journal->getPaths();
+        if (!paths.isEmpty()) {
+            emit filesChanged(paths);
+        }
+        emit replaceFinished(totalResultsReplaced, totalFilesReplaced, !failed);
+    });
+}
 
-                    line.replace(result->matchStart, result->matchLength, with);
+bool SearchModelWorker::replaceInFile(SearchResultFile *resultFile, const QString &with, const QByteArray &encoding,
+                                      ReplaceJournal *journal, QList<SearchResult *> &replaced)
+{
+    const QString filePath = resultFile->path;
+    const QList<SearchResult *> results = resultFile->results;
 
-                    // Offset the match ranges for results in the same line
-                    for (auto itNextResult = itResult + 1; itNextResult != results.end(); ++itNextResult) {
-                        auto nextResult = *itNextResult;
-                        if (nextResult->lineNumber != currentLineNumber) {
-                            break;
-                        }
-                        nextResult->lineContent = line;
-                        nextResult->matchStart -= matchStartOffset;
-                        emit matchUpdated(resultFile, nextResult);
-                    }
+    QFile file(filePath);
+    if (!file.open(QFile::ReadOnly)) {
+        qWarning() << "Could not open the original match file.";
+        return false;
+    }
+    const QByteArray original = file.readAll();
+    file.close();
 
-                    unsavedResults << result;
-                }
-                outputStream.setCodec(inputStream.codec());
-                outputStream << line << Qt::endl;
+    QTextCodec *codec = QTextCodec::codecForName(encoding.isEmpty() ? QByteArray("UTF-8") : encoding);
+    if (!codec) {
+        return false;
+    }
+    const bool byBytes = (codec->mibEnum() == 106 || codec->mibEnum() == 4) // UTF-8 or ISO-8859-1
+        && std::all_of(results.cbegin(), results.cend(), [](const SearchResult *result) {
+               return result->byteStart != -1 || result->checkState != Qt::Checked;
+           });
+
+    bool success = true;
+    QByteArray modified;
+
+    if (byBytes) {
+        // Splice the replacement at the byte ranges recorded during the search:
+        const QByteArray replacement = codec->fromUnicode(with);
+        qint64 position = 0;
+        for (auto result : results) {
+            if (result->checkState != Qt::Checked) {
+                continue;
             }
-
-            if (!inputFile.remove()) {
-                qWarning() << "Could not remove the original match file.";
+            if (result->byteStart < position
+                    || original.mid(result->byteStart, result->byteLength) != codec->fromUnicode(result->match())) {
+                // File has been modified, and the search result doesn't match anymore
                 success = false;
                 continue;
             }
+            modified.append(original.constData() + position, static_cast<int>(result->byteStart - position));
+            modified.append(replacement);
+            position = result->byteStart + result->byteLength;
+            replaced.append(result);
+        }
+        modified.append(original.constData() + position, static_cast<int>(original.size() - position));
+    } else {
+        // Encodings like UTF-16 are replaced in the decoded text:
+        QByteArray bom;
+        for (const QByteArray &mark : {QByteArray("\xEF\xBB\xBF"), QByteArray("\xFF\xFE"), QByteArray("\xFE\xFF")}) {
+            if (original.startsWith(mark)) {
+                bom = mark;
+                break;
+            }
+        }
+        QTextCodec::ConverterState decoderState(QTextCodec::IgnoreHeader);
+        const QString text = codec->toUnicode(original.constData() + bom.size(), original.size() - bom.size(), &decoderState);
+        QVector<int> lineStarts{0};
+        for (int i = 0; i < text.size(); ++i) {
+            if (text.at(i) == '\n') {
+                lineStarts.append(i + 1);
+            }
+        }
 
-            if (outputFile.rename(filePath)) {
-                outputFile.setAutoRemove(false);
-            } else {
-                qWarning() << "Could not move the temporary match file.";
+        QString modifiedText;
+        int position = 0;
+        for (auto result : results) {
+            if (result->checkState != Qt::Checked) {
+                continue;
+            }
+            const int start = result->lineNumber <= lineStarts.size() ? lineStarts.at(result->lineNumber - 1) + result->matchStart : -1;
+            if (start < position || text.mid(start, result->matchLength) != result->match()) {
                 success = false;
                 continue;
             }
+            modifiedText.append(text.midRef(position, start - position));
+            modifiedText.append(with);
+            position = start + result->matchLength;
+            replaced.append(result);
+        }
+        modifiedText.append(text.midRef(position));
+        QTextCodec::ConverterState encoderState(QTextCodec::IgnoreHeader);
+        modified = bom + codec->fromUnicode(modifiedText.constData(), modifiedText.size(), &encoderState);
+    }
 
-            totalFilesReplaced += 1;
-            totalResultsReplaced += unsavedResults.count();
+    if (replaced.isEmpty()) {
+        return success;
+    }
 
-            for (const auto &result : qAsConst(unsavedResults)) {
-                emit matchReplaced(resultFile, result);
-            }
+    // Keep the original for undo, then atomically swap the file:
+    if (!journal->record(filePath, original, modified)) {
+        replaced.clear();
+        return false;
+    }
+    QSaveFile output(filePath);
+    if (!output.open(QSaveFile::WriteOnly) || output.write(modified) != modified.size() || !output.commit()) {
+        qWarning() << "Could not write the match file.";
+        journal->discard(filePath);
+        replaced.clear();
+        return false;
+    }
+
+    // Offset the positions of the remaining results
+    const QSet<SearchResult *> replacedSet(replaced.cbegin(), replaced.cend());
+    const int replacementBytes = byBytes ? codec->fromUnicode(with).size() : 0;
+    qint64 byteDelta = 0;
+    int currentLineNumber = -1;
+    QString line;
+    int charDelta = 0;
+    for (auto result : results) {
+        if (result->lineNumber != currentLineNumber) {
+            currentLineNumber = result->lineNumber;
+            line = result->lineContent;
+            charDelta = 0;
+        }
+        if (replacedSet.contains(result)) {
+            line.replace(result->matchStart + charDelta, result->matchLength, with);
+            charDelta += with.length() - result->matchLength;
+            byteDelta += replacementBytes - result->byteLength;
+            continue;
+        }
+        if (result->byteStart != -1) {
+            result->byteStart += byteDelta;
+        }
+        if (line != result->lineContent) {
+            result->lineContent = line;
+            result->matchStart += charDelta;
+            emit matchUpdated(resultFile, result);
         }
+    }
+
+    return success;
+}
 
-        emit replaceFinished(totalResultsReplaced, totalFilesReplaced, success);
+void SearchModelWorker::undoReplace()
+{
+    QSharedPointer<ReplaceJournal> journal = replaceJournal;
+    replaceJournal.reset();
+    if (!journal) {
+        return;
+    }
+    QtConcurrent::run([this, journal]() {
+        const QStringList paths = journal->getPaths();
+        int restoredCount = 0;
+        const bool success = journal->undo(restoredCount);
+        if (restoredCount) {
+            emit filesChanged(paths);
+        }
+        emit undoFinished(restoredCount, success);
     });
 }
 
+bool SearchModelWorker::canUndoReplace() const
+{
+    return replaceJournal && !replaceJournal->isEmpty();
+}
+
 void SearchModelWorker::cancelReplace()
 {
     replaceCancelRequested = true;
@@ -207,21 +370,70 @@ void SearchModelWorker::setSearchByRegex(bool enabled)
     searchByRegex = enabled;
 }
 
+void SearchModelWorker::setSearchIndex(QSharedPointer<SearchIndex> index)
+{
+    searchIndex = index;
+}
+
+void SearchModelWorker::setFileCatalog(QSharedPointer<FileCatalog> catalog)
+{
+    fileCatalog = catalog;
+}
+
+QSharedPointer<FileCatalog> SearchModelWorker::getFileCatalog()
+{
+    if (!fileCatalog) {
+        fileCatalog = QSharedPointer<FileCatalog>::create();
+    }
+    return fileCatalog;
+}
+
 // SearchModel
 
 SearchModel::SearchModel(QObject *parent) : QAbstractItemModel(parent)
 {
-    connect(&worker, &SearchModelWorker::searchStarted, this, &SearchModel::searchStarted);
-    connect(&worker, &SearchModelWorker::searchProgressed, this, &SearchModel::searchProgressed);
-    connect(&worker, &SearchModelWorker::searchFinished, this, &SearchModel::searchFinished);
+    // Deliveries of a discarded search may still be queued:
+    connect(&worker, &SearchModelWorker::searchStarted, this, [this](int generation) {
+        if (worker.isCurrentSearch(generation)) {
+            emit searchStarted();
+        }
+    });
+    connect(&worker, &SearchModelWorker::searchProgressed, this, [this](int generation, const QString &currentFile) {
+        if (worker.isCurrentSearch(generation)) {
+            emit searchProgressed(currentFile);
+        }
+    });
+    connect(&worker, &SearchModelWorker::searchFinished, this, [this](int generation, int resultCount, int fileCount) {
+        if (worker.isCurrentSearch(generation)) {
+            emit searchFinished(resultCount, fileCount);
+        }
+    });
 
     connect(&worker, &SearchModelWorker::replaceStarted, this, &SearchModel::replaceStarted);
     connect(&worker, &SearchModelWorker::replaceProgressed, this, &SearchModel::replaceProgressed);
     connect(&worker, &SearchModelWorker::replaceFinished, this, &SearchModel::replaceFinished);
-
-    connect(&worker, &SearchModelWorker::matchFound, this, &SearchModel::add);
-    connect(&worker, &SearchModelWorker::matchReplaced, this, &SearchModel::remove);
+    connect(&worker, &SearchModelWorker::undoFinished, this, &SearchModel::undoFinished);
+    connect(&worker, &SearchModelWorker::filesChanged, this, &SearchModel::filesChanged);
+
+    qRegisterMetaType<QList<SearchResult>>();
+    qRegisterMetaType<QList<SearchResult *>>();
+    connect(&worker, &SearchModelWorker::matchesFound, this, [this](int generation, const QList<SearchResult> &results) {
+        if (worker.isCurrentSearch(generation)) {
+            add(results);
+        }
+    });
+    connect(&worker, &SearchModelWorker::matchesReplaced, this, &SearchModel::remove);
     connect(&worker, &SearchModelWorker::matchUpdated, this, &SearchModel::update);
+
+    // Result counters in the root item are refreshed at most ~30 times per second:
+    rootUpdateTimer.setSingleShot(true);
+    rootUpdateTimer.setInterval(33);
+    connect(&rootUpdateTimer, &QTimer::timeout, this, [this]() {
+        if (isRootVisible) {
+            const auto rootIndex = index(0, 0);
+            emit dataChanged(rootIndex, rootIndex, {Qt::DisplayRole});
+        }
+    });
 }
 
 SearchModel::~SearchModel()
@@ -235,20 +447,10 @@ bool SearchModel::isResultIndex(const QModelIndex &index)
     return indexType != RootIndex && indexType != ResultFileIndex;
 }
 
-void SearchModel::add(const QString &filePath, const QString &lineContent, int lineNumber, int matchStart, int matchLength)
+void SearchModel::add(const QList<SearchResult> &results)
 {
-    SearchResult *result = new SearchResult(filePath, lineContent, lineNumber, matchStart, matchLength);
-    SearchResultFile *resultFile = nullptr;
-
-    const auto rootIndex = index(0, 0);
-    int resultFileRow;
-
-    for (resultFileRow = resultFiles.count() - 1; resultFileRow >= 0; --resultFileRow) {
-        auto existingResultFile = resultFiles.at(resultFileRow);
-        if (existingResultFile->path == result->filePath) {
-            resultFile = existingResultFile;
-            break;
-        }
+    if (results.isEmpty()) {
+        return;
     }
 
     if (resultFiles.isEmpty()) {
@@ -257,48 +459,115 @@ void SearchModel::add(const QString &filePath, const QString &lineContent, int l
         endInsertRows();
     }
 
-    if (!resultFile) {
-        resultFile = new SearchResultFile(result->filePath);
-        const int row = resultFiles.count();
-        beginInsertRows(rootIndex, row, row);
-        resultFiles.append(resultFile);
-        ++totalResultFiles;
-    } else {
-        const auto resultFileIndex = index(resultFileRow, 0, rootIndex);
-        const int row = resultFile->results.count();
-        beginInsertRows(resultFileIndex, row, row);
-    }
+    const auto rootIndex = index(0, 0);
 
-    resultFile->results.append(result);
-    endInsertRows();
+    // Insert each run of results belonging to the same file at once:
+    for (int first = 0; first < results.count();) {
+        const QString &filePath = results.at(first).filePath;
+        int last = first + 1;
+        while (last < results.count() && results.at(last).filePath == filePath) {
+            ++last;
+        }
+
+        const int resultFileRow = resultFileRows.value(filePath, -1);
+        if (resultFileRow == -1) {
+            auto resultFile = new SearchResultFile(filePath);
+            resultFile->results.reserve(last - first);
+            for (int i = first; i < last; ++i) {
+                resultFile->results.append(new SearchResult(results.at(i)));
+            }
+            const int row = resultFiles.count();
+            beginInsertRows(rootIndex, row, row);
+            resultFiles.append(resultFile);
+            resultFileRows.insert(filePath, row);
+            ++totalResultFiles;
+            endInsertRows();
+        } else {
+            auto resultFile = resultFiles.at(resultFileRow);
+            const auto resultFileIndex = index(resultFileRow, 0, rootIndex);
+            const int row = resultFile->results.count();
+            beginInsertRows(resultFileIndex, row, row + (last - first) - 1);
+            for (int i = first; i < last; ++i) {
+                resultFile->results.append(new SearchResult(results.at(i)));
+            }
+            endInsertRows();
+        }
 
-    ++totalResults;
-    emit dataChanged(rootIndex, rootIndex, {Qt::DisplayRole});
+        totalResults += last - first;
+        first = last;
+    }
+
+    scheduleRootUpdate();
 }
 
-void SearchModel::remove(SearchResultFile *resultFile, SearchResult *result)
+void SearchModel::remove(const QList<SearchResult *> &results)
 {
-    const int resultFileRow = resultFiles.indexOf(resultFile);
-    Q_ASSERT(resultFileRow != -1);
+    if (results.isEmpty()) {
+        return;
+    }
 
-    const int resultRow = resultFile->results.indexOf(result);
-    Q_ASSERT(resultRow != -1);
+    QHash<QString, QSet<SearchResult *>> removedResults;
+    for (SearchResult *result : results) {
+        removedResults[result->filePath].insert(result);
+    }
 
     const auto rootIndex = index(0, 0);
-    const auto resultFileIndex = index(resultFileRow, 0, rootIndex);
-    Q_ASSERT(resultFileIndex.isValid());
+    QVector<int> removedFileRows;
+    for (auto it = removedResults.constBegin(); it != removedResults.constEnd(); ++it) {
+        const int resultFileRow = resultFileRows.value(it.key(), -1);
+        Q_ASSERT(resultFileRow != -1);
+        if (resultFileRow == -1) {
+            continue;
+        }
+        SearchResultFile *resultFile = resultFiles.at(resultFileRow);
+        const QSet<SearchResult *> &removed = it.value();
+        totalResults -= removed.size();
+        if (removed.size() >= resultFile->results.size()) {
+            removedFileRows.append(resultFileRow);
+            continue;
+        }
 
-    if (resultFile->results.size() > 1) {
-        // Remove a single search result
-        beginRemoveRows(resultFileIndex, resultRow, resultRow);
-        delete resultFile->results.takeAt(resultRow);
-        endRemoveRows();
-    } else {
-        // Remove the whole search result file
-        beginRemoveRows(rootIndex, resultFileRow, resultFileRow);
-        delete resultFiles.takeAt(resultFileRow);
-        --totalResultFiles;
-        endRemoveRows();
+        // Remove the runs of adjacent results from the end, so that the preceding rows stay valid:
+        const auto resultFileIndex = index(resultFileRow, 0, rootIndex);
+        for (int last = resultFile->results.size() - 1; last >= 0; --last) {
+            if (!removed.contains(resultFile->results.at(last))) {
+                continue;
+            }
+            int first = last;
+            while (first > 0 && removed.contains(resultFile->results.at(first - 1))) {
+                --first;
+            }
+            beginRemoveRows(resultFileIndex, first, last);
+            for (int row = first; row <= last; ++row) {
+                delete resultFile->results.at(row);
+            }
+            resultFile->results.erase(resultFile->results.begin() + first, resultFile->results.begin() + last + 1);
+            endRemoveRows();
+            last = first;
+        }
+    }
+
+    if (!removedFileRows.isEmpty()) {
+        // Remove the whole search result files, then renumber the remaining ones at once:
+        std::sort(removedFileRows.begin(), removedFileRows.end(), std::greater<int>());
+        for (int i = 0; i < removedFileRows.size();) {
+            const int last = removedFileRows.at(i++);
+            int first = last;
+            while (i < removedFileRows.size() && removedFileRows.at(i) == first - 1) {
+                first = removedFileRows.at(i++);
+            }
+            beginRemoveRows(rootIndex, first, last);
+            for (int row = first; row <= last; ++row) {
+                delete resultFiles.at(row);
+            }
+            resultFiles.erase(resultFiles.begin() + first, resultFiles.begin() + last + 1);
+            totalResultFiles -= last - first + 1;
+            endRemoveRows();
+        }
+        resultFileRows.clear();
+        for (int row = 0; row < resultFiles.count(); ++row) {
+            resultFileRows.insert(resultFiles.at(row)->path, row);
+        }
     }
 
     if (resultFiles.isEmpty()) {
@@ -307,13 +576,12 @@ void SearchModel::remove(SearchResultFile *resultFile, SearchResult *result)
         endRemoveRows();
     }
 
-    --totalResults;
-    emit dataChanged(rootIndex, rootIndex, {Qt::DisplayRole});
+    scheduleRootUpdate();
 }
 
 void SearchModel::update(SearchResultFile *resultFile, SearchResult *result)
 {
-    const int resultFileRow = resultFiles.indexOf(resultFile);
+    const int resultFileRow = resultFileRows.value(resultFile->path, -1);
     Q_ASSERT(resultFileRow != -1);
 
     const int resultRow = resultFile->results.indexOf(result);
@@ -334,12 +602,20 @@ void SearchModel::clear()
     beginResetModel();
     qDeleteAll(resultFiles);
     resultFiles.clear();
+    resultFileRows.clear();
     totalResults = 0;
     totalResultFiles = 0;
     isRootVisible = false;
     endResetModel();
 }
 
+void SearchModel::scheduleRootUpdate()
+{
+    if (!rootUpdateTimer.isActive()) {
+        rootUpdateTimer.start();
+    }
+}
+
 void SearchModel::search(const QString &query, const QString &directory)
 {
     if (query.isEmpty() || directory.isEmpty()) {
@@ -355,6 +631,11 @@ void SearchModel::cancelSearch()
     worker.cancelSearch();
 }
 
+void SearchModel::discardSearch()
+{
+    worker.discardSearch();
+}
+
 void SearchModel::replace(const QString &with)
 {
     worker.replace(resultFiles, with);
@@ -365,6 +646,16 @@ void SearchModel::cancelReplace()
     worker.cancelReplace();
 }
 
+void SearchModel::undoReplace()
+{
+    worker.undoReplace();
+}
+
+bool SearchModel::canUndoReplace() const
+{
+    return worker.canUndoReplace();
+}
+
 Qt::CheckState SearchModel::getRootCheckState() const
 {
     bool hasCheckedItems = false;
@@ -403,6 +694,16 @@ void SearchModel::setSearchByRegex(bool enabled)
     worker.setSearchByRegex(enabled);
 }
 
+void SearchModel::setSearchIndex(QSharedPointer<SearchIndex> index)
+{
+    worker.setSearchIndex(index);
+}
+
+void SearchModel::setFileCatalog(QSharedPointer<FileCatalog> catalog)
+{
+    worker.setFileCatalog(catalog);
+}
+
 QVariant SearchModel::data(const QModelIndex &index, int role) const
 {
     if (!index.isValid()) {
@@ -3,6 +3,14 @@
 
 #include "base/searchresult.h"
 #include <QAbstractItemModel>
+#include <QAtomicInt>
+#include <QHash>
+#include <QSharedPointer>
+#include <QTimer>
+
+class FileCatalog;
+class ReplaceJournal;
+class SearchIndex;
 
 class SearchModelWorker : public QObject
 {
@@ -11,31 +19,48 @@ class SearchModelWorker : public QObject
 public:
     void search(const QString &query, const QString &directory);
     void cancelSearch();
+    void discardSearch();
+    bool isCurrentSearch(int generation) const;
 
     void replace(const QList<SearchResultFile *> &resultFiles, const QString &with);
     void cancelReplace();
+    void undoReplace();
+    bool canUndoReplace() const;
 
     void setSearchCaseSensitive(bool enabled);
     void setSearchByRegex(bool enabled);
+    void setSearchIndex(QSharedPointer<SearchIndex> index);
+    void setFileCatalog(QSharedPointer<FileCatalog> catalog);
 
 signals:
-    void searchStarted();
-    void searchProgressed(const QString &currentFile);
-    void searchFinished(int resultCount, int fileCount);
+    // Deliveries are tagged with the search generation, so that those of a discarded search can be dropped
+    void searchStarted(int generation);
+    void searchProgressed(int generation, const QString &currentFile);
+    void searchFinished(int generation, int resultCount, int fileCount);
 
     void replaceStarted();
     void replaceProgressed(const QString &currentFile);
     void replaceFinished(int resultCount, int fileCount, bool allSucceeded);
+    void undoFinished(int fileCount, bool allSucceeded);
+    void filesChanged(const QStringList &paths);
 
-    void matchFound(const QString &filePath, const QString &lineContent, int lineNumber, int matchStart, int matchLength);
-    void matchReplaced(SearchResultFile *resultFile, SearchResult *result);
+    void matchesFound(int generation, const QList<SearchResult> &results);
+    void matchesReplaced(const QList<SearchResult *> &results);
     void matchUpdated(SearchResultFile *resultFile, SearchResult *result);
 
 private:
+    QSharedPointer<FileCatalog> getFileCatalog();
+    bool replaceInFile(SearchResultFile *resultFile, const QString &with, const QByteArray &encoding,
+                       ReplaceJournal *journal, QList<SearchResult *> &replaced);
+
+    QSharedPointer<SearchIndex> searchIndex;
+    QSharedPointer<FileCatalog> fileCatalog;
+    QSharedPointer<ReplaceJournal> replaceJournal;
     bool searchCaseSensitive = false;
     bool searchByRegex = false;
 
-    bool searchCancelRequested = true;
+    QAtomicInt searchGeneration;
+    QAtomicInt cancelledSearch;
     bool replaceCancelRequested = true;
 };
 
@@ -63,22 +88,27 @@ public:
 
     static bool isResultIndex(const QModelIndex &index);
 
-    void add(const QString &filePath, const QString &lineContent, int lineNumber, int matchStart, int matchLength);
-    void remove(SearchResultFile *resultFile, SearchResult *result);
+    void add(const QList<SearchResult> &results);
+    void remove(const QList<SearchResult *> &results);
     void update(SearchResultFile *resultFile, SearchResult *result);
     void clear();
 
     void search(const QString &query, const QString &directory);
     void cancelSearch();
+    void discardSearch();
 
     void replace(const QString &with);
     void cancelReplace();
+    void undoReplace();
+    bool canUndoReplace() const;
 
     Qt::CheckState getRootCheckState() const;
     void setRootPath(const QString &path);
 
     void setSearchCaseSensitive(bool enabled);
     void setSearchByRegex(bool enabled);
+    void setSearchIndex(QSharedPointer<SearchIndex> index);
+    void setFileCatalog(QSharedPointer<FileCatalog> catalog);
 
     QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
     bool setData(const QModelIndex &index, const QVariant &value, int role = Qt::EditRole) override;
@@ -96,6 +126,8 @@ signals:
     void replaceStarted();
     void replaceProgressed(const QString &currentFile);
     void replaceFinished(int resultCount, int fileCount, bool allSucceeded);
+    void undoFinished(int fileCount, bool allSucceeded);
+    void filesChanged(const QStringList &paths);
 
 private:
     enum IndexType {
@@ -103,9 +135,13 @@ private:
         ResultFileIndex = -2,
     };
 
+    void scheduleRootUpdate();
+
     SearchModelWorker worker;
 
     QList<SearchResultFile *> resultFiles;
+    QHash<QString, int> resultFileRows;
+    QTimer rootUpdateTimer;
     int totalResults = 0;
     int totalResultFiles = 0;
 
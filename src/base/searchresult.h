@@ -2,9 +2,11 @@
 #define SEARCHRESULT_H
 
 #include <QList>
+#include <QMetaType>
 
 struct SearchResult
 {
+    SearchResult() = default;
     SearchResult(const QString &filePath, const QString &lineContent,
                  int lineNumber, int matchStart, int matchLength);
 
@@ -13,12 +15,17 @@ struct SearchResult
 
     QString filePath;
     QString lineContent;
-    int lineNumber;
-    int matchStart;
-    int matchLength;
+    int lineNumber = 0;
+    int matchStart = 0;
+    int matchLength = 0;
+    qint64 byteStart = -1;
+    int byteLength = 0;
     Qt::CheckState checkState = Qt::Checked;
 };
 
+Q_DECLARE_METATYPE(SearchResult)
+Q_DECLARE_METATYPE(SearchResult *)
+
 struct SearchResultFile
 {
     SearchResultFile(const QString &path) : path(path) {}
@@ -53,6 +53,11 @@ int Settings::getJavaMaxHeapSize() const
     return settings->value("Java/MaxHeapSize").toInt();
 }
 
+bool Settings::getJavaWorkers() const
+{
+    return settings->value("Java/Workers", true).toBool();
+}
+
 QString Settings::getApktoolPath() const
 {
     return settings->value("Apktool/Path").toString();
@@ -83,11 +88,6 @@ QString Settings::getApksignerPath() const
     return settings->value("Signer/Path").toString();
 }
 
-QString Settings::getZipalignPath() const
-{
-    return settings->value("Zipalign/Path").toString();
-}
-
 QString Settings::getAdbPath() const
 {
     return settings->value("ADB/Path").toString();
@@ -155,6 +155,11 @@ bool Settings::getKeepBrokenResources() const
     return settings->value("Apktool/KeepBroken", false).toBool();
 }
 
+bool Settings::getQuickOpen() const
+{
+    return settings->value("Apktool/QuickOpen", false).toBool();
+}
+
 QString Settings::getDeviceAlias(const QString &serial) const
 {
     return settings->value(QString("Devices/%1").arg(serial)).toString();
@@ -345,6 +350,11 @@ void Settings::setJavaMaxHeapSize(int size)
     settings->setValue("Java/MaxHeapSize", size);
 }
 
+void Settings::setJavaWorkers(bool enabled)
+{
+    settings->setValue("Java/Workers", enabled);
+}
+
 void Settings::setApktoolPath(const QString &path)
 {
     settings->setValue("Apktool/Path", path);
@@ -375,11 +385,6 @@ void Settings::setApksignerPath(const QString &path)
     settings->setValue("Signer/Path", path);
 }
 
-void Settings::setZipalignPath(const QString &path)
-{
-    settings->setValue("Zipalign/Path", path);
-}
-
 void Settings::setAdbPath(const QString &path)
 {
     settings->setValue("ADB/Path", path);
@@ -447,6 +452,11 @@ void Settings::setKeepBrokenResources(bool keepBroken)
     settings->setValue("Apktool/KeepBroken", keepBroken);
 }
 
+void Settings::setQuickOpen(bool quickOpen)
+{
+    settings->setValue("Apktool/QuickOpen", quickOpen);
+}
+
 void Settings::setDeviceAlias(const QString &serial, const QString &alias)
 {
     settings->setValue(QString("Devices/%1").arg(serial), alias);
@@ -18,13 +18,13 @@ public:
     QString getJavaPath() const;
     int getJavaMinHeapSize() const;
     int getJavaMaxHeapSize() const;
+    bool getJavaWorkers() const;
     QString getApktoolPath() const;
     QString getOutputDirectory() const;
     QString getFrameworksDirectory() const;
     bool getSignApk() const;
     bool getOptimizeApk() const;
     QString getApksignerPath() const;
-    QString getZipalignPath() const;
     QString getAdbPath() const;
     bool getCustomKeystore() const;
     QString getKeystorePath() const;
@@ -38,6 +38,7 @@ public:
     bool getDecompileNoDebugInfo() const;
     bool getDecompileOnlyMainClasses() const;
     bool getKeepBrokenResources() const;
+    bool getQuickOpen() const;
     QString getDeviceAlias(const QString &serial) const;
     QString getLastDirectory() const;
     bool getSingleInstance() const;
@@ -74,13 +75,13 @@ public:
     void setJavaPath(const QString &path);
     void setJavaMinHeapSize(int size);
     void setJavaMaxHeapSize(int size);
+    void setJavaWorkers(bool enabled);
     void setApktoolPath(const QString &path);
     void setOutputDirectory(const QString &directory);
     void setFrameworksDirectory(const QString &directory);
     void setSignApk(bool sign);
     void setOptimizeApk(bool sign);
     void setApksignerPath(const QString &path);
-    void setZipalignPath(const QString &path);
     void setAdbPath(const QString &path);
     void setCustomKeystore(bool custom);
     void setKeystorePath(const QString &path);
@@ -94,6 +95,7 @@ public:
     void setDecompileNoDebugInfo(bool noDebugInfo);
     void setDecompileOnlyMainClasses(bool onlyMain);
     void setKeepBrokenResources(bool keepBroken);
+    void setQuickOpen(bool quickOpen);
     void setDeviceAlias(const QString &serial, const QString &alias);
     void setLastDirectory(const QString &directory);
     void setSingleInstance(bool value);
@@ -0,0 +1,159 @@
+#include "base/thumbnailservice.h"
+#include "base/utils.h"
+#include <QBuffer>
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QDirIterator>
+#include <QFileInfo>
+#include <QFutureWatcher>
+#include <QImageReader>
+#include <QSaveFile>
+#include <QtConcurrent/QtConcurrent>
+
+namespace
+{
+    // Memory cache limit (in KB)
+    const int CacheCost = 32 * 1024;
+    // Requests above this limit are dropped, the oldest first; they are repeated once their items are painted again
+    const int QueueLimit = 256;
+    // Disk cache entries older than this (in days) are removed once per session
+    const int DiskCacheLifetime = 30;
+}
+
+ThumbnailService::ThumbnailService(QObject *parent) : QObject(parent)
+{
+    cache.setMaxCost(CacheCost);
+    pool.setMaxThreadCount(qBound(1, QThread::idealThreadCount() / 2, 4));
+}
+
+ThumbnailService::~ThumbnailService()
+{
+    queue.clear();
+    pool.waitForDone();
+}
+
+QPixmap ThumbnailService::getThumbnail(const QString &path)
+{
+    const QString key = getKey(QFileInfo(path));
+    if (QPixmap *thumbnail = cache.object(key)) {
+        return *thumbnail;
+    }
+    if (!pending.contains(key)) {
+        pending.insert(key);
+        queue.append({path, key});
+        if (queue.size() > QueueLimit) {
+            pending.remove(queue.takeFirst().key);
+        }
+        dequeue();
+    }
+    return QPixmap();
+}
+
+QSize ThumbnailService::getThumbnailSize()
+{
+    return Utils::scale(64, 64);
+}
+
+void ThumbnailService::dequeue()
+{
+    // The most recent requests belong to the currently visible items, so they go first:
+    while (running < pool.maxThreadCount() && !queue.isEmpty()) {
+        const Request request = queue.takeLast();
+        const QString cachePath = getCachePath();
+        ++running;
+        auto watcher = new QFutureWatcher<QImage>(this);
+        connect(watcher, &QFutureWatcher<QImage>::finished, this, [=]() {
+            --running;
+            pending.remove(request.key);
+            insert(request.key, watcher->result());
+            watcher->deleteLater();
+            emit thumbnailReady(request.path);
+            dequeue();
+        });
+        const QString path = request.path;
+        const QSize size = getThumbnailSize();
+        watcher->setFuture(QtConcurrent::run(&pool, [path, cachePath, size]() {
+            return decode(path, cachePath, size);
+        }));
+    }
+}
+
+void ThumbnailService::insert(const QString &key, const QImage &image)
+{
+    // Failed decodes are cached as well to avoid requesting them over and over
+    auto thumbnail = new QPixmap(QPixmap::fromImage(image));
+    const int cost = qMax(1, thumbnail->width() * thumbnail->height() * 4 / 1024);
+    cache.insert(key, thumbnail, cost);
+}
+
+QString ThumbnailService::getCachePath()
+{
+    if (cachePath.isEmpty()) {
+        cachePath = Utils::getLocalConfigPath("cache/thumbnails");
+        pruneDiskCache();
+    }
+    return cachePath;
+}
+
+void ThumbnailService::pruneDiskCache()
+{
+    const QString path = cachePath;
+    QtConcurrent::run(&pool, [path]() {
+        const QDateTime expiration = QDateTime::currentDateTime().addDays(-DiskCacheLifetime);
+        QDirIterator it(path, {"*.png"}, QDir::Files);
+        while (it.hasNext()) {
+            it.next();
+            if (it.fileInfo().lastModified() < expiration) {
+                QFile::remove(it.filePath());
+            }
+        }
+    });
+}
+
+QString ThumbnailService::getKey(const QFileInfo &file)
+{
+    // Memory cache key, the disk cache is keyed by the file contents instead:
+    const QSize size = getThumbnailSize();
+    return QString("%1|%2|%3|%4x%5").arg(file.absoluteFilePath())
+        .arg(file.lastModified().toMSecsSinceEpoch())
+        .arg(file.size())
+        .arg(size.width()).arg(size.height());
+}
+
+QImage ThumbnailService::decode(const QString &path, const QString &cachePath, const QSize &size)
+{
+    // Contents directories are recreated every session, so the disk cache can't rely on paths:
+    QFile source(path);
+    if (!source.open(QFile::ReadOnly)) {
+        return QImage();
+    }
+    QByteArray data = source.readAll();
+    source.close();
+    const QByteArray hash = QCryptographicHash::hash(data, QCryptographicHash::Md5).toHex();
+    const QString cacheFilePath = QString("%1/%2-%3x%4.png")
+        .arg(cachePath, QString::fromLatin1(hash)).arg(size.width()).arg(size.height());
+
+    QImage image;
+    if (image.load(cacheFilePath, "PNG")) {
+        return image;
+    }
+
+    QBuffer buffer(&data);
+    QImageReader reader(&buffer);
+    const QSize originalSize = reader.size();
+    const bool downscale = originalSize.width() > size.width() || originalSize.height() > size.height();
+    if (downscale) {
+        reader.setScaledSize(originalSize.scaled(size, Qt::KeepAspectRatio));
+    }
+    image = reader.read();
+
+    // Only downscaled images are worth caching, smaller ones are as fast to decode from the source:
+    if (downscale && !image.isNull() && QDir().mkpath(QFileInfo(cacheFilePath).path())) {
+        QSaveFile file(cacheFilePath);
+        if (file.open(QSaveFile::WriteOnly) && image.save(&file, "PNG")) {
+            file.commit();
+        }
+    }
+    return image;
+}
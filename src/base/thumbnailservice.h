@@ -0,0 +1,50 @@
+#ifndef THUMBNAILSERVICE_H
+#define THUMBNAILSERVICE_H
+
+#include <QCache>
+#include <QObject>
+#include <QPixmap>
+#include <QSet>
+#include <QThreadPool>
+
+class QFileInfo;
+
+class ThumbnailService : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ThumbnailService(QObject *parent = nullptr);
+    ~ThumbnailService() override;
+
+    QPixmap getThumbnail(const QString &path);
+
+    static QSize getThumbnailSize();
+
+signals:
+    void thumbnailReady(const QString &path);
+
+private:
+    struct Request
+    {
+        QString path;
+        QString key;
+    };
+
+    void dequeue();
+    void insert(const QString &key, const QImage &image);
+    QString getCachePath();
+    void pruneDiskCache();
+
+    static QString getKey(const QFileInfo &file);
+    static QImage decode(const QString &path, const QString &cachePath, const QSize &size);
+
+    QCache<QString, QPixmap> cache;
+    QList<Request> queue;
+    QSet<QString> pending;
+    QThreadPool pool;
+    QString cachePath;
+    int running = 0;
+};
+
+#endif // THUMBNAILSERVICE_H
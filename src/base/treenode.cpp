@@ -1,5 +1,10 @@
 #include "base/treenode.h"
 
+namespace
+{
+    const size_t ArenaBlockSize = 64 * 1024;
+}
+
 TreeNode::~TreeNode()
 {
     removeChildren();
@@ -8,12 +13,20 @@ TreeNode::~TreeNode()
 void TreeNode::addChild(TreeNode *node)
 {
     node->parent = this;
+    node->position = children.size();
     children.append(node);
 }
 
+void TreeNode::insertChild(int row, TreeNode *node)
+{
+    node->parent = this;
+    children.insert(row, node);
+    updateRows(row);
+}
+
 bool TreeNode::hasChild(TreeNode *node) const
 {
-    return children.contains(node);
+    return node->parent == this;
 }
 
 bool TreeNode::hasChildren() const
@@ -23,13 +36,16 @@ bool TreeNode::hasChildren() const
 
 void TreeNode::removeChild(int row)
 {
-    delete children[row];
+    destroy(children[row]);
     children.remove(row);
+    updateRows(row);
 }
 
 void TreeNode::removeChildren()
 {
-    qDeleteAll(children);
+    for (TreeNode *child : qAsConst(children)) {
+        destroy(child);
+    }
     children.clear();
 }
 
@@ -39,6 +55,17 @@ void TreeNode::removeSelf()
     parent->removeChild(row());
 }
 
+QVector<TreeNode *> TreeNode::takeChildren()
+{
+    QVector<TreeNode *> result;
+    result.swap(children);
+    for (TreeNode *child : qAsConst(result)) {
+        child->parent = nullptr;
+        child->position = 0;
+    }
+    return result;
+}
+
 int TreeNode::childCount() const
 {
     return children.count();
@@ -54,12 +81,48 @@ TreeNode *TreeNode::getParent() const
     return parent;
 }
 
-QVector<TreeNode *> &TreeNode::getChildren()
+const QVector<TreeNode *> &TreeNode::getChildren() const
 {
     return children;
 }
 
 int TreeNode::row() const
 {
-    return parent ? parent->children.indexOf(const_cast<TreeNode *>(this)) : 0;
+    return parent ? position : 0;
+}
+
+void TreeNode::destroy(TreeNode *node)
+{
+    if (node->arena) {
+        node->~TreeNode();
+    } else {
+        delete node;
+    }
+}
+
+void TreeNode::updateRows(int from)
+{
+    for (int row = from; row < children.size(); ++row) {
+        children.at(row)->position = row;
+    }
+}
+
+TreeNodeArena::~TreeNodeArena()
+{
+    for (char *block : qAsConst(blocks)) {
+        ::operator delete(block);
+    }
+}
+
+void *TreeNodeArena::allocate(size_t size, size_t alignment)
+{
+    Q_ASSERT(size <= ArenaBlockSize);
+    offset = (offset + alignment - 1) & ~(alignment - 1);
+    if (blocks.isEmpty() || offset + size > ArenaBlockSize) {
+        blocks.append(static_cast<char *>(::operator new(ArenaBlockSize)));
+        offset = 0;
+    }
+    void *memory = blocks.last() + offset;
+    offset += size;
+    return memory;
 }
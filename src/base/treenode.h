@@ -2,6 +2,11 @@
 #define TREENODE_H
 
 #include <QVector>
+#include <algorithm>
+#include <new>
+#include <utility>
+
+class TreeNodeArena;
 
 class TreeNode
 {
@@ -10,24 +15,65 @@ public:
     virtual ~TreeNode();
 
     void addChild(TreeNode *node);
+    void insertChild(int row, TreeNode *node);
     bool hasChild(TreeNode *node) const;
     bool hasChildren() const;
 
     virtual void removeChild(int row);
     void removeChildren();
     void removeSelf();
+    QVector<TreeNode *> takeChildren();
+
+    template <typename LessThan>
+    void sortChildren(LessThan lessThan)
+    {
+        std::stable_sort(children.begin(), children.end(), lessThan);
+        updateRows(0);
+    }
 
     int childCount() const;
     TreeNode *getChild(int row) const;
     TreeNode *getParent() const;
-    QVector<TreeNode *> &getChildren();
+    const QVector<TreeNode *> &getChildren() const;
 
     int row() const;
 
+    static void destroy(TreeNode *node);
+
 protected:
     TreeNode *parent;
     QVector<TreeNode *> children;
+
+private:
+    friend class TreeNodeArena;
+    void updateRows(int from);
+
+    int position = 0; // Row in the parent node, kept up to date by the parent
+    const TreeNodeArena *arena = nullptr;
 };
 
+// Allocates nodes in large blocks, so that big trees do not cost a heap allocation per node.
+// Nodes are destroyed by their parents as usual; the memory is released along with the arena.
+class TreeNodeArena
+{
+public:
+    TreeNodeArena() = default;
+    ~TreeNodeArena();
+
+    template <typename T, typename... Args>
+    T *create(Args &&...args)
+    {
+        T *node = new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+        static_cast<TreeNode *>(node)->arena = this;
+        return node;
+    }
+
+private:
+    Q_DISABLE_COPY(TreeNodeArena)
+    void *allocate(size_t size, size_t alignment);
+
+    QVector<char *> blocks;
+    size_t offset = 0;
+};
 
 #endif // TREENODE_H
@@ -0,0 +1,279 @@
+#include "base/ziparchive.h"
+#include <QDir>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QtEndian>
+#include <QDebug>
+#include <zlib.h>
+
+namespace
+{
+    const quint32 LocalHeaderSignature = 0x04034b50;
+    const quint32 CentralHeaderSignature = 0x02014b50;
+    const quint32 EndOfCentralDirectorySignature = 0x06054b50;
+    const qint64 LocalHeaderSize = 30;
+    const qint64 CentralHeaderSize = 46;
+    const qint64 EndOfCentralDirectorySize = 22;
+
+    inline quint16 readUInt16(const uchar *data)
+    {
+        return qFromLittleEndian<quint16>(data);
+    }
+
+    inline quint32 readUInt32(const uchar *data)
+    {
+        return qFromLittleEndian<quint32>(data);
+    }
+}
+
+ZipArchive::ZipArchive(const QString &path)
+    : file(path)
+    , data(nullptr)
+    , size(0)
+{
+}
+
+ZipArchive::~ZipArchive()
+{
+    close();
+}
+
+bool ZipArchive::open()
+{
+    if (isOpen()) {
+        return true;
+    }
+    if (!file.open(QFile::ReadOnly)) {
+        qWarning() << "Error: Could not open ZIP archive" << file.fileName();
+        return false;
+    }
+    size = file.size();
+    data = size >= EndOfCentralDirectorySize ? file.map(0, size) : nullptr;
+    if (!data || !readCentralDirectory()) {
+        qWarning() << "Error: Could not read ZIP central directory" << file.fileName();
+        close();
+        return false;
+    }
+    return true;
+}
+
+void ZipArchive::close()
+{
+    if (data) {
+        file.unmap(data);
+        data = nullptr;
+    }
+    file.close();
+    size = 0;
+    entries.clear();
+    entryIndex.clear();
+}
+
+bool ZipArchive::isOpen() const
+{
+    return data;
+}
+
+QString ZipArchive::getPath() const
+{
+    return file.fileName();
+}
+
+const QVector<ZipArchive::Entry> &ZipArchive::getEntries() const
+{
+    return entries;
+}
+
+const ZipArchive::Entry *ZipArchive::getEntry(const QString &name) const
+{
+    const int index = entryIndex.value(name, -1);
+    return index != -1 ? &entries.at(index) : nullptr;
+}
+
+qint64 ZipArchive::getDataOffset(const Entry &entry) const
+{
+    const qint64 offset = entry.localHeaderOffset;
+    if (!data || offset + LocalHeaderSize > size) {
+        return -1;
+    }
+    const uchar *header = data + offset;
+    if (readUInt32(header) != LocalHeaderSignature) {
+        return -1;
+    }
+    // Local header name and extra field lengths may differ from the central directory:
+    const qint64 dataOffset = offset + LocalHeaderSize + readUInt16(header + 26) + readUInt16(header + 28);
+    if (dataOffset + entry.compressedSize > size) {
+        return -1;
+    }
+    return dataOffset;
+}
+
+const uchar *ZipArchive::getData() const
+{
+    return data;
+}
+
+qint64 ZipArchive::getSize() const
+{
+    return size;
+}
+
+int ZipArchive::getHandle() const
+{
+    return file.handle();
+}
+
+QByteArray ZipArchive::read(const Entry &entry) const
+{
+    const qint64 offset = getDataOffset(entry);
+    if (offset == -1) {
+        qWarning() << "Error: Invalid ZIP entry" << entry.name;
+        return QByteArray();
+    }
+    const char *source = reinterpret_cast<const char *>(data + offset);
+
+    if (entry.method == Stored) {
+        return QByteArray(source, static_cast<int>(entry.compressedSize));
+    }
+
+    if (entry.method != Deflated) {
+        qWarning() << "Error: Unsupported ZIP compression method" << entry.method << entry.name;
+        return QByteArray();
+    }
+
+    QByteArray result(static_cast<int>(entry.uncompressedSize), Qt::Uninitialized);
+    z_stream stream = {};
+    stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(source));
+    stream.avail_in = entry.compressedSize;
+    stream.next_out = reinterpret_cast<Bytef *>(result.data());
+    stream.avail_out = entry.uncompressedSize;
+    if (inflateInit2(&stream, -MAX_WBITS) != Z_OK) {
+        return QByteArray();
+    }
+    const int status = inflate(&stream, Z_FINISH);
+    inflateEnd(&stream);
+    if (status != Z_STREAM_END || stream.total_out != entry.uncompressedSize) {
+        qWarning() << "Error: Could not inflate ZIP entry" << entry.name;
+        return QByteArray();
+    }
+    return result;
+}
+
+QByteArray ZipArchive::read(const QString &name) const
+{
+    const Entry *entry = getEntry(name);
+    return entry ? read(*entry) : QByteArray();
+}
+
+QByteArray ZipArchive::peek(const Entry &entry) const
+{
+    // Stored entries are not copied, the result is only valid while the archive is open:
+    if (entry.method == Stored) {
+        const qint64 offset = getDataOffset(entry);
+        if (offset == -1) {
+            qWarning() << "Error: Invalid ZIP entry" << entry.name;
+            return QByteArray();
+        }
+        return QByteArray::fromRawData(reinterpret_cast<const char *>(data + offset), static_cast<int>(entry.compressedSize));
+    }
+    return read(entry);
+}
+
+bool ZipArchive::extract(const Entry &entry, const QString &target) const
+{
+    if (entry.isDirectory()) {
+        return QDir().mkpath(target);
+    }
+    const QByteArray contents = read(entry);
+    if (contents.isNull() && entry.uncompressedSize) {
+        return false;
+    }
+    QDir().mkpath(QFileInfo(target).absolutePath());
+    QSaveFile output(target);
+    if (!output.open(QSaveFile::WriteOnly)) {
+        qWarning() << "Error: Could not write" << target;
+        return false;
+    }
+    output.write(contents);
+    return output.commit();
+}
+
+quint32 ZipArchive::checksum(const QString &path)
+{
+    QFile input(path);
+    if (!input.open(QFile::ReadOnly)) {
+        return 0;
+    }
+    uLong crc = crc32(0, Z_NULL, 0);
+    char buffer[64 * 1024];
+    qint64 length;
+    while ((length = input.read(buffer, sizeof(buffer))) > 0) {
+        crc = crc32(crc, reinterpret_cast<const Bytef *>(buffer), static_cast<uInt>(length));
+    }
+    return static_cast<quint32>(crc);
+}
+
+bool ZipArchive::readCentralDirectory()
+{
+    // Locate the end of central directory record (it may be followed by a comment of up to 64 KiB):
+
+    const qint64 searchLimit = qMax<qint64>(0, size - EndOfCentralDirectorySize - 0xFFFF);
+    qint64 eocd = -1;
+    for (qint64 offset = size - EndOfCentralDirectorySize; offset >= searchLimit; --offset) {
+        if (readUInt32(data + offset) == EndOfCentralDirectorySignature) {
+            eocd = offset;
+            break;
+        }
+    }
+    if (eocd == -1) {
+        return false;
+    }
+
+    const int entryCount = readUInt16(data + eocd + 10);
+    const quint32 directorySize = readUInt32(data + eocd + 12);
+    const quint32 directoryOffset = readUInt32(data + eocd + 16);
+    if (entryCount == 0xFFFF || directoryOffset == 0xFFFFFFFF) {
+        qWarning() << "Error: ZIP64 archives are not supported";
+        return false;
+    }
+    if (static_cast<qint64>(directoryOffset) + directorySize > eocd) {
+        return false;
+    }
+
+    // Parse the central directory:
+
+    entries.reserve(entryCount);
+    entryIndex.reserve(entryCount);
+    qint64 offset = directoryOffset;
+    for (int i = 0; i < entryCount; ++i) {
+        if (offset + CentralHeaderSize > eocd) {
+            return false;
+        }
+        const uchar *header = data + offset;
+        if (readUInt32(header) != CentralHeaderSignature) {
+            return false;
+        }
+        const int nameLength = readUInt16(header + 28);
+        const int extraLength = readUInt16(header + 30);
+        const int commentLength = readUInt16(header + 32);
+        if (offset + CentralHeaderSize + nameLength > eocd) {
+            return false;
+        }
+
+        // The encryption flag is ignored, same as Android does.
+        Entry entry;
+        entry.flags = readUInt16(header + 8);
+        entry.method = readUInt16(header + 10);
+        entry.crc = readUInt32(header + 16);
+        entry.compressedSize = readUInt32(header + 20);
+        entry.uncompressedSize = readUInt32(header + 24);
+        entry.localHeaderOffset = readUInt32(header + 42);
+        entry.centralHeaderOffset = static_cast<quint32>(offset);
+        entry.name = QString::fromUtf8(reinterpret_cast<const char *>(header + CentralHeaderSize), nameLength);
+
+        entryIndex.insert(entry.name, entries.size());
+        entries.append(entry);
+        offset += CentralHeaderSize + nameLength + extraLength + commentLength;
+    }
+    return true;
+}
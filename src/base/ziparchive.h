@@ -0,0 +1,62 @@
+#ifndef ZIPARCHIVE_H
+#define ZIPARCHIVE_H
+
+#include <QFile>
+#include <QHash>
+#include <QVector>
+
+class ZipArchive
+{
+public:
+    enum Method {
+        Stored = 0,
+        Deflated = 8
+    };
+
+    struct Entry
+    {
+        QString name;
+        quint16 flags;
+        quint16 method;
+        quint32 crc;
+        quint32 compressedSize;
+        quint32 uncompressedSize;
+        quint32 localHeaderOffset;
+        quint32 centralHeaderOffset;
+
+        bool isDirectory() const { return name.endsWith('/'); }
+    };
+
+    ZipArchive(const QString &path);
+    ~ZipArchive();
+
+    bool open();
+    void close();
+    bool isOpen() const;
+    QString getPath() const;
+
+    const QVector<Entry> &getEntries() const;
+    const Entry *getEntry(const QString &name) const;
+    qint64 getDataOffset(const Entry &entry) const;
+    const uchar *getData() const;
+    qint64 getSize() const;
+    int getHandle() const;
+
+    QByteArray read(const Entry &entry) const;
+    QByteArray read(const QString &name) const;
+    QByteArray peek(const Entry &entry) const;
+    bool extract(const Entry &entry, const QString &target) const;
+
+    static quint32 checksum(const QString &path);
+
+private:
+    bool readCentralDirectory();
+
+    QFile file;
+    uchar *data;
+    qint64 size;
+    QVector<Entry> entries;
+    QHash<QString, int> entryIndex;
+};
+
+#endif // ZIPARCHIVE_H
@@ -0,0 +1,280 @@
+#include "base/zipwriter.h"
+#include <QtEndian>
+#include <QDebug>
+#include <zlib.h>
+#ifdef Q_OS_LINUX
+#include <sys/sendfile.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    const quint32 LocalHeaderSignature = 0x04034b50;
+    const quint32 DataDescriptorSignature = 0x08074b50;
+    const quint32 EndOfCentralDirectorySignature = 0x06054b50;
+    const qint64 CentralHeaderSize = 46;
+    const qint64 DirectCopyThreshold = 64 * 1024;
+    const quint16 EncryptedFlag = 0x0001;
+    const quint16 DataDescriptorFlag = 0x0008;
+
+    inline quint16 readUInt16(const uchar *data)
+    {
+        return qFromLittleEndian<quint16>(data);
+    }
+
+    inline quint32 readUInt32(const uchar *data)
+    {
+        return qFromLittleEndian<quint32>(data);
+    }
+
+    void appendUInt16(QByteArray &data, quint16 value)
+    {
+        uchar bytes[2];
+        qToLittleEndian(value, bytes);
+        data.append(reinterpret_cast<const char *>(bytes), 2);
+    }
+
+    void appendUInt32(QByteArray &data, quint32 value)
+    {
+        uchar bytes[4];
+        qToLittleEndian(value, bytes);
+        data.append(reinterpret_cast<const char *>(bytes), 4);
+    }
+
+    void setUInt16(QByteArray &data, int position, quint16 value)
+    {
+        qToLittleEndian(value, reinterpret_cast<uchar *>(data.data() + position));
+    }
+
+    void setUInt32(QByteArray &data, int position, quint32 value)
+    {
+        qToLittleEndian(value, reinterpret_cast<uchar *>(data.data() + position));
+    }
+
+    QByteArray deflateData(const QByteArray &data)
+    {
+        z_stream stream = {};
+        if (deflateInit2(&stream, Z_BEST_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+            return QByteArray();
+        }
+        QByteArray result(static_cast<int>(deflateBound(&stream, static_cast<uLong>(data.size()))), Qt::Uninitialized);
+        stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data.constData()));
+        stream.avail_in = static_cast<uInt>(data.size());
+        stream.next_out = reinterpret_cast<Bytef *>(result.data());
+        stream.avail_out = static_cast<uInt>(result.size());
+        const int status = deflate(&stream, Z_FINISH);
+        deflateEnd(&stream);
+        if (status != Z_STREAM_END) {
+            return QByteArray();
+        }
+        result.resize(static_cast<int>(stream.total_out));
+        return result;
+    }
+
+#ifdef Q_OS_LINUX
+    // Copies the file range inside the kernel without passing the data through user space.
+    // Returns the number of bytes copied, which may be less than requested if not supported.
+    qint64 copyFileRange(int source, qint64 sourceOffset, int target, qint64 targetOffset, qint64 length)
+    {
+        loff_t in = sourceOffset;
+        loff_t out = targetOffset;
+        qint64 copied = 0;
+        while (copied < length) {
+            const size_t chunk = static_cast<size_t>(length - copied);
+            ssize_t result = copy_file_range(source, &in, target, &out, chunk, 0);
+            if (result <= 0) {
+                // E.g., different file systems on older kernels:
+                off_t sendOffset = in;
+                if (lseek(target, out, SEEK_SET) == -1) {
+                    break;
+                }
+                result = sendfile(target, source, &sendOffset, chunk);
+                if (result <= 0) {
+                    break;
+                }
+                in += result;
+                out += result;
+            }
+            copied += result;
+        }
+        return copied;
+    }
+#endif
+
+    // Returns the central directory record of the entry, including its name, extra field and comment
+    QByteArray getCentralHeader(const ZipArchive &archive, const ZipArchive::Entry &entry)
+    {
+        const qint64 position = entry.centralHeaderOffset;
+        if (position + CentralHeaderSize > archive.getSize()) {
+            return QByteArray();
+        }
+        const uchar *header = archive.getData() + position;
+        const qint64 length = CentralHeaderSize + readUInt16(header + 28) + readUInt16(header + 30) + readUInt16(header + 32);
+        if (position + length > archive.getSize()) {
+            return QByteArray();
+        }
+        return QByteArray(reinterpret_cast<const char *>(header), static_cast<int>(length));
+    }
+}
+
+ZipWriter::ZipWriter(const QString &path)
+    : file(path)
+    , entryCount(0)
+    , offset(0)
+{
+}
+
+bool ZipWriter::open()
+{
+    if (!file.open(QFile::WriteOnly)) {
+        qWarning() << "Error: Could not write ZIP archive" << file.fileName();
+        return false;
+    }
+    return true;
+}
+
+bool ZipWriter::copyEntry(const ZipArchive &archive, const ZipArchive::Entry &entry, int alignment)
+{
+    QByteArray centralHeader = getCentralHeader(archive, entry);
+    const qint64 dataOffset = archive.getDataOffset(entry);
+    if (centralHeader.isEmpty() || dataOffset == -1) {
+        qWarning() << "Error: Invalid ZIP entry" << entry.name;
+        return false;
+    }
+
+    // Local header, data and (optional) data descriptor are copied as a single block:
+    qint64 end = dataOffset + entry.compressedSize;
+    if (entry.flags & DataDescriptorFlag) {
+        const bool hasSignature = end + 4 <= archive.getSize() && readUInt32(archive.getData() + end) == DataDescriptorSignature;
+        end += hasSignature ? 16 : 12;
+        if (end > archive.getSize()) {
+            qWarning() << "Error: Invalid ZIP entry" << entry.name;
+            return false;
+        }
+    }
+
+    setUInt32(centralHeader, 42, static_cast<quint32>(offset));
+    centralDirectory.append(centralHeader);
+    ++entryCount;
+
+    const qint64 localHeaderSize = dataOffset - entry.localHeaderOffset;
+    const qint64 padding = alignment > 1 ? (alignment - (offset + localHeaderSize) % alignment) % alignment : 0;
+    if (!padding) {
+        return copy(archive, entry.localHeaderOffset, end - entry.localHeaderOffset);
+    }
+
+    // Only the local header is rewritten, the entry data is copied as it is:
+    QByteArray localHeader(reinterpret_cast<const char *>(archive.getData() + entry.localHeaderOffset), static_cast<int>(localHeaderSize));
+    const qint64 extraSize = readUInt16(reinterpret_cast<const uchar *>(localHeader.constData()) + 28) + padding;
+    if (extraSize > 0xFFFF) {
+        qWarning() << "Error: Could not align ZIP entry" << entry.name;
+        file.cancelWriting();
+        return false;
+    }
+    setUInt16(localHeader, 28, static_cast<quint16>(extraSize));
+    localHeader.append(QByteArray(static_cast<int>(padding), '\0'));
+    return write(localHeader) && copy(archive, dataOffset, end - dataOffset);
+}
+
+bool ZipWriter::replaceEntry(const ZipArchive &archive, const ZipArchive::Entry &entry, const QByteArray &contents, int alignment)
+{
+    QByteArray centralHeader = getCentralHeader(archive, entry);
+    if (centralHeader.isEmpty()) {
+        qWarning() << "Error: Invalid ZIP entry" << entry.name;
+        return false;
+    }
+
+    // The original compression method is kept (resources.arsc has to stay uncompressed):
+    const quint16 method = entry.method == ZipArchive::Stored ? ZipArchive::Stored : ZipArchive::Deflated;
+    const QByteArray data = method == ZipArchive::Deflated ? deflateData(contents) : contents;
+    if (data.isNull() && !contents.isEmpty()) {
+        qWarning() << "Error: Could not deflate ZIP entry" << entry.name;
+        return false;
+    }
+    const quint32 crc = static_cast<quint32>(crc32(0, reinterpret_cast<const Bytef *>(contents.constData()), static_cast<uInt>(contents.size())));
+    const quint16 flags = entry.flags & ~(DataDescriptorFlag | EncryptedFlag);
+    const QByteArray name = centralHeader.mid(CentralHeaderSize, readUInt16(reinterpret_cast<const uchar *>(centralHeader.constData()) + 28));
+
+    QByteArray localHeader;
+    appendUInt32(localHeader, LocalHeaderSignature);
+    localHeader.append(centralHeader.mid(6, 2)); // Version needed to extract
+    appendUInt16(localHeader, flags);
+    appendUInt16(localHeader, method);
+    localHeader.append(centralHeader.mid(12, 4)); // Modification time and date
+    appendUInt32(localHeader, crc);
+    appendUInt32(localHeader, static_cast<quint32>(data.size()));
+    appendUInt32(localHeader, static_cast<quint32>(contents.size()));
+    appendUInt16(localHeader, static_cast<quint16>(name.size()));
+    const qint64 headerSize = localHeader.size() + 2 + name.size();
+    const qint64 padding = alignment > 1 ? (alignment - (offset + headerSize) % alignment) % alignment : 0;
+    appendUInt16(localHeader, static_cast<quint16>(padding));
+    localHeader.append(name);
+    localHeader.append(QByteArray(static_cast<int>(padding), '\0'));
+
+    setUInt16(centralHeader, 8, flags);
+    setUInt16(centralHeader, 10, method);
+    setUInt32(centralHeader, 16, crc);
+    setUInt32(centralHeader, 20, static_cast<quint32>(data.size()));
+    setUInt32(centralHeader, 24, static_cast<quint32>(contents.size()));
+    setUInt32(centralHeader, 42, static_cast<quint32>(offset));
+    centralDirectory.append(centralHeader);
+    ++entryCount;
+    return write(localHeader) && write(data);
+}
+
+bool ZipWriter::commit()
+{
+    if (entryCount > 0xFFFF || offset + centralDirectory.size() > 0xFFFFFFFF) {
+        qWarning() << "Error: ZIP64 archives are not supported";
+        file.cancelWriting();
+        return false;
+    }
+    const qint64 directoryOffset = offset;
+    QByteArray end;
+    appendUInt32(end, EndOfCentralDirectorySignature);
+    appendUInt16(end, 0);
+    appendUInt16(end, 0);
+    appendUInt16(end, static_cast<quint16>(entryCount));
+    appendUInt16(end, static_cast<quint16>(entryCount));
+    appendUInt32(end, static_cast<quint32>(centralDirectory.size()));
+    appendUInt32(end, static_cast<quint32>(directoryOffset));
+    appendUInt16(end, 0);
+    if (!write(centralDirectory) || !write(end) || !file.commit()) {
+        qWarning() << "Error: Could not write ZIP archive" << file.fileName();
+        return false;
+    }
+    return true;
+}
+
+bool ZipWriter::write(const QByteArray &data)
+{
+    return write(reinterpret_cast<const uchar *>(data.constData()), data.size());
+}
+
+bool ZipWriter::write(const uchar *data, qint64 length)
+{
+    if (file.write(reinterpret_cast<const char *>(data), length) != length) {
+        file.cancelWriting();
+        return false;
+    }
+    offset += length;
+    return true;
+}
+
+bool ZipWriter::copy(const ZipArchive &archive, qint64 position, qint64 length)
+{
+#ifdef Q_OS_LINUX
+    // Larger blocks are copied between the files directly:
+    if (length >= DirectCopyThreshold && file.flush()) {
+        const qint64 copied = copyFileRange(archive.getHandle(), position, file.handle(), offset, length);
+        offset += copied;
+        position += copied;
+        length -= copied;
+        if (!file.seek(offset)) {
+            file.cancelWriting();
+            return false;
+        }
+    }
+#endif
+    return !length || write(archive.getData() + position, length);
+}
@@ -0,0 +1,32 @@
+#ifndef ZIPWRITER_H
+#define ZIPWRITER_H
+
+#include "base/ziparchive.h"
+#include <QSaveFile>
+
+// Writes a ZIP archive sequentially. Entries of an existing archive are copied through
+// as they are (without recompression), replaced entries keep their original metadata.
+// Entries can be aligned by padding the extra field of their local header.
+
+class ZipWriter
+{
+public:
+    ZipWriter(const QString &path);
+
+    bool open();
+    bool copyEntry(const ZipArchive &archive, const ZipArchive::Entry &entry, int alignment = 0);
+    bool replaceEntry(const ZipArchive &archive, const ZipArchive::Entry &entry, const QByteArray &contents, int alignment = 0);
+    bool commit();
+
+private:
+    bool write(const QByteArray &data);
+    bool write(const uchar *data, qint64 length);
+    bool copy(const ZipArchive &archive, qint64 position, qint64 length);
+
+    QSaveFile file;
+    QByteArray centralDirectory;
+    int entryCount;
+    qint64 offset;
+};
+
+#endif // ZIPWRITER_H
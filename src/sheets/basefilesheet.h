@@ -16,6 +16,7 @@ public:
     virtual bool saveAs();
     bool replace();
     bool explore() const;
+    QString getFilePath() const;
 
 protected:
     void changeEvent(QEvent *event) override;
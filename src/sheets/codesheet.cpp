@@ -12,8 +12,17 @@
 #include <QFileInfo>
 #include <QPushButton>
 #include <QRegularExpression>
+#include <QSaveFile>
 #include <QScrollBar>
-#include <QTextCodec>
+#include <QTextBlock>
+#include <cstring>
+
+namespace
+{
+    // Files larger than this are loaded progressively
+    const qint64 LargeFileThreshold = 8 * 1024 * 1024;
+    const qint64 LargeFileChunkSize = 512 * 1024;
+}
 
 CodeSheet::CodeSheet(const ResourceModelIndex &index, QWidget *parent)
     : BaseFileSheet(index, parent)
@@ -52,8 +61,21 @@ CodeSheet::CodeSheet(const ResourceModelIndex &index, QWidget *parent)
     layout->setMargin(0);
     layout->setSpacing(0);
 
+    chunkTimer.setSingleShot(true);
+    chunkTimer.setInterval(0);
+    connect(&chunkTimer, &QTimer::timeout, this, &CodeSheet::loadNextChunk);
+
     load();
-    connect(editor, &QPlainTextEdit::modificationChanged, this, &CodeSheet::setModified);
+    connect(editor->document(), &QTextDocument::contentsChange, this, [this](int position, int, int charsAdded) {
+        if (large && !loading) {
+            markChunksModified(position, charsAdded);
+        }
+    });
+    connect(editor, &QPlainTextEdit::modificationChanged, this, [this](bool modified) {
+        if (!loading) {
+            setModified(modified);
+        }
+    });
 
     // Initialize actions:
 
@@ -93,6 +115,23 @@ CodeSheet::CodeSheet(const ResourceModelIndex &index, QWidget *parent)
 
 bool CodeSheet::load()
 {
+    const QFileInfo fileInfo(index.path());
+    if (fileInfo.size() >= LargeFileThreshold) {
+        if (large && fileInfo.size() == largeFileSize && fileInfo.lastModified() == largeFileTime) {
+            return true; // Not changed since it was loaded or saved
+        }
+        return loadLargeFile();
+    }
+    if (large) {
+        chunkTimer.stop();
+        loading = false;
+        large = false;
+        chunks.clear();
+        unmapLargeFile();
+        editor->setReadOnly(false);
+        editor->document()->setUndoRedoEnabled(true);
+    }
+
     QFile file(index.path());
     if (file.open(QFile::ReadOnly)) {
         QTextStream stream(&file);
@@ -116,6 +155,9 @@ bool CodeSheet::load()
 
 bool CodeSheet::save(const QString &as)
 {
+    if (large) {
+        return saveLargeFile(as.isEmpty() ? index.path() : as);
+    }
     QFile file(as.isEmpty() ? index.path() : as);
     if (file.open(QFile::WriteOnly)) {
         file.resize(0);
@@ -133,6 +175,202 @@ bool CodeSheet::save(const QString &as)
     return false;
 }
 
+bool CodeSheet::loadLargeFile()
+{
+    chunkTimer.stop();
+    chunks.clear();
+    unmapLargeFile();
+    if (!mapLargeFile(index.path())) {
+        large = false;
+        qWarning() << "Error: Could not open code resource file";
+        return false;
+    }
+    largeFileSize = largeFile.size();
+    largeFileTime = QFileInfo(largeFile).lastModified();
+
+    // Same detection as QTextStream: byte order mark or UTF-8
+    const QByteArray header = QByteArray::fromRawData(largeFileData, static_cast<int>(qMin<qint64>(largeFileSize, 4)));
+    codec = QTextCodec::codecForUtfText(header, QTextCodec::codecForName("UTF-8"));
+    int bomSize = 0;
+    if (codec->mibEnum() == 106) {
+        bomSize = header.startsWith("\xEF\xBB\xBF") ? 3 : 0;
+    } else {
+        bomSize = codec->name().startsWith("UTF-32") ? 4 : 2;
+    }
+    bom = QByteArray(largeFileData, bomSize);
+    decoder.reset(codec->makeDecoder(QTextCodec::IgnoreHeader));
+    loadedBytes = bomSize;
+    lineBreak.clear();
+
+    // The document is read-only until the whole file is loaded:
+    large = true;
+    loading = true;
+    editor->setReadOnly(true);
+    editor->document()->setUndoRedoEnabled(false);
+    editor->clear();
+    loadNextChunk();
+    return true;
+}
+
+void CodeSheet::loadNextChunk()
+{
+    if (!loading) {
+        return;
+    }
+
+    qint64 end = qMin(largeFileSize, loadedBytes + LargeFileChunkSize);
+    const bool utf8 = codec->mibEnum() == 106;
+    if (utf8 && end < largeFileSize) {
+        // Split UTF-8 text on line breaks, so that chunks consist of whole lines
+        const auto lineEnd = static_cast<const char *>(memchr(largeFileData + end, '\n', static_cast<size_t>(largeFileSize - end)));
+        end = lineEnd ? (lineEnd - largeFileData + 1) : largeFileSize;
+    }
+    const QString text = decoder->toUnicode(largeFileData + loadedBytes, static_cast<int>(end - loadedBytes));
+    if (lineBreak.isEmpty()) {
+        const int lineFeed = text.indexOf('\n');
+        if (lineFeed != -1) {
+            lineBreak = (lineFeed > 0 && text.at(lineFeed - 1) == '\r') ? "\r\n" : "\n";
+        }
+    }
+
+    QTextCursor start(editor->document());
+    start.movePosition(QTextCursor::End);
+    start.setKeepPositionOnInsert(true);
+    QTextCursor cursor(start);
+    cursor.setKeepPositionOnInsert(false);
+    cursor.insertText(text);
+
+    Chunk chunk;
+    chunk.start = start;
+    chunk.length = cursor.position() - start.position();
+    chunk.offset = utf8 ? loadedBytes : -1;
+    chunk.size = end - loadedBytes;
+    chunks.append(chunk);
+    loadedBytes = end;
+
+    if (loadedBytes < largeFileSize) {
+        chunkTimer.start();
+    } else {
+        finishLoading();
+    }
+}
+
+void CodeSheet::finishLoading()
+{
+    if (lineBreak.isEmpty()) {
+        lineBreak = "\n";
+    }
+    unmapLargeFile();
+    loading = false;
+    editor->document()->setUndoRedoEnabled(true);
+    editor->document()->setModified(false);
+    editor->setReadOnly(false);
+    setModified(false);
+}
+
+bool CodeSheet::saveLargeFile(const QString &path)
+{
+    // Saving requires the whole file to be loaded:
+    while (loading) {
+        loadNextChunk();
+    }
+
+    // Unmodified chunks are copied from the file as it was loaded or saved, unless it has been changed since:
+    const QFileInfo fileInfo(index.path());
+    const bool unchanged = fileInfo.size() == largeFileSize && fileInfo.lastModified() == largeFileTime
+        && mapLargeFile(index.path()) && largeFile.size() == largeFileSize;
+
+    QSaveFile file(path);
+    if (!file.open(QSaveFile::WriteOnly)) {
+        unmapLargeFile();
+        qWarning() << "Error: Could not save code resource file";
+        return false;
+    }
+
+    QScopedPointer<QTextEncoder> encoder(codec->makeEncoder(QTextCodec::IgnoreHeader));
+    file.write(bom);
+    QVector<Chunk> savedChunks;
+    savedChunks.reserve(chunks.size());
+    const int documentEnd = editor->document()->characterCount() - 1;
+    for (int i = 0; i < chunks.size(); ++i) {
+        const Chunk &chunk = chunks.at(i);
+        const int start = chunk.start.position();
+        const int end = (i + 1 < chunks.size()) ? chunks.at(i + 1).start.position() : documentEnd;
+        Chunk savedChunk = chunk;
+        savedChunk.offset = chunk.offset < 0 ? -1 : file.pos();
+        savedChunk.length = end - start;
+        savedChunk.modified = false;
+        if (!unchanged || chunk.modified || chunk.offset < 0 || end - start != chunk.length) {
+            // Only the modified chunks are encoded again
+            QTextCursor cursor(editor->document());
+            cursor.setPosition(start);
+            cursor.setPosition(end, QTextCursor::KeepAnchor);
+            const QString text = cursor.selectedText().replace(QChar::ParagraphSeparator, lineBreak);
+            savedChunk.size = file.write(encoder->fromUnicode(text));
+        } else {
+            savedChunk.size = file.write(largeFileData + chunk.offset, chunk.size);
+        }
+        savedChunks.append(savedChunk);
+    }
+
+    // The mapped file must be released before it is replaced:
+    unmapLargeFile();
+    if (!file.commit()) {
+        qWarning() << "Error: Could not save code resource file";
+        return false;
+    }
+    if (path != index.path()) {
+        return true;
+    }
+    const QFileInfo savedInfo(path);
+    largeFileSize = savedInfo.size();
+    largeFileTime = savedInfo.lastModified();
+    chunks = savedChunks;
+    editor->document()->setModified(false);
+    setModified(false);
+    emit saved();
+    return true;
+}
+
+bool CodeSheet::mapLargeFile(const QString &path)
+{
+    largeFile.setFileName(path);
+    if (!largeFile.open(QFile::ReadOnly)) {
+        return false;
+    }
+    largeFileData = reinterpret_cast<const char *>(largeFile.map(0, largeFile.size()));
+    if (!largeFileData) {
+        largeFile.close();
+        return false;
+    }
+    return true;
+}
+
+void CodeSheet::unmapLargeFile()
+{
+    if (largeFileData) {
+        largeFile.unmap(reinterpret_cast<uchar *>(const_cast<char *>(largeFileData)));
+        largeFileData = nullptr;
+    }
+    largeFile.close();
+}
+
+void CodeSheet::markChunksModified(int position, int length)
+{
+    // Chunks merely touching the change are marked as well, e.g. the ones collapsed by a removal:
+    const int changeEnd = position + length;
+    for (int i = 0; i < chunks.size(); ++i) {
+        const int start = chunks.at(i).start.position();
+        if (start > changeEnd) {
+            break;
+        }
+        const int end = (i + 1 < chunks.size()) ? chunks.at(i + 1).start.position() : editor->document()->characterCount() - 1;
+        if (end >= position) {
+            chunks[i].modified = true;
+        }
+    }
+}
+
 void CodeSheet::setTextCursor(int lineNumber, int columnNumber, int selectionLength)
 {
     auto cursor = editor->textCursor();
@@ -145,6 +383,23 @@ void CodeSheet::setTextCursor(int lineNumber, int columnNumber, int selectionLen
     editor->setTextCursor(cursor);
 }
 
+void CodeSheet::setSmaliIndex(QSharedPointer<SmaliIndex> index)
+{
+    editor->setSmaliIndex(index);
+    connect(editor, &CodeEditor::editRequested, this, &CodeSheet::editRequested);
+    connect(editor, &CodeEditor::usagesFound, this, &CodeSheet::usagesFound);
+
+    addActionSeparator();
+
+    auto actionGoToDefinition = app->actions.getGoToDefinition(this);
+    addAction(actionGoToDefinition);
+    connect(actionGoToDefinition, &QAction::triggered, editor, &CodeEditor::goToDefinition);
+
+    auto actionFindUsages = app->actions.getFindUsages(this);
+    addAction(actionFindUsages);
+    connect(actionFindUsages, &QAction::triggered, editor, &CodeEditor::findUsages);
+}
+
 void CodeSheet::changeEvent(QEvent *event)
 {
     if (event->type() == QEvent::LanguageChange) {
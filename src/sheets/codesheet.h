@@ -2,10 +2,18 @@
 #define CODESHEET_H
 
 #include "sheets/basefilesheet.h"
+#include "base/searchresult.h"
+#include <QDateTime>
+#include <QFile>
+#include <QSharedPointer>
+#include <QTextCodec>
+#include <QTextCursor>
+#include <QTimer>
 
 class CodeEditor;
 class CodeSearchBar;
 class QPushButton;
+class SmaliIndex;
 
 class CodeSheet : public BaseFileSheet
 {
@@ -18,12 +26,35 @@ public:
     bool save(const QString &as = QString()) override;
 
     void setTextCursor(int lineNumber, int columnNumber, int selectionLength = 0);
+    void setSmaliIndex(QSharedPointer<SmaliIndex> index);
+
+signals:
+    void editRequested(const QString &filePath, int lineNumber, int columnNumber, int selectionLength);
+    void usagesFound(const QString &symbol, const QList<SearchResult> &results);
 
 protected:
     void changeEvent(QEvent *event) override;
     void keyPressEvent(QKeyEvent *event) override;
 
 private:
+    // Part of a large file loaded at once. Unmodified chunks are saved as is.
+    struct Chunk
+    {
+        QTextCursor start;
+        int length;     // In the document
+        qint64 offset;  // In the file, -1 if the chunk can't be copied as is
+        qint64 size;
+        bool modified = false; // Edited since it was loaded or saved, undo included
+    };
+
+    bool loadLargeFile();
+    void loadNextChunk();
+    void finishLoading();
+    bool saveLargeFile(const QString &path);
+    bool mapLargeFile(const QString &path);
+    void unmapLargeFile();
+    void markChunksModified(int position, int length);
+
     void findSelectedText();
     void replaceSelectedText();
     void checkFormatSupport();
@@ -36,6 +67,20 @@ private:
     CodeEditor *editor;
     CodeSearchBar *searchBar;
     QPushButton *btnDownloadDefinitions;
+
+    // Large files are only mapped while being loaded or saved:
+    QFile largeFile;
+    const char *largeFileData = nullptr;
+    qint64 largeFileSize = 0;
+    QDateTime largeFileTime;
+    QScopedPointer<QTextDecoder> decoder;
+    QVector<Chunk> chunks;
+    QTimer chunkTimer;
+    QString lineBreak;
+    QByteArray bom;
+    qint64 loadedBytes = 0;
+    bool loading = false;
+    bool large = false;
 };
 
 #endif // CODESHEET_H
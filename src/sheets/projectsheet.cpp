@@ -1,8 +1,8 @@
 #include "sheets/projectsheet.h"
-#include "windows/dialogs.h"
 #include "apk/package.h"
 #include "base/utils.h"
 #include <QEvent>
+#include <QLabel>
 #include <QPushButton>
 
 ProjectSheet::ProjectSheet(Package *package, QWidget *parent) : BaseActionSheet(parent)
@@ -10,15 +10,19 @@ ProjectSheet::ProjectSheet(Package *package, QWidget *parent) : BaseActionSheet(
     setSheetIcon(QIcon::fromTheme("tool-projectmanager"));
     this->package = package;
 
+    summary = new QLabel(this);
+    summary->setAlignment(Qt::AlignCenter);
+    summary->setTextInteractionFlags(Qt::TextSelectableByMouse);
+    addWidget(summary);
+
     btnEditTitle = addButton();
     connect(btnEditTitle, &QPushButton::clicked, this, [this]() {
         emit titleEditorRequested();
     });
 
     btnEditIcon = addButton();
-    connect(btnEditIcon, &QPushButton::clicked, package, [package, this]() {
-        const QString iconSource(Dialogs::getOpenImageFilename(this));
-        package->setApplicationIcon(iconSource, this);
+    connect(btnEditIcon, &QPushButton::clicked, this, [this]() {
+        emit iconEditorRequested();
     });
 
     btnExplore = addButton();
@@ -53,6 +57,7 @@ void ProjectSheet::changeEvent(QEvent *event)
 void ProjectSheet::onPackageUpdated()
 {
     setHeading(package->getTitle());
+    updateSummary();
     btnEditTitle->setEnabled(package->getState().canEdit());
     btnEditIcon->setEnabled(package->getState().canEdit());
     btnExplore->setEnabled(package->getState().canExplore());
@@ -60,6 +65,26 @@ void ProjectSheet::onPackageUpdated()
     btnInstall->setEnabled(package->getState().canInstall());
 }
 
+void ProjectSheet::updateSummary()
+{
+    QStringList lines;
+    const QString label = package->getApplicationLabel();
+    if (!label.isEmpty()) {
+        lines.append(label);
+    }
+    const QString packageName = package->getPackageName();
+    if (!packageName.isEmpty()) {
+        lines.append(packageName);
+    }
+    const QString versionName = package->getVersionName();
+    if (!versionName.isEmpty()) {
+        //: "%1" will be replaced with a version name (e.g. "1.2.0"), "%2" with a version code (e.g. "120").
+        lines.append(tr("Version %1 (%2)").arg(versionName).arg(package->getVersionCode()));
+    }
+    summary->setText(lines.join('\n'));
+    summary->setVisible(!lines.isEmpty());
+}
+
 void ProjectSheet::retranslate()
 {
     //: This string refers to a single project (as in "Manager of a project").
@@ -70,4 +95,5 @@ void ProjectSheet::retranslate()
     btnExplore->setText(tr("Open Contents"));
     btnSave->setText(tr("Save APK"));
     btnInstall->setText(tr("Install APK"));
+    updateSummary();
 }
@@ -4,6 +4,7 @@
 #include "sheets/baseactionsheet.h"
 
 class Package;
+class QLabel;
 
 class ProjectSheet : public BaseActionSheet
 {
@@ -16,16 +17,19 @@ signals:
     void apkSaveRequested();
     void apkInstallRequested();
     void titleEditorRequested();
+    void iconEditorRequested();
 
 protected:
     void changeEvent(QEvent *event) override;
 
 private:
     void onPackageUpdated();
+    void updateSummary();
     void retranslate();
 
     Package *package;
 
+    QLabel *summary;
     QPushButton *btnEditIcon;
     QPushButton *btnEditTitle;
     QPushButton *btnExplore;
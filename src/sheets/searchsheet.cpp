@@ -12,6 +12,7 @@
 #include <QLineEdit>
 #include <QMessageBox>
 #include <QPushButton>
+#include <QSet>
 #include <QToolButton>
 
 SearchSheet::SearchSheet(QWidget *parent) : BaseSheet(parent)
@@ -77,10 +78,17 @@ SearchSheet::SearchSheet(QWidget *parent) : BaseSheet(parent)
     connect(replaceStopButton, &QPushButton::clicked, this, [this]() {
         searchModel->cancelReplace();
     });
+    replaceUndoButton = new QPushButton(this);
+    replaceUndoButton->setFocusPolicy(Qt::TabFocus);
+    connect(replaceUndoButton, &QPushButton::clicked, this, [this]() {
+        updateState(StateReplacing);
+        searchModel->undoReplace();
+    });
     auto replaceLayout = new QHBoxLayout;
     replaceLayout->addWidget(replaceInput);
     replaceLayout->addWidget(replaceButton);
     replaceLayout->addWidget(replaceStopButton);
+    replaceLayout->addWidget(replaceUndoButton);
 
     auto controlsLayout = new QFormLayout;
     controlsLayout->addRow(searchLabel, searchLayout);
@@ -140,6 +148,21 @@ SearchSheet::SearchSheet(QWidget *parent) : BaseSheet(parent)
         }
     });
 
+    connect(searchModel, &SearchModel::filesChanged, this, &SearchSheet::filesReplaced);
+
+    connect(searchModel, &SearchModel::undoFinished, this, [this](int fileCount, bool success) {
+        updateState(StateIdle);
+        //: "%1" will be replaced with a number of files.
+        statusLabel->setText(tr("Restored %1 file(s)").arg(fileCount));
+        if (!success) {
+            QMessageBox::warning(this, {}, tr("Some files have been changed since the replacement and were not restored."));
+        }
+        // Refresh the results for the restored files:
+        if (!searchInput->text().isEmpty()) {
+            searchModel->search(searchInput->text(), searchPath);
+        }
+    });
+
     auto layout = new QVBoxLayout(this);
     layout->addLayout(controlsLayout);
     layout->addWidget(resultsView);
@@ -162,6 +185,33 @@ void SearchSheet::setSearchPath(const QString &path)
     searchModel->setRootPath(searchPath);
 }
 
+void SearchSheet::setSearchIndex(QSharedPointer<SearchIndex> index)
+{
+    searchModel->setSearchIndex(index);
+}
+
+void SearchSheet::setFileCatalog(QSharedPointer<FileCatalog> catalog)
+{
+    searchModel->setFileCatalog(catalog);
+}
+
+void SearchSheet::setResults(const QString &query, const QList<SearchResult> &results)
+{
+    // Matches of the running search must not mix into the results:
+    searchModel->discardSearch();
+    searchModel->clear();
+    searchInput->setText(query);
+    searchModel->add(results);
+    updateState(StateIdle);
+
+    QSet<QString> files;
+    for (const auto &result : results) {
+        files.insert(result.filePath);
+    }
+    statusLabel->show();
+    updateSearchStats(results.size(), files.size());
+}
+
 void SearchSheet::changeEvent(QEvent *event)
 {
     if (event->type() == QEvent::LanguageChange) {
@@ -187,6 +237,7 @@ void SearchSheet::updateState(State state)
     replaceButton->setVisible(state != StateReplacing);
     replaceStopButton->setVisible(state == StateReplacing);
     replaceStopButton->setEnabled(state == StateReplacing);
+    replaceUndoButton->setEnabled(state == StateIdle && searchModel->canUndoReplace());
 
     resultsView->setEnabled(state != StateReplacing);
 }
@@ -223,4 +274,5 @@ void SearchSheet::retranslate()
 
     searchStopButton->setText(tr("Stop"));
     replaceStopButton->setText(tr("Stop"));
+    replaceUndoButton->setText(tr("Undo"));
 }
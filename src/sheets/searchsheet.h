@@ -2,11 +2,15 @@
 #define SEARCHSHEET_H
 
 #include "sheets/basesheet.h"
+#include "base/searchresult.h"
+#include <QSharedPointer>
 
 class ElidedLabel;
+class FileCatalog;
 class QLabel;
 class QLineEdit;
 class QPushButton;
+class SearchIndex;
 class SearchModel;
 class SearchResultView;
 
@@ -19,9 +23,13 @@ public:
 
     bool finalize() override;
     void setSearchPath(const QString &path);
+    void setSearchIndex(QSharedPointer<SearchIndex> index);
+    void setFileCatalog(QSharedPointer<FileCatalog> catalog);
+    void setResults(const QString &query, const QList<SearchResult> &results);
 
 signals:
     void editRequested(const QString &filePath, int lineNumber, int columnNumber, int selectionLength);
+    void filesReplaced(const QStringList &paths);
 
 protected:
     void changeEvent(QEvent *event) override;
@@ -50,6 +58,7 @@ private:
     QLineEdit *replaceInput;
     QPushButton *replaceButton;
     QPushButton *replaceStopButton;
+    QPushButton *replaceUndoButton;
     SearchResultView *resultsView;
     ElidedLabel *statusLabel;
 };
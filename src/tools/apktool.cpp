@@ -54,7 +54,9 @@ void Apktool::Build::run()
     QStringList arguments;
     arguments << "build" << source;
     arguments << "--output" << destination;
-    arguments << "--force";
+    if (!incremental) {
+        arguments << "--force";
+    }
     if (!frameworks.isEmpty()) {
         arguments << "--frame-path" << frameworks;
     }
@@ -40,13 +40,15 @@ namespace Apktool
     {
     public:
         Build(const QString &source, const QString &destination,
-              const QString &frameworks, bool aapt2, bool debuggable, QObject *parent = nullptr)
+              const QString &frameworks, bool aapt2, bool debuggable,
+              bool incremental = false, QObject *parent = nullptr)
             : Command(parent)
             , source(source)
             , destination(destination)
             , frameworks(frameworks)
             , aapt2(aapt2)
             , debuggable(debuggable)
+            , incremental(incremental)
         {}
 
         void run() override;
@@ -58,6 +60,7 @@ namespace Apktool
         const QString frameworks;
         const bool aapt2;
         const bool debuggable;
+        const bool incremental;
         QString resultOutput;
     };
 
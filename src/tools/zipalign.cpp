@@ -1,34 +1,33 @@
 #include "tools/zipalign.h"
-#include "base/application.h"
-#include "base/process.h"
-#include "base/settings.h"
-#include "base/utils.h"
-#include <QFile>
+#include "base/zipwriter.h"
+#include <QFutureWatcher>
+#include <QtConcurrent/QtConcurrent>
+#include <QDebug>
+
+namespace
+{
+    const int DefaultAlignment = 4;
+    const int PageAlignment = 4096;
+}
 
 void Zipalign::Align::run()
 {
     emit started();
 
-    const QString tempApk = apk + ".aligned";
-
-    QStringList arguments;
-    arguments << "-p";
-    arguments << "-f";
-    arguments << "4";
-    arguments << apk;
-    arguments << tempApk;
-
-    auto process = new Process(this);
-    connect(process, &Process::finished, this, [=](bool success, const QString &output) {
-        if (success) {
-            QFile::remove(apk);
-            QFile::rename(tempApk, apk);
+    const QString apk = this->apk;
+    auto future = QtConcurrent::run([apk]() -> bool {
+        // Already aligned archives are left untouched:
+        return verify(apk) || align(apk);
+    });
+    auto watcher = new QFutureWatcher<bool>(this);
+    connect(watcher, &QFutureWatcher<bool>::finished, this, [=]() {
+        const bool success = watcher->result();
+        if (!success) {
+            resultOutput = QString("Could not align \"%1\"").arg(apk);
         }
-        resultOutput = output;
         emit finished(success);
-        process->deleteLater();
     });
-    process->run(getPath(), arguments);
+    watcher->setFuture(future);
 }
 
 const QString &Zipalign::Align::output() const
@@ -36,13 +35,53 @@ const QString &Zipalign::Align::output() const
     return resultOutput;
 }
 
-QString Zipalign::getPath()
+int Zipalign::getAlignment(const ZipArchive::Entry &entry)
 {
-    const QString path = Utils::toAbsolutePath(app->settings->getZipalignPath());
-    return !path.isEmpty() ? path : getDefaultPath();
+    if (entry.method != ZipArchive::Stored || entry.isDirectory()) {
+        return 0;
+    }
+    return entry.name.endsWith(".so") ? PageAlignment : DefaultAlignment;
 }
 
-QString Zipalign::getDefaultPath()
+bool Zipalign::align(const QString &apk)
 {
-    return Utils::getBinaryPath("zipalign");
+    ZipArchive archive(apk);
+    if (!archive.open()) {
+        return false;
+    }
+    ZipWriter writer(apk);
+    if (!writer.open()) {
+        return false;
+    }
+    for (const ZipArchive::Entry &entry : archive.getEntries()) {
+        if (!writer.copyEntry(archive, entry, getAlignment(entry))) {
+            return false;
+        }
+    }
+    // The archive is replaced in place, so it has to be released first:
+    archive.close();
+    return writer.commit();
+}
+
+bool Zipalign::verify(const QString &apk)
+{
+    ZipArchive archive(apk);
+    return archive.open() && isAligned(archive);
+}
+
+bool Zipalign::isAligned(const ZipArchive &archive)
+{
+    // Data offsets are resolved from the central directory, nothing is read beyond the local headers:
+    for (const ZipArchive::Entry &entry : archive.getEntries()) {
+        const int alignment = getAlignment(entry);
+        if (!alignment) {
+            continue;
+        }
+        const qint64 offset = archive.getDataOffset(entry);
+        if (offset == -1 || offset % alignment) {
+            qDebug() << "Unaligned ZIP entry" << entry.name;
+            return false;
+        }
+    }
+    return true;
 }
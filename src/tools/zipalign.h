@@ -2,6 +2,7 @@
 #define ZIPALIGN_H
 
 #include "base/command.h"
+#include "base/ziparchive.h"
 
 namespace Zipalign
 {
@@ -17,8 +18,12 @@ namespace Zipalign
         QString resultOutput;
     };
 
-    QString getPath();
-    QString getDefaultPath();
+    // Uncompressed entries are aligned to 4 bytes, shared libraries to the memory page size
+    int getAlignment(const ZipArchive::Entry &entry);
+
+    bool align(const QString &apk);
+    bool verify(const QString &apk);
+    bool isAligned(const ZipArchive &archive);
 }
 
 #endif // ZIPALIGN_H
@@ -1,16 +1,31 @@
 #include "widgets/codeeditor.h"
+#include "widgets/codehighlighter.h"
 #include "widgets/codesidebar.h"
+#include "apk/smaliindex.h"
 #include "base/application.h"
 #include "base/settings.h"
 #include "base/utils.h"
 #include <KSyntaxHighlighting/Definition>
-#include <KSyntaxHighlighting/SyntaxHighlighter>
 #include <QRegularExpression>
+#include <QToolTip>
+#include <QtConcurrent/QtConcurrent>
+
+namespace
+{
+    // Documents larger than this (in characters) are searched in the background
+    const int AsyncSearchThreshold = 256 * 1024;
+    // Background searches are restarted once the document stops changing for this long (in ms)
+    const int SearchRestartDelay = 250;
+    // Edits spanning more blocks than this trigger a full search
+    const int MaxIncrementalBlocks = 4096;
+    // Blocks highlighted above and below the viewport
+    const int HighlightMargin = 50;
+}
 
 CodeEditor::CodeEditor(QWidget *parent)
     : QPlainTextEdit(parent)
     , sidebar(new CodeSideBar(this))
-    , highlighter(new KSyntaxHighlighting::SyntaxHighlighter(document()))
+    , highlighter(new CodeHighlighter(document()))
 {
     const auto defaultTheme = app->highlightingRepository.defaultTheme(Utils::isDarkTheme()
         ? KSyntaxHighlighting::Repository::DarkTheme
@@ -35,7 +50,37 @@ CodeEditor::CodeEditor(QWidget *parent)
         : QTextOption::NoWrap);
 
     connect(this, &CodeEditor::cursorPositionChanged, this, &CodeEditor::highlightCurrentLine);
-    connect(this, &CodeEditor::textChanged, this, &CodeEditor::highlightSearchResults);
+    connect(document(), &QTextDocument::contentsChange, this, &CodeEditor::updateSearchResults);
+
+    // Coalesce scrolling, resizing and repainting into a single viewport update:
+    viewportTimer.setSingleShot(true);
+    viewportTimer.setInterval(0);
+    connect(&viewportTimer, &QTimer::timeout, this, &CodeEditor::updateViewport);
+    connect(this, &CodeEditor::updateRequest, &viewportTimer, [this]() {
+        viewportTimer.start();
+    });
+
+    searchRestartTimer.setSingleShot(true);
+    searchRestartTimer.setInterval(SearchRestartDelay);
+    connect(&searchRestartTimer, &QTimer::timeout, this, &CodeEditor::highlightSearchResults);
+
+    connect(&searchWatcher, &QFutureWatcher<SearchMatches>::finished, this, [this]() {
+        if (searchMatchesReady) {
+            return; // Superseded by a synchronous search
+        }
+        if (searchRestartPending) {
+            searchRestartPending = false;
+            highlightSearchResults();
+            return;
+        }
+        const SearchMatches matches = searchWatcher.result();
+        if (matches.size() != document()->blockCount()) {
+            // The document has changed since the search has started
+            highlightSearchResults();
+            return;
+        }
+        setSearchMatches(matches);
+    });
 }
 
 int CodeEditor::getTabWidth() const
@@ -188,8 +233,7 @@ void CodeEditor::setSearchByRegex(bool enabled)
 
 void CodeEditor::nextSearchQuery(bool skipCurrent)
 {
-    const int totalResults = searchResultCursors.count();
-    if (!totalResults) {
+    if (searchMatchesReady && !searchMatchCount) {
         emit searchFinished(0, 0);
         return;
     }
@@ -204,16 +248,15 @@ void CodeEditor::nextSearchQuery(bool skipCurrent)
         // Reached the end of the document, start from the beginning
         resultCursor = find(0);
     }
-    setTextCursor(resultCursor);
-
-    const int currentResult = searchResultCursors.indexOf(resultCursor) + 1;
-    emit searchFinished(totalResults, currentResult);
+    if (!resultCursor.isNull()) {
+        setTextCursor(resultCursor);
+    }
+    emitSearchResults();
 }
 
 void CodeEditor::prevSearchQuery()
 {
-    const int totalResults = searchResultCursors.count();
-    if (!totalResults) {
+    if (searchMatchesReady && !searchMatchCount) {
         emit searchFinished(0, 0);
         return;
     }
@@ -223,10 +266,10 @@ void CodeEditor::prevSearchQuery()
         // Reached the beginning of the document, start from the end
         resultCursor = find(document()->characterCount(), true);
     }
-    setTextCursor(resultCursor);
-
-    const int currentResult = searchResultCursors.indexOf(resultCursor) + 1;
-    emit searchFinished(totalResults, currentResult);
+    if (!resultCursor.isNull()) {
+        setTextCursor(resultCursor);
+    }
+    emitSearchResults();
 }
 
 void CodeEditor::setTheme(const KSyntaxHighlighting::Theme &theme)
@@ -236,13 +279,11 @@ void CodeEditor::setTheme(const KSyntaxHighlighting::Theme &theme)
     newPalette.setColor(QPalette::Highlight, theme.editorColor(KSyntaxHighlighting::Theme::TextSelection));
     setPalette(newPalette);
     highlighter->setTheme(theme);
-    highlighter->rehighlight();
 }
 
 void CodeEditor::setDefinition(const KSyntaxHighlighting::Definition &definition)
 {
     highlighter->setDefinition(definition);
-    highlighter->rehighlight();
     setTabStopDistance(getTabWidth() * QFontMetrics(font()).horizontalAdvance(' '));
 }
 
@@ -263,6 +304,59 @@ void CodeEditor::setWordWrap(bool enabled)
     app->settings->setWordWrap(enabled);
 }
 
+void CodeEditor::setSmaliIndex(QSharedPointer<SmaliIndex> index)
+{
+    smaliIndex = index;
+}
+
+void CodeEditor::goToDefinition()
+{
+    const QString symbol = getSymbolUnderCursor();
+    if (symbol.isEmpty()) {
+        return;
+    }
+    // Matched lines are read from the files in the background:
+    const QSharedPointer<SmaliIndex> index = smaliIndex;
+    auto watcher = new QFutureWatcher<QList<SearchResult>>(this);
+    connect(watcher, &QFutureWatcher<QList<SearchResult>>::finished, this, [=]() {
+        const auto definitions = watcher->result();
+        watcher->deleteLater();
+        if (definitions.size() == 1) {
+            const auto &definition = definitions.first();
+            emit editRequested(definition.filePath, definition.lineNumber, definition.matchStart, definition.matchLength);
+        } else if (!definitions.isEmpty()) {
+            emit usagesFound(symbol, definitions);
+        } else {
+            showToolTip(tr("No definition found"));
+        }
+    });
+    watcher->setFuture(QtConcurrent::run([index, symbol]() {
+        return index->findDefinitions(symbol);
+    }));
+}
+
+void CodeEditor::findUsages()
+{
+    const QString symbol = getSymbolUnderCursor();
+    if (symbol.isEmpty()) {
+        return;
+    }
+    const QSharedPointer<SmaliIndex> index = smaliIndex;
+    auto watcher = new QFutureWatcher<QList<SearchResult>>(this);
+    connect(watcher, &QFutureWatcher<QList<SearchResult>>::finished, this, [=]() {
+        const auto usages = watcher->result();
+        watcher->deleteLater();
+        if (!usages.isEmpty()) {
+            emit usagesFound(symbol, usages);
+        } else {
+            showToolTip(tr("No usages found"));
+        }
+    });
+    watcher->setFuture(QtConcurrent::run([index, symbol]() {
+        return index->findUsages(symbol);
+    }));
+}
+
 void CodeEditor::resizeEvent(QResizeEvent *event)
 {
     QPlainTextEdit::resizeEvent(event);
@@ -314,6 +408,39 @@ void CodeEditor::keyPressEvent(QKeyEvent *event)
     QPlainTextEdit::keyPressEvent(event);
 }
 
+void CodeEditor::mousePressEvent(QMouseEvent *event)
+{
+    // Ctrl+Click to go to the definition:
+    if (smaliIndex && event->button() == Qt::LeftButton && event->modifiers() == Qt::ControlModifier) {
+        setTextCursor(cursorForPosition(event->pos()));
+        goToDefinition();
+        return;
+    }
+    QPlainTextEdit::mousePressEvent(event);
+}
+
+QString CodeEditor::getSymbolUnderCursor() const
+{
+    if (!smaliIndex) {
+        return QString();
+    }
+    // Class name is declared at the beginning of the file:
+    QString className;
+    for (auto block = document()->firstBlock(); block.isValid() && block.blockNumber() < 10; block = block.next()) {
+        className = SmaliIndex::getClassName(block.text());
+        if (!className.isEmpty()) {
+            break;
+        }
+    }
+    const auto cursor = textCursor();
+    return SmaliIndex::getSymbol(cursor.block().text(), cursor.positionInBlock(), className);
+}
+
+void CodeEditor::showToolTip(const QString &text)
+{
+    QToolTip::showText(viewport()->mapToGlobal(cursorRect().bottomLeft()), text, this);
+}
+
 QTextCursor CodeEditor::find(int from, bool backward)
 {
     QTextDocument::FindFlags options;
@@ -347,19 +474,220 @@ void CodeEditor::highlightCurrentLine()
 
 void CodeEditor::highlightSearchResults()
 {
-    searchResultCursors.clear();
+    const auto caseSensitivity = searchCaseSensitive ? Qt::CaseSensitive : Qt::CaseInsensitive;
+    searchRegex = (searchByRegex && !searchQuery.isEmpty())
+        ? QRegularExpression(searchQuery, searchCaseSensitive
+            ? QRegularExpression::NoPatternOption
+            : QRegularExpression::CaseInsensitiveOption)
+        : QRegularExpression();
+
+    searchRestartTimer.stop();
+    if (searchQuery.isEmpty()) {
+        searchRestartPending = false;
+        setSearchMatches(SearchMatches());
+        return;
+    }
+
+    if (document()->characterCount() - 1 < AsyncSearchThreshold) {
+        searchRestartPending = false;
+        setSearchMatches(matchText(document()->toPlainText(), searchQuery, searchRegex, caseSensitivity));
+    } else {
+        // Until the search is finished, visible matches are computed on the fly
+        searchMatchesReady = false;
+        searchHighlightsOutdated = true;
+        viewportTimer.start();
+        if (searchWatcher.isRunning()) {
+            // Only the latest search is run, once the current one is finished:
+            searchRestartPending = true;
+            return;
+        }
+        const QString text = document()->toPlainText();
+        searchWatcher.setFuture(QtConcurrent::run(&CodeEditor::matchText, text, searchQuery, searchRegex, caseSensitivity));
+    }
+}
+
+void CodeEditor::updateSearchResults(int position, int charsRemoved, int charsAdded)
+{
+    Q_UNUSED(charsRemoved)
+    if (searchQuery.isEmpty()) {
+        return;
+    }
+    if (!searchMatchesReady) {
+        // Restart the background search over the new text, e.g. a large file being loaded chunk by chunk
+        searchRestartTimer.start();
+        return;
+    }
+
+    auto firstBlock = document()->findBlock(position);
+    auto lastBlock = document()->findBlock(position + charsAdded);
+    if (!lastBlock.isValid()) {
+        lastBlock = document()->lastBlock();
+    }
+    const int first = firstBlock.blockNumber();
+    const int last = lastBlock.blockNumber();
+    const int oldLast = last - (document()->blockCount() - searchMatches.size());
+    if (first < 0 || oldLast >= searchMatches.size() || last - first > MaxIncrementalBlocks) {
+        highlightSearchResults();
+        return;
+    }
+
+    // Replace the matches of the changed blocks only:
+    for (int i = first; i <= oldLast; ++i) {
+        searchMatchCount -= searchMatches.at(i).size();
+    }
+    searchMatches.remove(first, oldLast - first + 1);
+    searchMatches.insert(first, last - first + 1, QVector<SearchMatch>());
+    for (auto block = firstBlock; block.isValid() && block.blockNumber() <= last; block = block.next()) {
+        const auto matches = getBlockMatches(block);
+        searchMatchCount += matches.size();
+        searchMatches[block.blockNumber()] = matches;
+    }
+
+    searchHighlightsOutdated = true;
+    viewportTimer.start();
+    emitSearchResults();
+}
+
+void CodeEditor::updateViewport()
+{
+    auto block = firstVisibleBlock();
+    const int first = qMax(0, block.blockNumber());
+    int last = first;
+    int top = blockBoundingGeometry(block).translated(contentOffset()).top();
+    while (block.isValid() && top <= viewport()->height()) {
+        last = block.blockNumber();
+        top += blockBoundingRect(block).height();
+        block = block.next();
+    }
+    highlighter->setVisibleBlocks(first, last);
+    updateVisibleSearchResults(first, last);
+}
+
+void CodeEditor::updateVisibleSearchResults(int firstBlock, int lastBlock)
+{
+    if (searchQuery.isEmpty() && highlightedFirstBlock == -1) {
+        return;
+    }
+
+    int first = -1;
+    int last = -1;
+    if (!searchQuery.isEmpty()) {
+        first = qMax(0, firstBlock - HighlightMargin);
+        last = qMin(document()->blockCount() - 1, lastBlock + HighlightMargin);
+    }
+    if (!searchHighlightsOutdated && first == highlightedFirstBlock && last == highlightedLastBlock) {
+        return;
+    }
+    searchHighlightsOutdated = false;
+    highlightedFirstBlock = first;
+    highlightedLastBlock = last;
+
     QList<QTextEdit::ExtraSelection> resultHighlights;
-    auto resultCursor = find();
-    while (!resultCursor.isNull() && resultCursor.hasSelection()) {
-        searchResultCursors << resultCursor;
-        QTextEdit::ExtraSelection resultHighlight;
-        resultHighlight.format.setForeground(QColor(getTextColor(KSyntaxHighlighting::Theme::Normal)));
-        resultHighlight.format.setBackground(QColor(getEditorColor(KSyntaxHighlighting::Theme::SearchHighlight)));
-        resultHighlight.cursor = resultCursor;
-        resultHighlights << resultHighlight;
-        resultCursor = find(resultCursor);
+    if (first != -1) {
+        QTextCharFormat format;
+        format.setForeground(QColor(getTextColor(KSyntaxHighlighting::Theme::Normal)));
+        format.setBackground(QColor(getEditorColor(KSyntaxHighlighting::Theme::SearchHighlight)));
+        for (auto block = document()->findBlockByNumber(first); block.isValid() && block.blockNumber() <= last; block = block.next()) {
+            const auto matches = searchMatchesReady ? searchMatches.value(block.blockNumber()) : getBlockMatches(block);
+            for (const auto &match : matches) {
+                QTextEdit::ExtraSelection resultHighlight;
+                resultHighlight.format = format;
+                resultHighlight.cursor = QTextCursor(block);
+                resultHighlight.cursor.setPosition(block.position() + match.start);
+                resultHighlight.cursor.setPosition(block.position() + match.start + match.length, QTextCursor::KeepAnchor);
+                resultHighlights << resultHighlight;
+            }
+        }
     }
     setExtraSelectionGroup(ExtraSelectionGroup::SearchResultSelection, resultHighlights);
-    const int totalResults = searchResultCursors.count();
-    emit searchFinished(totalResults);
+}
+
+void CodeEditor::setSearchMatches(const SearchMatches &matches)
+{
+    searchMatches = matches;
+    searchMatchCount = 0;
+    for (const auto &blockMatches : matches) {
+        searchMatchCount += blockMatches.size();
+    }
+    searchMatchesReady = true;
+    searchHighlightsOutdated = true;
+    updateViewport();
+    emitSearchResults();
+}
+
+void CodeEditor::emitSearchResults()
+{
+    if (searchMatchesReady) {
+        emit searchFinished(searchMatchCount, getSearchResultNumber(textCursor()));
+    }
+}
+
+int CodeEditor::getSearchResultNumber(const QTextCursor &cursor) const
+{
+    if (!cursor.hasSelection()) {
+        return 0;
+    }
+    const auto block = document()->findBlock(cursor.selectionStart());
+    const int blockNumber = block.blockNumber();
+    if (blockNumber < 0 || blockNumber >= searchMatches.size()) {
+        return 0;
+    }
+    int number = 0;
+    for (int i = 0; i < blockNumber; ++i) {
+        number += searchMatches.at(i).size();
+    }
+    const int start = cursor.selectionStart() - block.position();
+    const int length = cursor.selectionEnd() - cursor.selectionStart();
+    for (const auto &match : searchMatches.at(blockNumber)) {
+        ++number;
+        if (match.start == start && match.length == length) {
+            return number;
+        }
+    }
+    return 0;
+}
+
+QVector<CodeEditor::SearchMatch> CodeEditor::getBlockMatches(const QTextBlock &block) const
+{
+    const auto caseSensitivity = searchCaseSensitive ? Qt::CaseSensitive : Qt::CaseInsensitive;
+    return matchBlock(block.text(), searchQuery, searchRegex, caseSensitivity);
+}
+
+QVector<CodeEditor::SearchMatch> CodeEditor::matchBlock(const QString &text, const QString &query, const QRegularExpression &regex, Qt::CaseSensitivity cs)
+{
+    QVector<SearchMatch> matches;
+    if (query.isEmpty()) {
+        return matches;
+    }
+    if (regex.pattern().isEmpty()) {
+        int from = 0;
+        while ((from = text.indexOf(query, from, cs)) != -1) {
+            matches.append({from, query.size()});
+            from += query.size();
+        }
+    } else if (regex.isValid()) {
+        auto it = regex.globalMatch(text);
+        while (it.hasNext()) {
+            const auto match = it.next();
+            if (match.capturedLength() > 0) {
+                matches.append({match.capturedStart(), match.capturedLength()});
+            }
+        }
+    }
+    return matches;
+}
+
+CodeEditor::SearchMatches CodeEditor::matchText(const QString &text, const QString &query, const QRegularExpression &regex, Qt::CaseSensitivity cs)
+{
+    SearchMatches matches;
+    int from = 0;
+    forever {
+        const int to = text.indexOf('\n', from);
+        matches.append(matchBlock(text.mid(from, to == -1 ? -1 : to - from), query, regex, cs));
+        if (to == -1) {
+            break;
+        }
+        from = to + 1;
+    }
+    return matches;
 }
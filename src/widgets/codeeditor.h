@@ -1,12 +1,18 @@
 #ifndef CODEEDITOR_H
 #define CODEEDITOR_H
 
+#include "base/searchresult.h"
 #include <KSyntaxHighlighting/Theme>
+#include <QFutureWatcher>
 #include <QPlainTextEdit>
+#include <QRegularExpression>
+#include <QSharedPointer>
+#include <QTimer>
 
+class CodeHighlighter;
 class CodeSideBar;
+class SmaliIndex;
 namespace KSyntaxHighlighting {
-    class SyntaxHighlighter;
     class Definition;
 }
 
@@ -48,27 +54,69 @@ public:
 
     void setWordWrap(bool enabled);
 
+    void setSmaliIndex(QSharedPointer<SmaliIndex> index);
+    void goToDefinition();
+    void findUsages();
+
 signals:
     void searchFinished(int totalResults, int currentResult = 0);
+    void editRequested(const QString &filePath, int lineNumber, int columnNumber, int selectionLength);
+    void usagesFound(const QString &symbol, const QList<SearchResult> &results);
 
 protected:
     void resizeEvent(QResizeEvent *event) override;
     void keyPressEvent(QKeyEvent *event) override;
+    void mousePressEvent(QMouseEvent *event) override;
 
 private:
+    struct SearchMatch
+    {
+        int start;
+        int length;
+    };
+    typedef QVector<QVector<SearchMatch>> SearchMatches; // Per text block
+
+    QString getSymbolUnderCursor() const;
+    void showToolTip(const QString &text);
+
     QTextCursor find(int from = 0, bool backward = false);
     QTextCursor find(const QTextCursor &cursor, bool backward = false);
 
     void highlightCurrentLine();
     void highlightSearchResults();
+    void updateSearchResults(int position, int charsRemoved, int charsAdded);
+    void updateViewport();
+    void updateVisibleSearchResults(int firstBlock, int lastBlock);
+    void setSearchMatches(const SearchMatches &matches);
+    void emitSearchResults();
+    int getSearchResultNumber(const QTextCursor &cursor) const;
+    QVector<SearchMatch> getBlockMatches(const QTextBlock &block) const;
+
+    static QVector<SearchMatch> matchBlock(const QString &text, const QString &query, const QRegularExpression &regex, Qt::CaseSensitivity cs);
+    static SearchMatches matchText(const QString &text, const QString &query, const QRegularExpression &regex, Qt::CaseSensitivity cs);
 
     CodeSideBar *sidebar;
-    KSyntaxHighlighting::SyntaxHighlighter *highlighter;
+    CodeHighlighter *highlighter;
     QMap<ExtraSelectionGroup, QList<QTextEdit::ExtraSelection>> extraSelections;
     QString searchQuery;
     bool searchCaseSensitive = false;
     bool searchByRegex = false;
-    QList<QTextCursor> searchResultCursors;
+    QRegularExpression searchRegex;
+
+    // Matches are kept per block and updated for the edited blocks only.
+    // Highlights are only created for the visible blocks.
+    SearchMatches searchMatches;
+    int searchMatchCount = 0;
+    bool searchMatchesReady = true;
+    bool searchHighlightsOutdated = false;
+    bool searchRestartPending = false;
+    QFutureWatcher<SearchMatches> searchWatcher;
+    QTimer searchRestartTimer;
+    QTimer viewportTimer;
+    int highlightedFirstBlock = -1;
+    int highlightedLastBlock = -1;
+
+    QSharedPointer<SmaliIndex> smaliIndex;
 };
 
 #endif // CODEEDITOR_H
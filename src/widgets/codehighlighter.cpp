@@ -0,0 +1,435 @@
+#include "widgets/codehighlighter.h"
+#include <KSyntaxHighlighting/AbstractHighlighter>
+#include <QTextDocument>
+#include <QTextLayout>
+#include <QtConcurrent/QtConcurrent>
+
+using namespace KSyntaxHighlighting;
+
+namespace
+{
+    // Number of lines tokenized by a single background job
+    const int ChunkSize = 1000;
+    // Edits spanning up to this number of blocks are highlighted immediately
+    const int MaxSyncBlocks = 64;
+}
+
+class CodeHighlighter::BlockData : public QTextBlockUserData
+{
+public:
+    HighlightedLine line;
+    bool exact = false;
+};
+
+class CodeHighlighter::LineHighlighter : public AbstractHighlighter
+{
+public:
+    explicit LineHighlighter(const Definition &definition)
+    {
+        setDefinition(definition);
+    }
+
+    HighlightedLine highlight(const QString &text, const State &state)
+    {
+        line = HighlightedLine();
+        line.state = highlightLine(text, state);
+        return line;
+    }
+
+protected:
+    void applyFormat(int offset, int length, const Format &format) override
+    {
+        if (length > 0) {
+            line.tokens.append({offset, length, format});
+        }
+    }
+
+    void applyFolding(int offset, int length, FoldingRegion region) override
+    {
+        Q_UNUSED(offset)
+        Q_UNUSED(length)
+        if (region.type() == FoldingRegion::Begin) {
+            line.foldingRegions.append(region);
+        } else if (region.type() == FoldingRegion::End) {
+            // Drop the regions which are opened and closed on the same line
+            for (int i = line.foldingRegions.size() - 1; i >= 0; --i) {
+                const auto &opened = line.foldingRegions.at(i);
+                if (opened.id() == region.id() && opened.type() == FoldingRegion::Begin) {
+                    line.foldingRegions.remove(i);
+                    return;
+                }
+            }
+            line.foldingRegions.append(region);
+        }
+    }
+
+private:
+    HighlightedLine line;
+};
+
+CodeHighlighter::CodeHighlighter(QTextDocument *document) : QObject(document), document(document)
+{
+    connect(document, &QTextDocument::contentsChange, this, &CodeHighlighter::onContentsChange);
+    connect(&watcher, &QFutureWatcher<HighlightJob>::finished, this, &CodeHighlighter::onJobFinished);
+}
+
+Definition CodeHighlighter::definition() const
+{
+    return currentDefinition;
+}
+
+Theme CodeHighlighter::theme() const
+{
+    return currentTheme;
+}
+
+void CodeHighlighter::setDefinition(const Definition &definition)
+{
+    if (currentDefinition == definition) {
+        return;
+    }
+    // Load the definition with all its dependencies before it's used by the workers:
+    definition.includedDefinitions();
+    currentDefinition = definition;
+    rehighlight();
+}
+
+void CodeHighlighter::setTheme(const Theme &theme)
+{
+    currentTheme = theme;
+    charFormats.clear();
+
+    // Re-apply the cached tokens, no need to tokenize the document again:
+    auto block = document->firstBlock();
+    while (block.isValid()) {
+        if (auto data = getBlockData(block)) {
+            applyFormats(block, data->line.tokens);
+        }
+        block = block.next();
+    }
+    markDirty(document->firstBlock(), document->lastBlock());
+}
+
+void CodeHighlighter::setVisibleBlocks(int first, int last)
+{
+    firstVisibleBlock = first;
+    lastVisibleBlock = last;
+    schedule();
+}
+
+void CodeHighlighter::rehighlight()
+{
+    ++generation;
+    blockCount = document->blockCount();
+    auto block = document->firstBlock();
+    while (block.isValid()) {
+        block.setUserData(nullptr);
+        if (!currentDefinition.isValid()) {
+            block.layout()->clearFormats();
+        }
+        block = block.next();
+    }
+    if (!currentDefinition.isValid()) {
+        dirtyBlock = -1;
+        markDirty(document->firstBlock(), document->lastBlock());
+        return;
+    }
+    dirtyBlock = 0;
+    schedule();
+}
+
+bool CodeHighlighter::startsFoldingRegion(const QTextBlock &block) const
+{
+    return getFoldingRegion(block).type() == FoldingRegion::Begin;
+}
+
+QTextBlock CodeHighlighter::findFoldingRegionEnd(const QTextBlock &startBlock) const
+{
+    const auto region = getFoldingRegion(startBlock);
+    auto block = startBlock;
+    int depth = 1;
+    while (block.isValid()) {
+        block = block.next();
+        const auto data = getBlockData(block);
+        if (!data) {
+            continue;
+        }
+        for (const auto &folding : data->line.foldingRegions) {
+            if (folding.id() != region.id()) {
+                continue;
+            }
+            if (folding.type() == FoldingRegion::End) {
+                --depth;
+            } else if (folding.type() == FoldingRegion::Begin) {
+                ++depth;
+            }
+            if (depth == 0) {
+                return block;
+            }
+        }
+    }
+    return QTextBlock();
+}
+
+void CodeHighlighter::onContentsChange(int position, int charsRemoved, int charsAdded)
+{
+    Q_UNUSED(charsRemoved)
+    if (applyingFormats) {
+        return;
+    }
+    const int blockCountDelta = document->blockCount() - blockCount;
+    blockCount = document->blockCount();
+    if (!currentDefinition.isValid()) {
+        return;
+    }
+    ++generation;
+
+    const auto firstBlock = document->findBlock(position);
+    auto lastBlock = document->findBlock(position + charsAdded);
+    if (!lastBlock.isValid()) {
+        lastBlock = document->lastBlock();
+    }
+    const int first = firstBlock.blockNumber();
+    const int last = lastBlock.blockNumber();
+    if (dirtyBlock > first) {
+        // Keep pointing to the same block after lines were inserted or removed above it
+        dirtyBlock = qMax(first, dirtyBlock + blockCountDelta);
+    }
+
+    if (last - first > MaxSyncBlocks) {
+        // Large insertion (e.g., loading the file): tokenize it in the background
+        for (auto block = firstBlock; block.isValid() && block.blockNumber() <= last; block = block.next()) {
+            if (auto data = getBlockData(block)) {
+                data->exact = false;
+            }
+        }
+        dirtyBlock = (dirtyBlock == -1) ? first : qMin(dirtyBlock, first);
+        schedule();
+        return;
+    }
+
+    // Highlight the edited blocks right away and continue while the state keeps changing:
+    State state;
+    bool exact = true;
+    if (first > 0) {
+        const auto previousData = getBlockData(firstBlock.previous());
+        state = previousData ? previousData->line.state : State();
+        exact = previousData && previousData->exact;
+    }
+    LineHighlighter highlighter(currentDefinition);
+    auto block = firstBlock;
+    auto lastHighlighted = firstBlock;
+    int count = 0;
+    while (block.isValid()) {
+        if (block.blockNumber() > last && count >= MaxSyncBlocks) {
+            dirtyBlock = (dirtyBlock == -1) ? block.blockNumber() : qMin(dirtyBlock, block.blockNumber());
+            break;
+        }
+        const auto line = highlighter.highlight(block.text(), state);
+        const bool changed = setBlockLine(block, line, exact);
+        lastHighlighted = block;
+        state = line.state;
+        ++count;
+        block = block.next();
+        if (block.blockNumber() > last && !changed) {
+            break;
+        }
+    }
+    markDirty(firstBlock, lastHighlighted);
+    if (exact && dirtyBlock >= first && dirtyBlock <= lastHighlighted.blockNumber()) {
+        dirtyBlock = findInexactBlock(lastHighlighted.next());
+    }
+    schedule();
+}
+
+void CodeHighlighter::onJobFinished()
+{
+    const HighlightJob job = watcher.result();
+    if (job.generation != generation) {
+        // The document has changed since the job has started
+        schedule();
+        return;
+    }
+
+    auto block = document->findBlockByNumber(job.firstBlock);
+    const auto firstBlock = block;
+    auto lastBlock = block;
+    bool converged = false;
+    for (const auto &line : job.lines) {
+        if (!block.isValid()) {
+            break;
+        }
+        if (!job.exact) {
+            const auto data = getBlockData(block);
+            if (!data || !data->exact) {
+                setBlockLine(block, line, false);
+            }
+        } else if (!setBlockLine(block, line, true)) {
+            // The rest of the document is up to date, unless it was edited elsewhere
+            converged = true;
+        }
+        lastBlock = block;
+        block = block.next();
+        if (converged) {
+            break;
+        }
+    }
+    markDirty(firstBlock, lastBlock);
+
+    if (job.exact) {
+        dirtyBlock = converged ? findInexactBlock(block) : (block.isValid() ? block.blockNumber() : -1);
+    }
+    schedule();
+}
+
+void CodeHighlighter::schedule()
+{
+    if (watcher.isRunning() || dirtyBlock == -1 || !currentDefinition.isValid()) {
+        return;
+    }
+
+    if (dirtyBlock + ChunkSize <= firstVisibleBlock) {
+        // Visible blocks are far below the highlighted part: guess their initial state
+        // to show something meaningful before the exact highlighting reaches them.
+        auto block = document->findBlockByNumber(firstVisibleBlock);
+        for (; block.isValid() && block.blockNumber() <= lastVisibleBlock; block = block.next()) {
+            if (!getBlockData(block)) {
+                const auto previousData = getBlockData(document->findBlockByNumber(firstVisibleBlock - 1));
+                const State state = previousData ? previousData->line.state : State();
+                startJob(firstVisibleBlock, lastVisibleBlock - firstVisibleBlock + 1, state, false);
+                return;
+            }
+        }
+    }
+
+    State state;
+    if (dirtyBlock > 0) {
+        if (const auto previousData = getBlockData(document->findBlockByNumber(dirtyBlock - 1))) {
+            state = previousData->line.state;
+        }
+    }
+    startJob(dirtyBlock, ChunkSize, state, true);
+}
+
+void CodeHighlighter::startJob(int firstBlock, int count, const State &state, bool exact)
+{
+    QStringList lines;
+    lines.reserve(count);
+    auto block = document->findBlockByNumber(firstBlock);
+    for (int i = 0; i < count && block.isValid(); ++i, block = block.next()) {
+        lines.append(block.text());
+    }
+    HighlightJob job{generation, firstBlock, exact, {}};
+    watcher.setFuture(QtConcurrent::run(&CodeHighlighter::highlightLines, job, currentDefinition, state, lines));
+}
+
+bool CodeHighlighter::setBlockLine(QTextBlock &block, const HighlightedLine &line, bool exact)
+{
+    auto data = getBlockData(block);
+    const bool changed = !data || !data->exact
+        || data->line.state != line.state
+        || data->line.foldingRegions != line.foldingRegions;
+    if (!data) {
+        data = new BlockData;
+        block.setUserData(data);
+    }
+    data->line = line;
+    data->exact = exact;
+    applyFormats(block, line.tokens);
+    return changed;
+}
+
+void CodeHighlighter::applyFormats(QTextBlock &block, const QVector<Token> &tokens)
+{
+    QVector<QTextLayout::FormatRange> ranges;
+    ranges.reserve(tokens.size());
+    for (const auto &token : tokens) {
+        QTextLayout::FormatRange range;
+        range.start = token.offset;
+        range.length = token.length;
+        range.format = getCharFormat(token.format);
+        ranges.append(range);
+    }
+    block.layout()->setFormats(ranges);
+}
+
+void CodeHighlighter::markDirty(const QTextBlock &first, const QTextBlock &last)
+{
+    if (!first.isValid() || !last.isValid()) {
+        return;
+    }
+    applyingFormats = true;
+    document->markContentsDirty(first.position(), last.position() + last.length() - first.position());
+    applyingFormats = false;
+}
+
+int CodeHighlighter::findInexactBlock(QTextBlock block) const
+{
+    for (; block.isValid(); block = block.next()) {
+        const auto data = getBlockData(block);
+        if (!data || !data->exact) {
+            return block.blockNumber();
+        }
+    }
+    return -1;
+}
+
+QTextCharFormat CodeHighlighter::getCharFormat(const Format &format)
+{
+    auto it = charFormats.constFind(format.id());
+    if (it != charFormats.constEnd()) {
+        return it.value();
+    }
+
+    QTextCharFormat charFormat;
+    // Always set the foreground color to avoid palette issues
+    charFormat.setForeground(format.textColor(currentTheme));
+    if (format.hasBackgroundColor(currentTheme)) {
+        charFormat.setBackground(format.backgroundColor(currentTheme));
+    }
+    if (format.isBold(currentTheme)) {
+        charFormat.setFontWeight(QFont::Bold);
+    }
+    if (format.isItalic(currentTheme)) {
+        charFormat.setFontItalic(true);
+    }
+    if (format.isUnderline(currentTheme)) {
+        charFormat.setFontUnderline(true);
+    }
+    if (format.isStrikeThrough(currentTheme)) {
+        charFormat.setFontStrikeOut(true);
+    }
+    charFormats.insert(format.id(), charFormat);
+    return charFormat;
+}
+
+CodeHighlighter::BlockData *CodeHighlighter::getBlockData(const QTextBlock &block)
+{
+    return block.isValid() ? static_cast<BlockData *>(block.userData()) : nullptr;
+}
+
+FoldingRegion CodeHighlighter::getFoldingRegion(const QTextBlock &block)
+{
+    const auto data = getBlockData(block);
+    if (!data) {
+        return FoldingRegion();
+    }
+    const auto &regions = data->line.foldingRegions;
+    for (int i = regions.size() - 1; i >= 0; --i) {
+        if (regions.at(i).type() == FoldingRegion::Begin) {
+            return regions.at(i);
+        }
+    }
+    return FoldingRegion();
+}
+
+CodeHighlighter::HighlightJob CodeHighlighter::highlightLines(HighlightJob job, const Definition &definition, State state, const QStringList &lines)
+{
+    LineHighlighter highlighter(definition);
+    job.lines.reserve(lines.size());
+    for (const QString &text : lines) {
+        job.lines.append(highlighter.highlight(text, state));
+        state = job.lines.last().state;
+    }
+    return job;
+}
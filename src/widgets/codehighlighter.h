@@ -0,0 +1,89 @@
+#ifndef CODEHIGHLIGHTER_H
+#define CODEHIGHLIGHTER_H
+
+#include <KSyntaxHighlighting/Definition>
+#include <KSyntaxHighlighting/FoldingRegion>
+#include <KSyntaxHighlighting/Format>
+#include <KSyntaxHighlighting/State>
+#include <KSyntaxHighlighting/Theme>
+#include <QFutureWatcher>
+#include <QTextBlock>
+#include <QTextCharFormat>
+
+class QTextDocument;
+
+// Tokenizes the document in a worker thread and caches the result per block.
+// Visible blocks are highlighted first, the rest of the document follows in chunks.
+class CodeHighlighter : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit CodeHighlighter(QTextDocument *document);
+
+    KSyntaxHighlighting::Definition definition() const;
+    KSyntaxHighlighting::Theme theme() const;
+    void setDefinition(const KSyntaxHighlighting::Definition &definition);
+    void setTheme(const KSyntaxHighlighting::Theme &theme);
+    void setVisibleBlocks(int first, int last);
+    void rehighlight();
+
+    bool startsFoldingRegion(const QTextBlock &block) const;
+    QTextBlock findFoldingRegionEnd(const QTextBlock &startBlock) const;
+
+private:
+    struct Token
+    {
+        int offset;
+        int length;
+        KSyntaxHighlighting::Format format;
+    };
+
+    struct HighlightedLine
+    {
+        KSyntaxHighlighting::State state;
+        QVector<Token> tokens;
+        QVector<KSyntaxHighlighting::FoldingRegion> foldingRegions;
+    };
+
+    struct HighlightJob
+    {
+        int generation;
+        int firstBlock;
+        bool exact; // False if the initial state is a guess
+        QVector<HighlightedLine> lines;
+    };
+
+    class BlockData;
+    class LineHighlighter;
+
+    void onContentsChange(int position, int charsRemoved, int charsAdded);
+    void onJobFinished();
+    void schedule();
+    void startJob(int firstBlock, int count, const KSyntaxHighlighting::State &state, bool exact);
+    bool setBlockLine(QTextBlock &block, const HighlightedLine &line, bool exact);
+    void applyFormats(QTextBlock &block, const QVector<Token> &tokens);
+    void markDirty(const QTextBlock &first, const QTextBlock &last);
+    int findInexactBlock(QTextBlock block) const;
+    QTextCharFormat getCharFormat(const KSyntaxHighlighting::Format &format);
+
+    static BlockData *getBlockData(const QTextBlock &block);
+    static KSyntaxHighlighting::FoldingRegion getFoldingRegion(const QTextBlock &block);
+    static HighlightJob highlightLines(HighlightJob job, const KSyntaxHighlighting::Definition &definition,
+                                       KSyntaxHighlighting::State state, const QStringList &lines);
+
+    QTextDocument *document;
+    KSyntaxHighlighting::Definition currentDefinition;
+    KSyntaxHighlighting::Theme currentTheme;
+    QHash<quint16, QTextCharFormat> charFormats;
+
+    QFutureWatcher<HighlightJob> watcher;
+    int generation = 0;
+    int blockCount = 0;
+    int dirtyBlock = -1; // First block which needs to be highlighted, -1 if none
+    int firstVisibleBlock = 0;
+    int lastVisibleBlock = 0;
+    bool applyingFormats = false;
+};
+
+#endif // CODEHIGHLIGHTER_H
@@ -1,6 +1,6 @@
 #include "widgets/codesidebar.h"
 #include "widgets/codeeditor.h"
-#include <KSyntaxHighlighting/SyntaxHighlighter>
+#include "widgets/codehighlighter.h"
 #include <QPainter>
 #include <QPainterPath>
 
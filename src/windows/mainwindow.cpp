@@ -80,8 +80,12 @@ void MainWindow::openApk(const QString &path)
 {
     if (auto package = addPackage(path)) {
         auto command = package->createCommandChain();
-        command->add(package->createUnpackCommand(), true);
-        command->run();
+        if (app->settings->getQuickOpen()) {
+            command->add(package->createQuickOpenCommand(), true);
+        } else {
+            command->add(package->createUnpackCommand(), true);
+        }
+        package->schedule(command);
     }
 }
 
@@ -100,7 +104,7 @@ void MainWindow::optimizeExternalApk()
         if (auto package = addPackage(path)) {
             auto command = package->createCommandChain();
             command->add(package->createZipalignCommand(), true);
-            command->run();
+            package->schedule(command);
         }
     }
 }
@@ -116,7 +120,7 @@ void MainWindow::signExternalApk()
         if (auto package = addPackage(path)) {
             auto command = package->createCommandChain();
             command->add(package->createSignCommand(keystore.get()), true);
-            command->run();
+            package->schedule(command);
         }
     }
 }
@@ -132,7 +136,7 @@ void MainWindow::installExternalApk()
         if (auto package = addPackage(path)) {
             auto command = package->createCommandChain();
             command->add(package->createInstallCommand(device.getSerial()), true);
-            command->run();
+            package->schedule(command);
         }
     }
 }
@@ -153,7 +157,11 @@ void MainWindow::processArguments(const QStringList &arguments)
         if (auto package = addPackage(path)) {
             auto command = package->createCommandChain();
             if (!cli.isSet(optimizeOption) && !cli.isSet(signOption) && !cli.isSet(installOption)) {
-                command->add(package->createUnpackCommand(), true);
+                if (app->settings->getQuickOpen()) {
+                    command->add(package->createQuickOpenCommand(), true);
+                } else {
+                    command->add(package->createUnpackCommand(), true);
+                }
             } else {
                 if (cli.isSet(optimizeOption)) {
                     command->add(package->createZipalignCommand(), true);
@@ -171,7 +179,7 @@ void MainWindow::processArguments(const QStringList &arguments)
                     }
                 }
             }
-            command->run();
+            package->schedule(command);
         }
     }
 }
@@ -564,6 +572,7 @@ void MainWindow::updateRecentMenu()
 
 void MainWindow::onPackageSwitched(Package *package)
 {
+    app->scheduler.prioritize(package);
     projectManager->setCurrentProject(package);
 
     resourceTree->setModel(package ? &package->resourcesModel : dummyResourceModel);
@@ -6,7 +6,6 @@
 #include "tools/adb.h"
 #include "tools/apksigner.h"
 #include "tools/apktool.h"
-#include "tools/zipalign.h"
 #include "base/application.h"
 #include "base/settings.h"
 #include "base/themes.h"
@@ -99,6 +98,7 @@ void OptionsDialog::load()
     fileboxJava->setCurrentPath(app->settings->getJavaPath());
     spinboxMinHeapSize->setValue(app->settings->getJavaMinHeapSize());
     spinboxMaxHeapSize->setValue(app->settings->getJavaMaxHeapSize());
+    checkboxJavaWorkers->setChecked(app->settings->getJavaWorkers());
 
     // Apktool
 
@@ -111,6 +111,7 @@ void OptionsDialog::load()
     checkboxOnlyMainClasses->setChecked(app->settings->getDecompileOnlyMainClasses());
     checkboxNoDebugInfo->setChecked(app->settings->getDecompileNoDebugInfo());
     checkboxBrokenResources->setChecked(app->settings->getKeepBrokenResources());
+    checkboxQuickOpen->setChecked(app->settings->getQuickOpen());
 
     // Apksigner
 
@@ -120,7 +121,6 @@ void OptionsDialog::load()
     // Zipalign
 
     checkboxZipalign->setChecked(app->settings->getOptimizeApk());
-    fileboxZipalign->setCurrentPath(app->settings->getZipalignPath());
 
     // ADB
 
@@ -156,6 +156,7 @@ void OptionsDialog::save()
     app->settings->setJavaPath(fileboxJava->getCurrentPath());
     app->settings->setJavaMinHeapSize(spinboxMinHeapSize->value());
     app->settings->setJavaMaxHeapSize(spinboxMaxHeapSize->value());
+    app->settings->setJavaWorkers(checkboxJavaWorkers->isChecked());
 
     // Apktool
 
@@ -168,6 +169,7 @@ void OptionsDialog::save()
     app->settings->setDecompileOnlyMainClasses(checkboxOnlyMainClasses->isChecked());
     app->settings->setDecompileNoDebugInfo(checkboxNoDebugInfo->isChecked());
     app->settings->setKeepBrokenResources(checkboxBrokenResources->isChecked());
+    app->settings->setQuickOpen(checkboxQuickOpen->isChecked());
 
     // Apksigner
 
@@ -177,7 +179,6 @@ void OptionsDialog::save()
     // Zipalign
 
     app->settings->setOptimizeApk(checkboxZipalign->isChecked());
-    app->settings->setZipalignPath(fileboxZipalign->getCurrentPath());
 
     // ADB
 
@@ -294,6 +295,8 @@ void OptionsDialog::initialize()
     pageJava->addRow(tr("Initial heap size:"), spinboxMinHeapSize);
     //: "Heap" refers to a memory heap. If there is no clear translation in your language, you may also put the original English word in the parentheses.
     pageJava->addRow(tr("Maximum heap size:"), spinboxMaxHeapSize);
+    checkboxJavaWorkers = new QCheckBox(tr("Keep Java tools running in the background"), this);
+    pageJava->addRow(checkboxJavaWorkers);
 
     // Apktool
 
@@ -329,11 +332,13 @@ void OptionsDialog::initialize()
     checkboxOnlyMainClasses = new QCheckBox(tr("Decompile only main classes"), this);
     checkboxNoDebugInfo = new QCheckBox(tr("Decompile without debug info"), this);
     checkboxBrokenResources = new QCheckBox(tr("Decompile broken resources"), this);
+    checkboxQuickOpen = new QCheckBox(tr("Quick open (unpack on first edit)"), this);
     auto layoutUnpacking = new QVBoxLayout(groupUnpacking);
     layoutUnpacking->addWidget(checkboxSources);
     layoutUnpacking->addWidget(checkboxOnlyMainClasses);
     layoutUnpacking->addWidget(checkboxNoDebugInfo);
     layoutUnpacking->addWidget(checkboxBrokenResources);
+    layoutUnpacking->addWidget(checkboxQuickOpen);
 
     auto groupPacking = new QGroupBox(tr("Packing"), this);
     //: "AAPT2" is the name of the tool, don't translate it.
@@ -373,12 +378,7 @@ void OptionsDialog::initialize()
 
     auto pageZipalign = new QFormLayout;
     checkboxZipalign = new QCheckBox(tr("Optimize APK after packing"), this);
-    fileboxZipalign = new FileBox(false, this);
-    fileboxZipalign->setDefaultPath("");
-    fileboxZipalign->setPlaceholderText(Zipalign::getDefaultPath());
     pageZipalign->addRow(checkboxZipalign);
-    //: "Zipalign" is the name of the tool, don't translate it.
-    pageZipalign->addRow(tr("Zipalign path:"), fileboxZipalign);
     pageZipalign->setFieldGrowthPolicy(QFormLayout::ExpandingFieldsGrow);
 
     // ADB
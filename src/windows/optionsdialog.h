@@ -57,6 +57,7 @@ private:
     FileBox *fileboxJava;
     QSpinBox *spinboxMinHeapSize;
     QSpinBox *spinboxMaxHeapSize;
+    QCheckBox *checkboxJavaWorkers;
 
     // Apktool
 
@@ -69,6 +70,7 @@ private:
     QCheckBox *checkboxNoDebugInfo;
     QCheckBox *checkboxOnlyMainClasses;
     QCheckBox *checkboxBrokenResources;
+    QCheckBox *checkboxQuickOpen;
 
     // Apksigner
 
@@ -78,7 +80,6 @@ private:
     // Zipalign
 
     QCheckBox *checkboxZipalign;
-    FileBox *fileboxZipalign;
 
     // ADB
 